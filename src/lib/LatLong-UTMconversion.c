@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include "constants.h"
 #include "LatLong-UTMconversion.h"
+#include "cpu_dispatch.h"		// instruction set clones of LLtoUTM
 
 
 /*Reference ellipsoids derived from Peter H. Dana's website- 
@@ -21,7 +22,7 @@ Defense Mapping Agency. 1987b. DMA Technical Report: Supplement to Department of
 /* $Id: LatLong-UTMconversion.c,v 1.2 2005/06/06 18:53:06 dave Exp $ */
 
 
-void LLtoUTM(int ReferenceEllipsoid, const double Lat, const double Long, 
+CPU_DISPATCH void LLtoUTM(int ReferenceEllipsoid, const double Lat, const double Long, 
 			 double *UTMNorthing, double *UTMEasting, char* UTMZone)
 {
 //converts lat/long to UTM coords.  Equations from USGS Bulletin 1532 
@@ -0,0 +1,48 @@
+//! cpu_dispatch.c
+//!
+//! run time CPU dispatch Functions
+/* $Id$ */
+
+
+/*
+
+	This c file reports which copies of the CPU_DISPATCH kernels run.  It
+	makes the very feature tests of the loader's resolver, see
+	CPU_DISPATCH_AVX2_FEATURE and CPU_DISPATCH_AVX512_FEATURE.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cpu_dispatch.h"
+
+
+//!-------------------------------------------------------
+//! Get Functions
+//!-------------------------------------------------------
+//! level of the copies the loader picked on this CPU, CPU_DISPATCH_*
+int GetCPUDispatchLevel( void )
+{
+#if CPU_DISPATCH_ENABLED
+	__builtin_cpu_init();
+
+	if ( __builtin_cpu_supports( CPU_DISPATCH_AVX512_FEATURE ) )
+	{
+		return CPU_DISPATCH_AVX512;
+	}
+	if ( __builtin_cpu_supports( CPU_DISPATCH_AVX2_FEATURE ) )
+	{
+		return CPU_DISPATCH_AVX2;
+	}
+#endif
+
+	return CPU_DISPATCH_DEFAULT;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
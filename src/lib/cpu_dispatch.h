@@ -0,0 +1,80 @@
+//! cpu_dispatch.h
+//! run time CPU dispatch Header File
+//! compiles the hot kernels for several instruction sets and picks one at load time
+/*! $Id$ */
+
+/*
+
+	A function marked CPU_DISPATCH is compiled three times:
+
+		default					the build target, SSE2 on x86-64
+		arch=x86-64-v3		AVX2, FMA, BMI and BMI2
+		arch=x86-64-v4		AVX-512 F, CD, BW, DQ and VL
+
+	and the dynamic loader resolves every call, and every pointer taken to it,
+	to the best copy the CPU supports through CPUID (a GNU indirect function).
+	The copies are named by feature level, not by CPU model: a model name
+	such as arch=haswell only resolves on that very model, any other AVX2 or
+	AVX-512 host falling back to the default.  One binary then runs on every
+	host and uses the wider units where present.
+
+	The feature levels need GCC 12; GCC 8 to 11 clone for avx2 and avx512f
+	alone, without FMA.  Dispatch needs x86 with ifunc support.  Elsewhere,
+	or when the build defines NO_CPU_DISPATCH, CPU_DISPATCH is empty and the
+	function is compiled once for the build target.
+
+	A kernel kept in a function pointer, such as ComputeKernel, is a plain
+	function calling the marked one: GCC takes the stored address of a
+	cloned function for that of a local (-Wdangling-pointer).
+
+	Marked kernels are the matrix products of the filter kernels and the
+	builtin backend, the transducer array sweeps, km_ComputeKinematicModel
+	and LLtoUTM.
+
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+
+//! Defines
+
+//! instruction set levels reported by GetCPUDispatchLevel
+#define CPU_DISPATCH_DEFAULT				0
+#define CPU_DISPATCH_AVX2						1
+#define CPU_DISPATCH_AVX512					2
+
+#if !defined(NO_CPU_DISPATCH) && defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8 \
+		&& ( defined(__x86_64__) || defined(__i386__) ) && defined(__ELF__) && defined(__linux__)
+#define CPU_DISPATCH_ENABLED				1
+#if __GNUC__ >= 12
+#define CPU_DISPATCH		__attribute__((target_clones("default","arch=x86-64-v3","arch=x86-64-v4")))
+//! __builtin_cpu_supports tests the resolver makes for each copy
+#define CPU_DISPATCH_AVX2_FEATURE		"x86-64-v3"
+#define CPU_DISPATCH_AVX512_FEATURE	"x86-64-v4"
+#else
+#define CPU_DISPATCH		__attribute__((target_clones("default","avx2","avx512f")))
+#define CPU_DISPATCH_AVX2_FEATURE		"avx2"
+#define CPU_DISPATCH_AVX512_FEATURE	"avx512f"
+#endif
+#else
+#define CPU_DISPATCH_ENABLED				0
+#define CPU_DISPATCH
+#endif
+
+
+//! Functions
+
+//! Get Functions
+//! level of the copies the loader picked on this CPU, CPU_DISPATCH_*
+int GetCPUDispatchLevel( void );
+
+#endif  //! define CPU_DISPATCH_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
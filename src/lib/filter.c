@@ -16,7 +16,8 @@
 	The first version is based on a linear stochastic system model
 	and a discrete time recursive a priori formulation of the Kalman filter.
 
-	BLAS and LAPACK are used to perform the linear algebra operations.
+	BLAS and LAPACK are used to perform the linear algebra operations,
+	through the backend chosen in filter_backend.h.
 	
 	x_hat_ is x_hat a priori 			(predictive estimate)
 	x_hat  is x_hat a posteriori	(actual estimate)
@@ -29,6 +30,13 @@ extern "C" {
 #endif
 
 #include "filter.h"
+#include "filter_fixed.h"	// size specialized kernels
+#include "filter_symmetric.h"	// symmetric covariance kernels
+#include "filter_plan.h"		// structure planned kernel
+#include "filter_block.h"		// block decomposed kernel
+#include "filter_sequential.h"	// sequential update kernels
+#include "filter_steady.h"		// steady state gain detection
+#include "filter_sqrt_info.h"	// square root information kernels
 
 
 //!-------------------------------------------------------
@@ -43,313 +51,156 @@ k_filter * CreateKFilter( void )
 }//! end CreateKFilter
 
 //!-------------------------------------------------------
-//! Init Fcns - dynamically create and clear
+//! Arena Fcns - place every array of a filter in one block
 //!-------------------------------------------------------
-//! create the sub elements of the kalman filter
-int InitKFilter ( k_filter *out, int size_matrices )
-{
-	//! create the sub elements of the kalman filter
-	int i,j;
-	
-	//! allocate size to the data structr
-	out->num_elements = size_matrices;
-	
-	//! create an appropriate array size for x_hat and y
-	
-	//! create x_hat
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->x_hat = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
 
-	//! create x_hat_
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->x_hat_ = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-		
-	//! create y
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->y = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	
-	// y_hat
-	//! create y_hat
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->y_hat = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	// y_hat_
-	//! create y_hat
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->y_hat_ = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}	
-	//! pivot_table
-	//! create pivot_table
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->pivot_table = (int *) malloc( size_matrices * sizeof( int ));		
-	}
-	else
-	{
-		return -1;
-	}
-	// u
-	//! create u
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->u = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	
-	
-	// Ax
-	//! create Ax
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Ax = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+/*
+	The vectors and matrices of a filter live in a single block, the arena,
+	each one starting on its own cache line.  They are laid out in the order
+	ComputeKFilter reads them: the gain, a priori, covariance and a
+	posteriori stages, then the bookkeeping arrays.
+
+	A filter that may split also holds the room for the sub-filters of
+	DecomposeKFilter at its end, so decomposing and resetting never go to
+	the heap.  The sub-filters themselves never split further, a block
+	being already independent, and hold no such room.
+*/
 
-		// Bu
-	//! create Bu
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Bu = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+//! returns the next region of bytes in arena, or NULL while only sizing
+static void * CarveKFilterArena( char *arena, size_t *offset, size_t bytes )
+{
+	void *region = ( arena != NULL ) ? (void *)(arena + *offset) : NULL;
 	
-																	
-	//! create memory for each transducer row in matrices
+	*offset += KFILTER_ALIGN( bytes );
+	
+	return region;
+}
 
-	//! create A matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->A = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+static size_t SizeKFilterBlocks( int n );
 
-	//! create B matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->B = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+//! aims the members of out into arena and returns the bytes used
+//! split is nonzero for a filter with room for its sub-filters
+static size_t LayoutKFilterArena( k_filter *out, int n, char *arena, int split )
+{
+	size_t offset = 0;
+	size_t vector = n * sizeof( double );
+	size_t matrix = n * n * sizeof( double );
+	
+	// gain
+	out->P 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->C 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->R 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->PC 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->CPC 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->CPC_R 				= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->I 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->K 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	// a priori
+	out->A 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->AK 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->x_hat_ 			= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->y 						= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->x_hat 				= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->Ax 					= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->B 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->u 						= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->Bu 					= (double *) CarveKFilterArena( arena, &offset, vector );
+	// covariance
+	out->CP 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->GQG 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->G 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->Q 						= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->QG 					= (double *) CarveKFilterArena( arena, &offset, matrix );
+	// a posteriori
+	out->y_hat_ 			= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->y_hat 				= (double *) CarveKFilterArena( arena, &offset, vector );
+	// bookkeeping
+	out->measured 		= (int *) CarveKFilterArena( arena, &offset, n * sizeof( int ) );
+	out->pivot_table 	= (int *) CarveKFilterArena( arena, &offset, n * sizeof( int ) );
+	out->P_previous 	= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->S_steady 		= (double *) CarveKFilterArena( arena, &offset, vector );
+	out->steady_counts = (int *) CarveKFilterArena( arena, &offset, n * sizeof( int ) );
+	out->info_root 		= (double *) CarveKFilterArena( arena, &offset, matrix );
+	out->block_index 	= (int *) CarveKFilterArena( arena, &offset, n * sizeof( int ) );
+	out->block_start 	= (int *) CarveKFilterArena( arena, &offset, (n + 1) * sizeof( int ) );
+	out->blocks 			= (void **) CarveKFilterArena( arena, &offset, n * sizeof( void * ) );
+	out->block_label 	= (int *) CarveKFilterArena( arena, &offset, n * sizeof( int ) );
+	// sub-filters
+	out->block_bytes 	= split ? SizeKFilterBlocks( n ) : 0;
+	out->block_arena 	= CarveKFilterArena( arena, &offset, out->block_bytes );
+	if ( out->block_bytes == 0 )
+	{
+		out->block_arena = NULL;
+	}
+	
+	return offset;
+}
 
-	//! create C matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->C = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
+/*
+	The arrays of a filter of n take a n^2 + b n + c bytes before rounding
+	to cache lines, and a filter of one takes at least c and the rounding.
+	Two or more blocks summing to n hold no more than (n - 1)^2 + 1 in their
+	squares, so their arrays fit in a filter of n - 1 and one of one, plus
+	the c and the rounding of a filter of one and a k_filter for each block.
+*/
+//! bytes of the sub-filters of any split of a filter of n into blocks
+static size_t SizeKFilterBlocks( int n )
+{
+	if ( n < 2 )
 	{
-		return -1;
+		// never splits
+		return 0;
 	}
 	
-	//! create G matrix - create identity matrix for computation
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->G = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	return SizeKFilterBlockArena( n - 1 ) + (n + 1) * SizeKFilterBlockArena( 1 )
+		+ n * KFILTER_ALIGN( sizeof( k_filter ) );
+}
 
+//! returns the bytes of arena a filter of size_matrices needs
+size_t SizeKFilterArena( int size_matrices )
+{
+	k_filter layout;
 	
-	//! create K matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
+	if ( size_matrices <= 0 )
 	{
-		//! create array pointers
-		out->K = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
+		return 0;
 	}
 	
-	//! create P matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->P = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create Q matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Q = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create R matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->R = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create CPC matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CPC = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-
-	//! create I matrix - create identity matrix for computation
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->I = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	// CPC_R
-	//! create CPC_R matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CPC_R = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	return LayoutKFilterArena( &layout, size_matrices, NULL, 1 );
+}
 
+//! returns the bytes of arena a sub-filter of size_matrices needs
+size_t SizeKFilterBlockArena( int size_matrices )
+{
+	k_filter layout;
 	
-	//  PC
-	//! create PC matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
+	if ( size_matrices <= 0 )
 	{
-		//! create array pointers
-		out->PC = (double *) malloc( size_matrices * size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
+		return 0;
 	}
 	
-	// QG
-	//! create GQG matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->QG = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	return LayoutKFilterArena( &layout, size_matrices, NULL, 0 );
+}
 
-	// GQG
-	//! create GQG matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->GQG = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+
+//!-------------------------------------------------------
+//! Init Fcns - dynamically create and clear
+//!-------------------------------------------------------
+//! create the sub elements of the kalman filter
+int InitKFilter ( k_filter *out, int size_matrices )
+{
+	void *arena;
 	
-	// CP
-	//! create CP matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CP = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
+	//! one block for every array of the filter
+	if ( size_matrices <= 0 || posix_memalign( &arena, KFILTER_ALIGNMENT, SizeKFilterArena( size_matrices ) ) != 0 )
 	{
 		return -1;
 	}
 	
-	// AK
-	//! create AK matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->AK = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	// zero values
-	ZeroKFilter ( out );
-			
+	InitKFilterArena ( out, size_matrices, arena );
+	
+	//! freed again by DestroyKFilter
+	out->arena_owned = 1;
 	
 	return 0;
 }
@@ -361,305 +212,117 @@ int InitKFilter ( k_filter *out, int size_matrices )
 */
 int InitKFilter2 ( k_filter *out, int size_matrices, double * ptr_measurement, double * ptr_filtered )
 {
-	//! create the sub elements of the kalman filter with 
-	//! assigned measurement and filtered arrays
-	int i,j;
-	
-	// y will aim at ptr_measurement for meassured values
-	// x_hat will aim at filterd for the filtered measurement
-	
-	//! allocate size to the data structr
-	out->num_elements = size_matrices;
-	
-	//! create an appropriate array size for x_hat and y
-	
-	//! aim  x_hat_ at filtered output
-	out->x_hat = ptr_filtered;
-
-	//! create x_hat_
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->x_hat_ = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
+	if ( InitKFilter ( out, size_matrices ) != 0 )
 	{
 		return -1;
 	}
-		
-	//! aim y at data measurement input
-	out->y = ptr_measurement;
 	
-	// y_hat
-	//! create y_hat
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->y_hat = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	// y_hat_
-	//! create y_hat
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->y_hat_ = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}	
-	//! pivot_table
-	//! create pivot_table
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->pivot_table = (int *) malloc( size_matrices * sizeof( int ));		
-	}
-	else
-	{
-		return -1;
-	}
-	// u
-	//! create u
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->u = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
+	// y will aim at ptr_measurement for meassured values
+	// x_hat will aim at filterd for the filtered measurement
+	return SetKFilterIO ( out, ptr_measurement, ptr_filtered );
+}
+
+//! aims a cleared filter into arena and resets it
+static int LoadKFilterArena ( k_filter *out, int size_matrices, void *arena, int split )
+{
+	if ( size_matrices <= 0 || arena == NULL )
 	{
 		return -1;
 	}
 	
+	//! allocate size to the data structr
+	out->num_elements = size_matrices;
+	out->arena = arena;
+	out->arena_owned = 0;
 	
+	//! aim every array into the arena and clear it
+	memset( arena, 0, LayoutKFilterArena( out, size_matrices, (char *)arena, split ) );
 	
-	// Ax
-	//! create Ax
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Ax = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	// no sub-filters yet
+	out->num_blocks = 0;
 	
+	// defaults - also plans the step and selects the kernel
+	return ResetKFilter ( out );
+}
 
-		// Bu
-	//! create Bu
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Bu = (double *) malloc( size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	
-																	
-	//! create memory for each transducer row in matrices
+/*
+	InitKFilterArena creates the filter inside arena, a block of at least
+	SizeKFilterArena( size_matrices ) bytes aligned to KFILTER_ALIGNMENT that
+	the caller keeps ownership of.
+*/
+int InitKFilterArena ( k_filter *out, int size_matrices, void *arena )
+{
+	return LoadKFilterArena ( out, size_matrices, arena, 1 );
+}
 
-	//! create A matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->A = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+/*
+	InitKFilterBlockArena creates a sub-filter of DecomposeKFilter inside
+	arena, a block of at least SizeKFilterBlockArena( size_matrices ) bytes
+	within the arena of the parent.
+*/
+int InitKFilterBlockArena ( k_filter *out, int size_matrices, void *arena )
+{
+	return LoadKFilterArena ( out, size_matrices, arena, 0 );
+}
 
-	//! create B matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->B = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
 
-	//! create C matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->C = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
+//!-------------------------------------------------------
+//! Destructors
+//!-------------------------------------------------------
+//! releases the arena if InitKFilter allocated it, the sub-filters with it
+//! a k_filter from CreateKFilter is then released with free
+int DestroyKFilter ( k_filter *out )
+{
+	if ( out->arena == NULL )
 	{
+		// already destroyed
 		return -1;
 	}
 	
-	//! create G matrix - create identity matrix for computation
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
+	if ( out->arena_owned )
 	{
-		//! create array pointers
-		out->G = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
+		free( out->arena );
 	}
-	else
-	{
-		return -1;
-	}
-
 	
-	//! create K matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->K = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	out->arena = NULL;
+	out->arena_owned = 0;
+	out->num_elements = 0;
+	out->num_blocks = 0;
+	out->plan_length = 0;
+	out->ComputeKernel = NULL;
 	
-	//! create P matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->P = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create Q matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->Q = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create R matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->R = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	//! create CPC matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CPC = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-
-	//! create I matrix - create identity matrix for computation
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->I = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	return 0;
+}
 
-	// CPC_R
-	//! create CPC_R matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CPC_R = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
 
+//!-------------------------------------------------------
+//! Zero Fcns
+//!-------------------------------------------------------
+//! restores the defaults of an initialized filter without touching the heap
+//! the model matrices return to identity and x_hat to zero
+int ResetKFilter ( k_filter *out )
+{
+	int i;
 	
-	//  PC
-	//! create PC matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->PC = (double *) malloc( size_matrices * size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-	
-	// QG
-	//! create GQG matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->QG = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
-
-	// GQG
-	//! create GQG matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->GQG = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	// original formulation
+	out->covariance_mode = KFILTER_COVARIANCE_GENERAL;
+	out->update_mode = KFILTER_UPDATE_BATCH;
 	
-	// CP
-	//! create CP matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->CP = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
-	{
-		return -1;
-	}
+	// steady state detection
+	out->steady_norm = KFILTER_NORM_MAX;
+	out->steady_tolerance = KFILTER_STEADY_TOLERANCE;
+	out->steady_steps = KFILTER_STEADY_STEPS;
+	out->steady_gate = KFILTER_STEADY_GATE;
 	
-	// AK
-	//! create AK matrix
-	if ( (size_matrices) > 0 )//! so long as there are transducers set
-	{
-		//! create array pointers
-		out->AK = (double *) malloc( size_matrices *size_matrices * sizeof( double ));		
-	}
-	else
+	//! zero x_hat
+	for (i = 0; i < out->num_elements; i++ )
 	{
-		return -1;
+		out->x_hat[i] = 0.0;		
 	}
-
-	// zero values
-	ZeroKFilter ( out );
-			
 	
-	return 0;
+	// zero values - also plans the step and selects the kernel
+	return ZeroKFilter ( out );
 }
-
-//!-------------------------------------------------------
-//! Zero Fcns
-//!-------------------------------------------------------
 //! zero the elements of a pre-existing kalman filter
 int ZeroKFilter ( k_filter *out)
 {
@@ -708,6 +371,11 @@ int ZeroKFilter ( k_filter *out)
 		//! zero entry
 		out->pivot_table[i] = 1;		
 	}
+	//! every element of y measured
+	for (i = 0; i < out->num_elements; i++ )
+	{
+		out->measured[i] = 1;		
+	}
 	//! zero Ax
 	for (i = 0; i < out->num_elements; i++ )
 	{
@@ -829,6 +497,9 @@ int ZeroKFilter ( k_filter *out)
 			}
 	}
 
+	// replan for the identity model matrices
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
 
 	return 0;
 }
@@ -837,6 +508,21 @@ int ZeroKFilter ( k_filter *out)
 //!-------------------------------------------------------
 //! Get/Set Fcns
 //!-------------------------------------------------------
+//! aims y and x_hat at arrays owned by the caller
+int SetKFilterIO (  k_filter *out, double * ptr_measurement, double * ptr_filtered )
+{
+	if ( ptr_measurement == NULL || ptr_filtered == NULL )
+	{
+		return -1;
+	}
+	
+	//! aim y at data measurement input
+	out->y = ptr_measurement;
+	//! aim  x_hat at filtered output
+	out->x_hat = ptr_filtered;
+	
+	return 0;
+}
 //! sets the measured values in the y array
 int SetKFilterMeasured (  k_filter *out, double * array, size_t size_array )
 {
@@ -889,6 +575,10 @@ int SetKFilterAMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the measured values in the B matrix
@@ -920,6 +610,10 @@ int SetKFilterBMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 
@@ -952,6 +646,10 @@ int SetKFilterCMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the values in the noise input matrix
@@ -984,6 +682,10 @@ int SetKFilterGMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the measured values in the Kalman gain  matrix
@@ -1015,6 +717,9 @@ int SetKFilterKMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// a set gain replaces any frozen gain
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the measured values in the P matrix
@@ -1046,6 +751,9 @@ int SetKFilterPMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// a coupled P can merge blocks
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the measured values in the Q matrix
@@ -1077,6 +785,10 @@ int SetKFilterQMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
 	return 0;
 }
 //! sets the values in the R matrix
@@ -1109,6 +821,148 @@ int SetKFilterRMatrix (  k_filter *out, double *array, size_t size_array )
 		return -1;
 	}
 
+	// retag the model matrices and replan the step
+	PlanKFilter ( out );
+	SelectKFilterKernel ( out );
+
+	return 0;
+}
+
+//! sets the covariance update formulation and reselects the kernel
+int SetKFilterCovarianceMode (  k_filter *out, int mode )
+{
+	int i,j;
+	double average;
+
+	switch ( mode )
+	{
+		case KFILTER_COVARIANCE_GENERAL:
+		{
+			break;
+		}
+		case KFILTER_COVARIANCE_SYMMETRIC:
+		case KFILTER_COVARIANCE_JOSEPH:
+		case KFILTER_COVARIANCE_SQRT_INFO:
+		{
+			// the symmetric kernels only read the lower triangle of P
+			// so start them from the symmetric part of the current P
+			for (i = 0; i < out->num_elements; i++ )
+			{
+				for (j = 0; j < i; j++ )
+				{
+					average = 0.5*( out->P[i + out->num_elements*j] + out->P[j + out->num_elements*i] );
+					out->P[i + out->num_elements*j] = average;
+					out->P[j + out->num_elements*i] = average;
+				}
+			}
+			break;
+		}
+		default:
+		{
+			// unknown formulation
+			return -1;
+		}
+	}
+	
+	out->covariance_mode = mode;
+	
+	return SelectKFilterKernel ( out );
+}
+//! sets the measurement update formulation and reselects the kernel
+//! the sequential update only steps the filter while R stays diagonal
+int SetKFilterUpdateMode (  k_filter *out, int mode )
+{
+	if ( mode != KFILTER_UPDATE_BATCH && mode != KFILTER_UPDATE_SEQUENTIAL )
+	{
+		// unknown formulation
+		return -1;
+	}
+	
+	out->update_mode = mode;
+	
+	return SelectKFilterKernel ( out );
+}
+//! sets which elements of y hold a measurement this step
+int SetKFilterMeasuredMask (  k_filter *out, int *array, size_t size_array )
+{
+	int i;
+
+	if ( size_array == ( out->num_elements * sizeof(int) ))// if the proper size
+	{
+		for (i = 0; i < out->num_elements; i++ )
+		{
+			if ( out->measured[i] != array[i] && out->steady_state )
+			{
+				// the frozen gain belongs to the previous mask
+				SelectKFilterKernel ( out );
+			}
+			// copy the flag over to measured array
+			out->measured[i] = array[i];
+		}
+	}
+	else
+	{
+		return -1;
+	}
+
+	return 0;
+}
+//! sets the steady state detection, tolerance 0 disables it
+int SetKFilterSteadyState (  k_filter *out, int norm, double tolerance, int steps, double gate )
+{
+	if ( norm != KFILTER_NORM_MAX && norm != KFILTER_NORM_ONE && norm != KFILTER_NORM_FROBENIUS )
+	{
+		// unknown norm
+		return -1;
+	}
+	
+	out->steady_norm = norm;
+	out->steady_tolerance = tolerance;
+	out->steady_steps = steps;
+	out->steady_gate = gate;
+	
+	return SelectKFilterKernel ( out );
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the kernel for the formulation and size
+int SelectKFilterKernel ( k_filter *out )
+{
+	// any change invalidates a frozen gain
+	ResetKFilterSteadyState ( out );
+	
+	if ( SelectKFilterBlockedKernel ( out ) == 0 )
+	{
+		// independent blocks each step at their own size
+		return 0;
+	}
+	if ( out->update_mode == KFILTER_UPDATE_SEQUENTIAL && SelectKFilterSequentialKernel ( out ) == 0 )
+	{
+		// uncorrelated measurements one at a time
+		return 0;
+	}
+	if ( out->covariance_mode == KFILTER_COVARIANCE_GENERAL )
+	{
+		// planned kernel when the structure saves work, otherwise the
+		// fixed size kernel of a dense system or NULL for the BLAS path
+		if ( SelectKFilterPlannedKernel ( out ) != 0 )
+		{
+			SelectKFilterFixedKernel ( out );
+		}
+	}
+	else if ( out->covariance_mode == KFILTER_COVARIANCE_SQRT_INFO )
+	{
+		// refactors P, the symmetric kernel if it is not positive definite
+		SelectKFilterSqrtInfoKernel ( out );
+	}
+	else
+	{
+		SelectKFilterSymmetricKernel ( out );
+	}
+	
 	return 0;
 }
 
@@ -1142,8 +996,10 @@ int SetKFilterRMatrix (  k_filter *out, double *array, size_t size_array )
 */
 int ComputeKFilterKMatrix(  k_filter *out )
 {
-	// This fcn uses the BLAS and LAPACK fcns for the major
+	// This fcn uses the backend BLAS and LAPACK fcns for the major
 	// linear algebra operations
+	const kfilter_backend *backend = GetKFilterBackend();
+	int n = out->num_elements;
 	// scalar factors for BLAS
 	double alpha = 1.0; // include matrix
 	double beta	 = 0.0; // exclude matrix
@@ -1154,86 +1010,35 @@ int ComputeKFilterKMatrix(  k_filter *out )
 	
 	// compute P trans(C)
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasTrans,
-								/* 	m x n */(const int)out->num_elements,	(const int)out->num_elements,
-								/* 	k */(const int)out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->P, 
-								/*  leading dimension of A */(const int)out->num_elements,
-								/*  matrix B */(const double *)out->C,
-								/*  leading dimension of B */(const int)out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  Matrix C */(double *)out->PC,
-								/*  leading dimension of C */(const int)out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_TRANS, n, alpha, out->P, out->C, beta, out->PC );
 	
 
 	
 	// compute CP trans(C)
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */(const int)out->num_elements,	(const int)out->num_elements,
-								/* 	k */(const int)out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->C, 
-								/*  leading dimension of A */(const int)out->num_elements,
-								/*  matrix B */(const double *)out->PC,
-								/*  leading dimension of B */(const int)out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  Matrix C */(double *)out->CPC,
-								/*  leading dimension of C */(const int)out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->C, out->PC, beta, out->CPC );
 
 	// add (R + CP trans(C))
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */(const int)out->num_elements,	(const int)out->num_elements,
-								/* 	k */(const int)out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->R, 
-								/*  leading dimension of A */(const int)out->num_elements,
-								/*  matrix B */(const double *)out->I,
-								/*  leading dimension of B */(const int)out->num_elements,
-								/*  scaling factor for C */(const double)alpha,
-								/*  matrix C */(double *)out->CPC,
-								/*  leading dimension of C */(const int)out->num_elements);	
-
-	
-	// copy contents of CP trans(C) to CPC_R as clapack_dgesv stores factorization
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->R, out->I, alpha, out->CPC );
+
+	
+	// copy contents of CP trans(C) to CPC_R as Solve stores factorization
 	// to matrix A
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */(const int)out->num_elements,	(const int)out->num_elements,
-								/* 	k */(const int)out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->CPC, 
-								/*  leading dimension of A */(const int)out->num_elements,
-								/*  matrix B */(const double *)out->I,
-								/*  leading dimension of B */(const int)out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->CPC_R,
-								/*  leading dimension of C */(const int)out->num_elements);	
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->CPC, out->I, beta, out->CPC_R );
 								
 	// make CPC into identity matrix
 	SetIdentityMatrix ( out->CPC, out->num_elements );
 
 	//! inverse ( R + CP trans(C) )
-	//! Operation required to be CblasColMajor to return the inverted matrix in the 
+	//! Solve reads column major to return the inverted matrix in the row major order
 	//! Values in pivot table don't matter, they are replaced by the fcn.	
-  clapack_dgesv ( /* 	which leading dimension to consider row or col */CblasColMajor, 
-									/*  size of matrices  */(const int)out->num_elements, 
-									/*  NRHS must be as great as M or n*/ (const int)out->num_elements,
-									/*  matrix A */(double *)(out->CPC_R), 
-									/*  leading dimension of A */(const int)out->num_elements,
-									/* 	pivot table for columns */(int *)out->pivot_table,
-									/*  matrix B */(double *)(out->CPC),
-									/*  leading dimension of B */(const int)out->num_elements);
+	if ( backend->Solve ( n, out->CPC_R, out->pivot_table, out->CPC ) != 0 )
+	{
+		// singular innovation covariance
+		return -1;
+	}
 /*									
 	printf ( "CPC \n");								
 	for (i = 0; i < out->num_elements; i++ )
@@ -1259,19 +1064,7 @@ int ComputeKFilterKMatrix(  k_filter *out )
 	  
 	// Finally compute K gain matrix and store in K
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */(const int)out->num_elements,		(const int)out->num_elements,
-								/* 	k */(const int)out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->PC, 
-								/*  leading dimension of A */(const int)out->num_elements,
-								/*  matrix B */(const double *)out->CPC,
-								/*  leading dimension of B */(const int)out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->K,
-								/*  leading dimension of C */(const int)out->num_elements);	
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->PC, out->CPC, beta, out->K );
 
 /*	printf ( "K \n");								
 	for (i = 0; i < out->num_elements; i++ )
@@ -1303,6 +1096,8 @@ int ComputeKFilterPMatrix(  k_filter *out )
 {
 
 	// computes the covariance matrix
+	const kfilter_backend *backend = GetKFilterBackend();
+	int n = out->num_elements;
 	// scalar factors for BLAS
 	double alpha = 1.0; // include matrix
 	double beta	 = 0.0; // exclude matrix
@@ -1318,19 +1113,7 @@ int ComputeKFilterPMatrix(  k_filter *out )
 
 	// compute Qtrans(G)
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->Q, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->G,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->GQG,
-								/*  leading dimension of C */out->num_elements);	
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_TRANS, n, alpha, out->Q, out->G, beta, out->GQG );
 	
 									
 	// copy GQG into QG
@@ -1338,35 +1121,11 @@ int ComputeKFilterPMatrix(  k_filter *out )
 	
 	// compute GQtrans(G)
 	/* Compute C = alpha*AB + beta*C */
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->G, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->QG,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->GQG,
-								/*  leading dimension of C */out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->G, out->QG, beta, out->GQG );
 
 	
 	// compute CP
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->C, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->P,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);	
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->C, out->P, beta, out->CP );
 
 
 	// copy CP into CPC_R and use as CP
@@ -1374,85 +1133,25 @@ int ComputeKFilterPMatrix(  k_filter *out )
 
 
 	// compute PC inv( R + CP trans(C) ) * CP and store in CP
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->K, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->CPC_R,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);	
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->K, out->CPC_R, beta, out->CP );
 
 	// compute (P - Ptrans(C)*(inv( R + CP trans(C) ) * CP))	and store in	CP																
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->P, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->I,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)-1.0*alpha,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->P, out->I, -1.0*alpha, out->CP );
 										
 	// copy CP into CPC_R and use as CP
 	CopyMatrix( out->CP, out->CPC_R, out->num_elements );
 																						
 	// compute (P - Ptrans(C)*(inv( R + CP trans(C) ) * CP))*trans(A)	and store in	CP	
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->CPC_R, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->A,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_TRANS, n, alpha, out->CPC_R, out->A, beta, out->CP );
 	
 	// copy CP into CPC_R and use as CP
 	CopyMatrix( out->CP, out->CPC_R, out->num_elements );
 
 	// compute A*(P - Ptrans(C)*(inv( R + CP trans(C) ) * CP))*trans(A)	and store in	CP
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->A, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->CPC_R,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->A, out->CPC_R, beta, out->CP );
 								
 	// add  A*(P - Ptrans(C)*(inv( R + CP trans(C) ) * CP))*trans(A) + GQtrans(G) and store in	CP
-  cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */out->num_elements,		out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->GQG, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->I,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)alpha,
-								/*  matrix C */(double *)out->CP,
-								/*  leading dimension of C */out->num_elements);				
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->GQG, out->I, alpha, out->CP );
 
 	
 	// store result CP in P
@@ -1490,6 +1189,8 @@ int ComputeKFilterAPrioriEstimate( k_filter *out )
 
 	// x_hat_ is x_hat a priori
 	// x_hat  is x_hat a posteriori
+	const kfilter_backend *backend = GetKFilterBackend();
+	int n = out->num_elements;
 	// scalar factors for BLAS
 	double alpha = 1.0; // include matrix
 	double beta	 = 0.0; // exclude matrix
@@ -1533,19 +1234,7 @@ int ComputeKFilterAPrioriEstimate( k_filter *out )
 	}
 
 	// compute AK and store in AK
-	cblas_dgemm ( /* 	which leading dimension to consider row or col */CblasRowMajor, 
-								/*  Transpose A or not */	CblasNoTrans, 
-								/*  Transpose B or not */ CblasNoTrans,
-								/* 	m x n */(const int) out->num_elements,	(const int)out->num_elements,
-								/* 	k */out->num_elements,
-                /*  scaling factor for A */(const double)alpha,
-								/*  matrix A */(const double *)out->A, 
-								/*  leading dimension of A */out->num_elements,
-								/*  matrix B */(const double *)out->K,
-								/*  leading dimension of B */out->num_elements,
-								/*  scaling factor for C */(const double)beta,
-								/*  matrix C */(double *)out->AK,
-								/*  leading dimension of C */out->num_elements);
+	backend->Multiply ( KFILTER_NOTRANS, KFILTER_NOTRANS, n, alpha, out->A, out->K, beta, out->AK );
 /*	printf ( "AK \n");								
 	for (i = 0; i < out->num_elements; i++ )
 	{
@@ -1719,20 +1408,38 @@ int ComputeKFilter( k_filter *out )
 	// This is the meta algorithm that controls the computation of the Kalman filter 
 	// current time step
 	
-	// compute K gain
-	ComputeKFilterKMatrix( out );
-
-	// compute estimate recursion / predictive estimate
-	ComputeKFilterAPrioriEstimate( out );
-	
-	// compute  Covariance Recursion
-	ComputeKFilterPMatrix( out );
+	int status = 0;
 	
-	// compute state vector estimate
-	ComputeKFilterAPosterioriEstimate( out );
+	// fixed size filters skip BLAS entirely
+	if ( out->ComputeKernel != NULL )
+	{
+		status = out->ComputeKernel( (void *)out );
+	}
+	else
+	{
+		// compute K gain, -1 when the backend could not solve for it
+		status = ComputeKFilterKMatrix( out );
+		
+		if ( status == 0 )
+		{
+			// compute estimate recursion / predictive estimate
+			ComputeKFilterAPrioriEstimate( out );
+			
+			// compute  Covariance Recursion
+			ComputeKFilterPMatrix( out );
+			
+			// compute state vector estimate
+			ComputeKFilterAPosterioriEstimate( out );
+		}
+	}
 	
+	// watch P for convergence to a steady state gain
+	if ( status == 0 )
+	{
+		UpdateKFilterSteadyState( out );
+	}
 	
-	return 0;
+	return status;
 }
 
 
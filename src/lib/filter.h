@@ -13,10 +13,10 @@
 
 //! Includes
 #include <stdlib.h>
+#include <string.h>	// memset for the arena
 
 // linear algebra routines
-#include <cblas.h>	// BLAS Level 1 2 3 
-#include <clapack.h>	// Matrix inversions and other higher level Linear algebra functions
+#include "filter_backend.h"	// BLAS and LAPACK or the builtin replacements
 #include "matrix.h"	// for Identity matrix fcns
 
 #ifdef __cplusplus
@@ -31,6 +31,52 @@ extern "C" {
 
 #define DATA_TYPE_LENGTH	36
 
+//! covariance update formulations
+//! dense general P, K from the explicit inverse - the original formulation
+#define KFILTER_COVARIANCE_GENERAL		0
+//! symmetric P, K from a Cholesky solve
+#define KFILTER_COVARIANCE_SYMMETRIC	1
+//! as symmetric, with the Joseph form of the P update
+#define KFILTER_COVARIANCE_JOSEPH			2
+//! triangular factor of inv(P) carried by orthogonal updates, see filter_sqrt_info.h
+#define KFILTER_COVARIANCE_SQRT_INFO	3
+
+//! measurement update formulations
+//! all measurements at once through inv( R + C P trans(C) )
+#define KFILTER_UPDATE_BATCH					0
+//! one measurement at a time for diagonal R, no factorization
+#define KFILTER_UPDATE_SEQUENTIAL			1
+
+//! norms of the change in P for steady state detection
+//! largest entry
+#define KFILTER_NORM_MAX						0
+//! largest column sum
+#define KFILTER_NORM_ONE						1
+//! root of the sum of squares
+#define KFILTER_NORM_FROBENIUS			2
+
+//! steady state detection defaults
+//! relative change in P taken as converged
+#define KFILTER_STEADY_TOLERANCE		1.0e-10
+//! consecutive converged steps before K is frozen
+#define KFILTER_STEADY_STEPS				10
+//! standard deviations of the innovation y - C x_hat_ that unfreeze K
+#define KFILTER_STEADY_GATE					6.0
+
+//! alignment of the arena and of every array within it, one cache line
+#define KFILTER_ALIGNMENT						64
+//! rounds a byte count up to whole cache lines
+#define KFILTER_ALIGN(bytes)				( ( (bytes) + KFILTER_ALIGNMENT - 1 ) & ~( (size_t)KFILTER_ALIGNMENT - 1 ) )
+
+//! structure of a model matrix as tagged by PlanKFilter
+#define KFILTER_MATRIX_DENSE				0
+#define KFILTER_MATRIX_DIAGONAL			1
+#define KFILTER_MATRIX_IDENTITY			2
+#define KFILTER_MATRIX_ZERO					3
+
+//! most operations in a compiled filter step
+#define KFILTER_PLAN_LENGTH					8
+
 //! Data structs
 
 
@@ -51,6 +97,8 @@ extern "C" {
 	CBLAS 	= C-wrapped Basic Linear Algebra Subroutines in Fortran 77 (vector and matrix multiply)
 	CLAPACK	= C-wrapped Linear Algebra Package (matrix inversions)
 	
+	or by the builtin replacements of filter_backend.c, see filter_backend.h
+	
 	The array order used by BLAS is X(i) = x_i or the ith element (from 0,...,n-1)
 	
 	The matrix order used is 2D arrays ans the arrangement of rows and columns is 
@@ -83,6 +131,14 @@ typedef struct
 
 	//! number elements  dimension of the matrix
 	int	num_elements;
+	//! covariance update formulation KFILTER_COVARIANCE_*
+	int	covariance_mode;
+	//! measurement update formulation KFILTER_UPDATE_*
+	int	update_mode;
+	//! block holding every array below, see SizeKFilterArena
+	void *arena;
+	//! nonzero when InitKFilter allocated the arena and DestroyKFilter frees it
+	int arena_owned;
 				
 	//! internal state array of conditional means for transducers
 	//! a posteriori state estimate
@@ -91,6 +147,9 @@ typedef struct
 	double *x_hat_;
 	//! measured data of the transducers
 	double *y;		
+	//! nonzero for each element of y measured this step
+	//! honoured by the sequential update, the batch update uses all of y
+	int *measured;
 	// estimated delta y measurement
 	double *y_hat;
 	// prefactor to final estimate of y
@@ -135,6 +194,65 @@ typedef struct
 	// ! holds AK matrix factor during Estimate recursion
 	double *AK; 
 	
+	//! METHODS
+	
+	//! Ptr to a complete filter step specialized for this filter size
+	//! NULL uses the generic BLAS path in ComputeKFilter
+	int (*ComputeKernel)( void *in );
+	//! *in points to the k_filter
+	
+	//! structure of the model matrices KFILTER_MATRIX_*
+	//! tagged by PlanKFilter whenever a matrix is set
+	int A_structure;
+	int B_structure;
+	int C_structure;
+	int G_structure;
+	int Q_structure;
+	int R_structure;
+	//! filter step compiled from the matrix structure
+	int (*plan[KFILTER_PLAN_LENGTH])( void *in );
+	//! number of operations in plan
+	int plan_length;
+	
+	//! steady state gain detection, see filter_steady.h
+	//! norm of the change in P KFILTER_NORM_*
+	int steady_norm;
+	//! relative change in P taken as converged, 0 disables detection
+	double steady_tolerance;
+	//! consecutive converged steps before K is frozen
+	int steady_steps;
+	//! standard deviations of the innovation y - C x_hat_ that unfreeze K, 0 never
+	double steady_gate;
+	//! nonzero while stepping with the frozen K
+	int steady_state;
+	//! converged steps counted so far
+	int steady_count;
+	//! P of the previous step
+	double *P_previous;
+	//! innovation variances diag( R + C P trans(C) ) of the frozen K
+	double *S_steady;
+	//! converged steps of each scalar block of ComputeKFilterBlocked,
+	//! frozen at steady_steps
+	int *steady_counts;
+	
+	//! upper triangular info_root with inv(P) = trans(info_root) info_root
+	//! current only in KFILTER_COVARIANCE_SQRT_INFO, see filter_sqrt_info.h
+	double *info_root;
+	
+	//! independent blocks found by DecomposeKFilter
+	int num_blocks;
+	//! transducer indices grouped by block
+	int *block_index;
+	//! start of each block in block_index, num_blocks + 1 entries
+	int *block_start;
+	//! sub-filter k_filter * of each block, NULL for a single transducer
+	void **blocks;
+	//! group of each transducer while DecomposeKFilter runs
+	int *block_label;
+	//! region of the arena the sub-filters are laid out in, NULL in a sub-filter
+	void *block_arena;
+	size_t block_bytes;
+	
 } k_filter; 
 
 
@@ -149,14 +267,29 @@ int InitKFilter ( k_filter *out, int size_matrices );
 //! create the sub elements of the kalman filter with 
 //! assigned measurement and filtered arrays
 int InitKFilter2 ( k_filter *out, int size_matrices, double * ptr_measurement, double * ptr_filtered );
+//! create the sub elements of the kalman filter within a caller owned arena
+int InitKFilterArena ( k_filter *out, int size_matrices, void *arena );
+//! bytes of arena needed by a filter of size_matrices
+size_t SizeKFilterArena( int size_matrices );
+//! create a sub-filter of DecomposeKFilter, which never splits further, within arena
+int InitKFilterBlockArena ( k_filter *out, int size_matrices, void *arena );
+//! bytes of arena needed by a sub-filter of size_matrices
+size_t SizeKFilterBlockArena( int size_matrices );
+
 //! Destructors
+//! release what the Init fcns allocated
+int DestroyKFilter ( k_filter *out );
 
 //! Zero Fcns - zero the elements
 //! zero the elements of a pre-existing kalman filter
 int ZeroKFilter ( k_filter *out);
+//! restore the defaults of a pre-existing kalman filter without touching the heap
+int ResetKFilter ( k_filter *out );
 
 //! Get/Set Functions - resets specific values into the data struct
 
+//! aims y and x_hat at caller owned arrays
+int SetKFilterIO (  k_filter *out, double * ptr_measurement, double * ptr_filtered );
 //! sets the measured values in the y array
 int SetKFilterMeasured (  k_filter *out, double * array, size_t size_array );
 //! sets the measured values in the A matrix
@@ -175,6 +308,17 @@ int SetKFilterPMatrix (  k_filter *out, double *array, size_t size_array );
 int SetKFilterQMatrix (  k_filter *out, double *array, size_t size_array );
 //! sets the values in the R matrix
 int SetKFilterRMatrix (  k_filter *out, double *array, size_t size_array );
+//! sets the covariance update formulation and reselects the kernel
+int SetKFilterCovarianceMode (  k_filter *out, int mode );
+//! sets the measurement update formulation and reselects the kernel
+int SetKFilterUpdateMode (  k_filter *out, int mode );
+//! sets which elements of y hold a measurement this step
+int SetKFilterMeasuredMask (  k_filter *out, int *array, size_t size_array );
+//! sets the steady state detection, tolerance 0 disables it
+int SetKFilterSteadyState (  k_filter *out, int norm, double tolerance, int steps, double gate );
+
+//! Select Fcns - choose the kernel used by ComputeKFilter
+int SelectKFilterKernel ( k_filter *out );
 
 //! Update Fcns - updates matrix/array with current values
 
@@ -188,6 +332,8 @@ int ComputeKFilterPMatrix(  k_filter *out );
 int ComputeKFilterAPrioriEstimate(  k_filter *out );
 //! compute the current state estimate
 int ComputeKFilterAPosterioriEstimate(  k_filter *out );
+//! compute one complete filter step
+int ComputeKFilter( k_filter *out );
 
 #endif  //! define FILTER_H
 
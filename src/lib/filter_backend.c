@@ -0,0 +1,298 @@
+//! filter_backend.c
+//!
+//! Kalman filter linear algebra backend Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the linear algebra backends of the Kalman filter.
+
+	The builtin backend is written for the small matrices of a sensor filter:
+	a row by row product and an LU factorization with partial
+	pivoting, the factorization dgesv applies, with pivots stored 1 based as
+	LAPACK does.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>		// strcmp
+#include <math.h>			// fabs
+
+#include "filter_backend.h"
+#include "cpu_dispatch.h"		// instruction set clones of the builtin backend
+
+#if defined(KFILTER_HAVE_CBLAS) || defined(KFILTER_HAVE_ATLAS)
+#include <cblas.h>		// BLAS Level 1 2 3
+#endif
+#ifdef KFILTER_HAVE_ATLAS
+#include <clapack.h>	// Matrix inversions and other higher level Linear algebra functions
+#endif
+
+
+//! row major entry of an n x n matrix
+#define BACKEND_RM(M,n,i,j)			((M)[(i)*(n) + (j)])
+//! column major entry of an n x n matrix
+#define BACKEND_CM(M,n,i,j)			((M)[(i) + (n)*(j)])
+//! row major entry of op(M)
+#define BACKEND_OP(M,n,t,i,j)		( (t) ? BACKEND_RM(M,n,j,i) : BACKEND_RM(M,n,i,j) )
+
+
+//!-------------------------------------------------------
+//! Builtin backend
+//!-------------------------------------------------------
+//! C = alpha op(A) op(B) + beta C
+//! rows of C are accumulated a row of op(B) at a time so the inner loop is contiguous
+static CPU_DISPATCH void MultiplyBuiltin( int trans_a, int trans_b, int n, double alpha,
+																					const double *A, const double *B, double beta, double *C )
+{
+	int i, j, k;
+	double a;
+
+	for (i = 0; i < n; i++)
+	{
+		// beta of 0 ignores C as BLAS does
+		for (j = 0; j < n; j++)
+		{
+			BACKEND_RM(C,n,i,j) = ( beta == 0.0 ) ? 0.0 : beta*BACKEND_RM(C,n,i,j);
+		}
+		for (k = 0; k < n; k++)
+		{
+			a = alpha*BACKEND_OP(A,n,trans_a,i,k);
+			if ( trans_b )
+			{
+				for (j = 0; j < n; j++)
+				{
+					BACKEND_RM(C,n,i,j) += a*BACKEND_RM(B,n,j,k);
+				}
+			}
+			else
+			{
+				for (j = 0; j < n; j++)
+				{
+					BACKEND_RM(C,n,i,j) += a*BACKEND_RM(B,n,k,j);
+				}
+			}
+		}
+	}
+}
+
+//! solves A X = B, X replaces B and the LU factorization replaces A
+static CPU_DISPATCH int SolveBuiltin( int n, double *A, int *pivot_table, double *B )
+{
+	int i, j, k, p;
+	double factor, temp;
+
+	// factor A = P L U
+	for (k = 0; k < n; k++)
+	{
+		// find largest pivot in the column
+		p = k;
+		for (i = k + 1; i < n; i++)
+		{
+			if ( fabs( BACKEND_CM(A,n,i,k) ) > fabs( BACKEND_CM(A,n,p,k) ) )
+			{
+				p = i;
+			}
+		}
+		pivot_table[k] = p + 1;
+		if ( BACKEND_CM(A,n,p,k) == 0.0 )
+		{
+			// singular matrix
+			return -1;
+		}
+		// swap rows into place
+		if ( p != k )
+		{
+			for (j = 0; j < n; j++)
+			{
+				temp = BACKEND_CM(A,n,k,j);	BACKEND_CM(A,n,k,j) = BACKEND_CM(A,n,p,j);	BACKEND_CM(A,n,p,j) = temp;
+				temp = BACKEND_CM(B,n,k,j);	BACKEND_CM(B,n,k,j) = BACKEND_CM(B,n,p,j);	BACKEND_CM(B,n,p,j) = temp;
+			}
+		}
+		// eliminate below the pivot
+		for (i = k + 1; i < n; i++)
+		{
+			factor = BACKEND_CM(A,n,i,k) / BACKEND_CM(A,n,k,k);
+			BACKEND_CM(A,n,i,k) = factor;
+			for (j = k + 1; j < n; j++)
+			{
+				BACKEND_CM(A,n,i,j) -= factor * BACKEND_CM(A,n,k,j);
+			}
+		}
+	}
+
+	// forward and back substitution for every column of B
+	for (j = 0; j < n; j++)
+	{
+		for (i = 1; i < n; i++)
+		{
+			for (k = 0; k < i; k++)
+			{
+				BACKEND_CM(B,n,i,j) -= BACKEND_CM(A,n,i,k) * BACKEND_CM(B,n,k,j);
+			}
+		}
+		for (i = n - 1; i >= 0; i--)
+		{
+			for (k = i + 1; k < n; k++)
+			{
+				BACKEND_CM(B,n,i,j) -= BACKEND_CM(A,n,i,k) * BACKEND_CM(B,n,k,j);
+			}
+			BACKEND_CM(B,n,i,j) /= BACKEND_CM(A,n,i,i);
+		}
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! CBLAS and ATLAS backends
+//!-------------------------------------------------------
+#if defined(KFILTER_HAVE_CBLAS) || defined(KFILTER_HAVE_ATLAS)
+//! C = alpha op(A) op(B) + beta C through cblas_dgemm
+static void MultiplyCBLAS( int trans_a, int trans_b, int n, double alpha,
+													 const double *A, const double *B, double beta, double *C )
+{
+	cblas_dgemm ( CblasRowMajor,
+								trans_a ? CblasTrans : CblasNoTrans,
+								trans_b ? CblasTrans : CblasNoTrans,
+								n, n, n, alpha, A, n, B, n, beta, C, n );
+}
+#endif
+
+#ifdef KFILTER_HAVE_CBLAS
+//! Fortran LAPACK, provided by OpenBLAS and the reference LAPACK
+extern void dgesv_( int *n, int *nrhs, double *a, int *lda, int *ipiv,
+										double *b, int *ldb, int *info );
+
+//! solves A X = B through the Fortran dgesv
+static int SolveLAPACK( int n, double *A, int *pivot_table, double *B )
+{
+	int info = 0;
+
+	dgesv_( &n, &n, A, &n, pivot_table, B, &n, &info );
+
+	return ( info == 0 ) ? 0 : -1;
+}
+#endif
+
+#ifdef KFILTER_HAVE_ATLAS
+//! solves A X = B through the ATLAS clapack_dgesv
+static int SolveATLAS( int n, double *A, int *pivot_table, double *B )
+{
+	return ( clapack_dgesv ( CblasColMajor, n, n, A, n, pivot_table, B, n ) == 0 ) ? 0 : -1;
+}
+#endif
+
+
+//!-------------------------------------------------------
+//! Backend table
+//!-------------------------------------------------------
+//! indexed by KFILTER_BACKEND_*
+static const kfilter_backend kfilter_backends[KFILTER_BACKEND_COUNT] =
+{
+	{ "builtin", 1, MultiplyBuiltin, SolveBuiltin },
+#ifdef KFILTER_HAVE_CBLAS
+	{ "cblas", 1, MultiplyCBLAS, SolveLAPACK },
+#else
+	{ "cblas", 0, NULL, NULL },
+#endif
+#ifdef KFILTER_HAVE_ATLAS
+	{ "atlas", 1, MultiplyCBLAS, SolveATLAS },
+#else
+	{ "atlas", 0, NULL, NULL },
+#endif
+};
+
+//! backend in use, NULL until first resolved, read and written with __atomic
+static const kfilter_backend *kfilter_backend_current = NULL;
+
+
+//! the backend named by KFILTER_BACKEND, else the build default, else the builtin
+static const kfilter_backend * DefaultKFilterBackend( void )
+{
+	const char *name = getenv( "KFILTER_BACKEND" );
+	int i;
+
+	for (i = 0; name != NULL && i < KFILTER_BACKEND_COUNT; i++)
+	{
+		if ( strcmp( name, kfilter_backends[i].name ) == 0 && kfilter_backends[i].available )
+		{
+			return &kfilter_backends[i];
+		}
+	}
+	if ( kfilter_backends[KFILTER_BACKEND_DEFAULT].available )
+	{
+		return &kfilter_backends[KFILTER_BACKEND_DEFAULT];
+	}
+
+	return &kfilter_backends[KFILTER_BACKEND_BUILTIN];
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Functions
+//!-------------------------------------------------------
+//! selects a backend KFILTER_BACKEND_*, -1 if it is not compiled in
+int SetKFilterBackend( int backend )
+{
+	if ( backend < 0 || backend >= KFILTER_BACKEND_COUNT || !kfilter_backends[backend].available )
+	{
+		return -1;
+	}
+
+	__atomic_store_n( &kfilter_backend_current, &kfilter_backends[backend], __ATOMIC_RELEASE );
+
+	return 0;
+}
+
+//! selects a backend by name, -1 if unknown or not compiled in
+int SetKFilterBackendByName( const char *name )
+{
+	int i;
+
+	if ( name == NULL )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < KFILTER_BACKEND_COUNT; i++)
+	{
+		if ( strcmp( name, kfilter_backends[i].name ) == 0 )
+		{
+			return SetKFilterBackend( i );
+		}
+	}
+
+	return -1;
+}
+
+//! backend used by ComputeKFilter, resolved on first call from any thread
+const kfilter_backend * GetKFilterBackend( void )
+{
+	const kfilter_backend *current = __atomic_load_n( &kfilter_backend_current, __ATOMIC_ACQUIRE );
+	const kfilter_backend *expected = NULL;
+
+	if ( current == NULL )
+	{
+		// the first to store wins, a racing caller or SetKFilterBackend included
+		current = DefaultKFilterBackend( );
+		if ( !__atomic_compare_exchange_n( &kfilter_backend_current, &expected, current, 0,
+																			 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+		{
+			current = expected;
+		}
+	}
+
+	return current;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,110 @@
+//! filter_backend.h
+//! Kalman filter linear algebra backend Header File
+//! selects the library behind the matrix products and inverse of ComputeKFilter
+/*! $Id$ */
+
+/*
+
+	The generic path of ComputeKFilter needs two operations: a square matrix
+	product and the solution of a linear system for inv( R + C P trans(C) ).
+	They are reached through a kfilter_backend so the library providing them
+	can be chosen per build and per process:
+
+		KFILTER_BACKEND_BUILTIN	plain loops and an LU solve, no external library
+		KFILTER_BACKEND_CBLAS		any system CBLAS with the Fortran LAPACK dgesv_,
+														e.g. OpenBLAS or the reference BLAS/LAPACK
+		KFILTER_BACKEND_ATLAS		ATLAS cblas_dgemm and clapack_dgesv
+
+	The library backends are only compiled in when the build defines
+	KFILTER_HAVE_CBLAS or KFILTER_HAVE_ATLAS and links the library, as
+	configure --with-backend=atlas|cblas|builtin sets up; programs linking
+	liblocalizer.a take the libraries from pkg-config --libs localizer.
+	KFILTER_BACKEND_DEFAULT names the backend used when nothing else is
+	chosen, otherwise the first of ATLAS, CBLAS and BUILTIN compiled in is
+	used.
+
+	At run time the KFILTER_BACKEND environment variable ("builtin", "cblas"
+	or "atlas") is read on first use, and SetKFilterBackend overrides both.
+	The selection is process wide and should be made before filters step;
+	the first use may come from any thread.
+
+	Multiply works on row major n x n matrices as cblas_dgemm with
+	CblasRowMajor does and Solve on column major matrices as clapack_dgesv
+	with CblasColMajor does, so every backend returns the same results.
+
+*/
+
+//! Includes
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_BACKEND_H
+#define FILTER_BACKEND_H
+
+
+//! Defines
+
+//! linear algebra backends
+#define KFILTER_BACKEND_BUILTIN			0
+#define KFILTER_BACKEND_CBLAS				1
+#define KFILTER_BACKEND_ATLAS				2
+//! number of backends
+#define KFILTER_BACKEND_COUNT				3
+
+//! operand of Multiply used as is or transposed
+#define KFILTER_NOTRANS							0
+#define KFILTER_TRANS								1
+
+//! backend chosen at build time
+#ifndef KFILTER_BACKEND_DEFAULT
+#if defined(KFILTER_HAVE_ATLAS)
+#define KFILTER_BACKEND_DEFAULT			KFILTER_BACKEND_ATLAS
+#elif defined(KFILTER_HAVE_CBLAS)
+#define KFILTER_BACKEND_DEFAULT			KFILTER_BACKEND_CBLAS
+#else
+#define KFILTER_BACKEND_DEFAULT			KFILTER_BACKEND_BUILTIN
+#endif
+#endif
+
+
+//! Data structs
+
+//! data struct linear algebra backend
+typedef struct
+{
+	//! name accepted by the KFILTER_BACKEND environment variable
+	const char *name;
+	//! nonzero when the backend is compiled into this build
+	int available;
+
+	//! METHODS
+
+	//! C = alpha op(A) op(B) + beta C for row major n x n matrices
+	//! C must not alias A or B
+	void (*Multiply)( int trans_a, int trans_b, int n, double alpha,
+										const double *A, const double *B, double beta, double *C );
+	//! solves A X = B for column major n x n matrices, X replaces B
+	//! A is replaced by its LU factorization, returns -1 if A is singular
+	int (*Solve)( int n, double *A, int *pivot_table, double *B );
+
+} kfilter_backend;
+
+
+//! Functions
+
+//! Get/Set Functions
+//! backend used by ComputeKFilter, resolved on first call
+const kfilter_backend * GetKFilterBackend( void );
+//! selects a backend KFILTER_BACKEND_*, -1 if it is not compiled in
+int SetKFilterBackend( int backend );
+//! selects a backend by name, -1 if unknown or not compiled in
+int SetKFilterBackendByName( const char *name );
+
+#endif  //! define FILTER_BACKEND_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
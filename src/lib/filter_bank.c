@@ -0,0 +1,356 @@
+//! filter_bank.c
+//!
+//! Kalman filter bank Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the filter bank, many same sized Kalman filters stepped
+	in lockstep with one filter per lane.
+
+	The group step itself is the template in filter_bank_step.h, shared with
+	the single precision bank of filter_bank_float.c.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_bank.h"
+#include "cpu_dispatch.h"		// instruction set clones of the group step
+
+
+//! lanes per group
+#define BANK_WIDTH							KFILTER_BANK_LANES
+//! lanes of entry (i,j) of a group's n x n matrix M
+#define BANK_ENTRY(M,n,i,j)			((M) + ( (i)*(n) + (j) )*BANK_WIDTH)
+//! lanes of element i of a group's vector v
+#define BANK_ELEMENT(v,i)				((v) + (i)*BANK_WIDTH)
+//! loop over the lanes of a group
+#define BANK_LANES(l)						for (l = 0; l < BANK_WIDTH; l++)
+
+
+//!-------------------------------------------------------
+//! CONSTRUCTORS
+//!-------------------------------------------------------
+k_filter_bank * CreateKFilterBank( void )
+{
+
+	//! assign dynamic memory
+	return( (k_filter_bank *) malloc(sizeof(k_filter_bank)));
+
+}//! end CreateKFilterBank
+
+
+//!-------------------------------------------------------
+//! Arena Fcns - place every array of a bank in one block
+//!-------------------------------------------------------
+//! returns the next region of bytes in arena, or NULL while only sizing
+static double * CarveKFilterBankArena( char *arena, size_t *offset, size_t bytes )
+{
+	double *region = ( arena != NULL ) ? (double *)(arena + *offset) : NULL;
+
+	*offset += KFILTER_ALIGN( bytes );
+
+	return region;
+}
+
+//! aims the members of out into arena and returns the bytes used
+static size_t LayoutKFilterBankArena( k_filter_bank *out, int groups, int n, char *arena )
+{
+	size_t offset = 0;
+	size_t lanes = KFILTER_BANK_LANES * sizeof( double );
+	size_t vector = groups * n * lanes;
+	size_t matrix = groups * n * n * lanes;
+
+	// gain
+	out->P 						= CarveKFilterBankArena( arena, &offset, matrix );
+	out->C 						= CarveKFilterBankArena( arena, &offset, matrix );
+	out->R 						= CarveKFilterBankArena( arena, &offset, matrix );
+	out->K 						= CarveKFilterBankArena( arena, &offset, matrix );
+	// a priori
+	out->A 						= CarveKFilterBankArena( arena, &offset, matrix );
+	out->B 						= CarveKFilterBankArena( arena, &offset, matrix );
+	out->x_hat_ 			= CarveKFilterBankArena( arena, &offset, vector );
+	out->y 						= CarveKFilterBankArena( arena, &offset, vector );
+	out->x_hat 				= CarveKFilterBankArena( arena, &offset, vector );
+	out->u 						= CarveKFilterBankArena( arena, &offset, vector );
+	// covariance
+	out->GQG 					= CarveKFilterBankArena( arena, &offset, matrix );
+	// a posteriori
+	out->y_hat_ 			= CarveKFilterBankArena( arena, &offset, vector );
+	out->y_hat 				= CarveKFilterBankArena( arena, &offset, vector );
+	out->mask 				= CarveKFilterBankArena( arena, &offset, groups * lanes );
+	// computation members, one group's worth
+	out->PC 					= CarveKFilterBankArena( arena, &offset, n * n * lanes );
+	out->S 						= CarveKFilterBankArena( arena, &offset, n * n * lanes );
+	out->AK 					= CarveKFilterBankArena( arena, &offset, n * n * lanes );
+	out->innovation 	= CarveKFilterBankArena( arena, &offset, n * lanes );
+
+	return offset;
+}
+
+//! returns the bytes of arena the bank needs
+size_t SizeKFilterBankArena( int num_filters, int size_matrices )
+{
+	k_filter_bank layout;
+
+	if ( num_filters <= 0 || size_matrices <= 0 )
+	{
+		return 0;
+	}
+
+	return LayoutKFilterBankArena( &layout, ( num_filters + KFILTER_BANK_LANES - 1 ) / KFILTER_BANK_LANES,
+																 size_matrices, NULL );
+}
+
+
+//!-------------------------------------------------------
+//! Init Fcns - dynamically create and clear
+//!-------------------------------------------------------
+//! create num_filters filters of size_matrices in one arena
+int InitKFilterBank ( k_filter_bank *out, int num_filters, int size_matrices )
+{
+	void *arena;
+	size_t bytes = SizeKFilterBankArena( num_filters, size_matrices );
+	int n = size_matrices;
+	int g, i, l;
+
+	if ( bytes == 0 || posix_memalign( &arena, KFILTER_ALIGNMENT, bytes ) != 0 )
+	{
+		return -1;
+	}
+	memset( arena, 0, bytes );
+
+	out->num_filters = num_filters;
+	out->num_elements = n;
+	out->num_groups = ( num_filters + KFILTER_BANK_LANES - 1 ) / KFILTER_BANK_LANES;
+	out->arena = arena;
+	LayoutKFilterBankArena( out, out->num_groups, n, (char *)arena );
+
+	// identity model and covariance as ZeroKFilter sets them, padding lanes included
+	for (g = 0; g < out->num_groups; g++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			BANK_LANES(l)
+			{
+				BANK_ENTRY(out->A + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+				BANK_ENTRY(out->B + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+				BANK_ENTRY(out->C + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+				BANK_ENTRY(out->GQG + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] = 1.0;
+				BANK_ENTRY(out->K + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+				BANK_ENTRY(out->P + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+				BANK_ENTRY(out->R + g*n*n*KFILTER_BANK_LANES,n,i,i)[l] 	= 1.0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Destructors
+//!-------------------------------------------------------
+//! release what InitKFilterBank allocated
+int DestroyKFilterBank ( k_filter_bank *out )
+{
+	if ( out->arena == NULL )
+	{
+		// already destroyed
+		return -1;
+	}
+
+	free( out->arena );
+
+	out->arena = NULL;
+	out->num_filters = 0;
+	out->num_groups = 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Functions
+//!-------------------------------------------------------
+//! entry (i,j) of filter index in interleaved matrix M
+static double * KFilterBankEntry( k_filter_bank *in, double *M, int index, int i, int j )
+{
+	int n = in->num_elements;
+	int g = index / KFILTER_BANK_LANES;
+
+	return BANK_ENTRY(M + g*n*n*KFILTER_BANK_LANES,n,i,j) + index % KFILTER_BANK_LANES;
+}
+
+//! element i of filter index in interleaved vector v
+static double * KFilterBankElement( k_filter_bank *in, double *v, int index, int i )
+{
+	int n = in->num_elements;
+	int g = index / KFILTER_BANK_LANES;
+
+	return BANK_ELEMENT(v + g*n*KFILTER_BANK_LANES,i) + index % KFILTER_BANK_LANES;
+}
+
+//! loads filter index of the bank from a k_filter of the same size
+int SetKFilterBankFilter ( k_filter_bank *out, int index, k_filter *in )
+{
+	int n = out->num_elements;
+	int i, j, k, m;
+	double sum;
+
+	if ( index < 0 || index >= out->num_filters || in->num_elements != n )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			*KFilterBankEntry( out, out->A, index, i, j ) = in->A[i*n + j];
+			*KFilterBankEntry( out, out->B, index, i, j ) = in->B[i*n + j];
+			*KFilterBankEntry( out, out->C, index, i, j ) = in->C[i*n + j];
+			*KFilterBankEntry( out, out->K, index, i, j ) = in->K[i*n + j];
+			*KFilterBankEntry( out, out->P, index, i, j ) = in->P[i*n + j];
+			*KFilterBankEntry( out, out->R, index, i, j ) = in->R[i*n + j];
+
+			// G Q trans(G)
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				for (m = 0; m < n; m++)
+				{
+					sum += in->G[i*n + k] * in->Q[k*n + m] * in->G[j*n + m];
+				}
+			}
+			*KFilterBankEntry( out, out->GQG, index, i, j ) = sum;
+		}
+		*KFilterBankElement( out, out->x_hat, index, i ) 	= in->x_hat[i];
+		*KFilterBankElement( out, out->x_hat_, index, i ) = in->x_hat_[i];
+		*KFilterBankElement( out, out->y, index, i ) 			= in->y[i];
+		*KFilterBankElement( out, out->u, index, i ) 			= in->u[i];
+		*KFilterBankElement( out, out->y_hat, index, i ) 	= in->y_hat[i];
+		*KFilterBankElement( out, out->y_hat_, index, i ) = in->y_hat_[i];
+	}
+
+	return 0;
+}
+
+//! stores P, K and the estimates of filter index into a k_filter of the same size
+int GetKFilterBankFilter ( k_filter_bank *in, int index, k_filter *out )
+{
+	int n = in->num_elements;
+	int i, j;
+
+	if ( index < 0 || index >= in->num_filters || out->num_elements != n )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			out->K[i*n + j] = *KFilterBankEntry( in, in->K, index, i, j );
+			out->P[i*n + j] = *KFilterBankEntry( in, in->P, index, i, j );
+		}
+		out->x_hat[i] 	= *KFilterBankElement( in, in->x_hat, index, i );
+		out->x_hat_[i] 	= *KFilterBankElement( in, in->x_hat_, index, i );
+		out->y_hat[i] 	= *KFilterBankElement( in, in->y_hat, index, i );
+		out->y_hat_[i] 	= *KFilterBankElement( in, in->y_hat_, index, i );
+	}
+
+	return 0;
+}
+
+//! sets the measured values of filter index
+int SetKFilterBankMeasured ( k_filter_bank *out, int index, double *array, size_t size_array )
+{
+	int i;
+
+	if ( index < 0 || index >= out->num_filters || size_array < out->num_elements * sizeof( double ) )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < out->num_elements; i++)
+	{
+		*KFilterBankElement( out, out->y, index, i ) = array[i];
+	}
+
+	return 0;
+}
+
+//! copies the a posteriori estimate of filter index into array
+int GetKFilterBankEstimate ( k_filter_bank *in, int index, double *array, size_t size_array )
+{
+	int i;
+
+	if ( index < 0 || index >= in->num_filters || size_array < in->num_elements * sizeof( double ) )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < in->num_elements; i++)
+	{
+		array[i] = *KFilterBankElement( in, in->x_hat, index, i );
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+//! group step in double, see filter_bank_step.h
+#define BANK_REAL			double
+#define BANK_TYPE			k_filter_bank
+#define BANK_STEP			ComputeKFilterBankGroup
+#include "filter_bank_step.h"
+
+//! one step of every filter
+int ComputeKFilterBank ( k_filter_bank *out, double *measurements, int *mask )
+{
+	int n = out->num_elements;
+	int f, g, i;
+	int status = 0;
+
+	if ( out->arena == NULL )
+	{
+		return -1;
+	}
+
+	// scatter the measurements and mask into the lanes, padding lanes predict only
+	for (f = 0; f < out->num_groups*KFILTER_BANK_LANES; f++)
+	{
+		if ( f < out->num_filters && measurements != NULL )
+		{
+			for (i = 0; i < n; i++)
+			{
+				*KFilterBankElement( out, out->y, f, i ) = measurements[f*n + i];
+			}
+		}
+		out->mask[f] = ( f < out->num_filters && ( mask == NULL || mask[f] != 0 ) ) ? 1.0 : 0.0;
+	}
+
+	for (g = 0; g < out->num_groups; g++)
+	{
+		if ( ComputeKFilterBankGroup( out, g ) != 0 )
+		{
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,140 @@
+//! filter_bank.h
+//! Kalman filter bank Header File
+//! steps many filters of one size together, one filter per SIMD lane
+/*! $Id$ */
+
+/*
+
+	A process running many localizers steps many small filters of the same
+	size, each on its own.  At n = 4 or 7 a single filter is too small to
+	fill a vector register, but the same operation on eight filters is not.
+
+	A k_filter_bank holds num_filters filters of num_elements transducers
+	interleaved in groups of KFILTER_BANK_LANES: entry (i,j) of a matrix of
+	filter f is
+
+		M[ ( ( g*n + i )*n + j )*KFILTER_BANK_LANES + l ]		g = f / LANES, l = f % LANES
+
+	in the row major view of the filter kernels, and entry i of a vector is
+	v[ ( g*n + i )*KFILTER_BANK_LANES + l ].  Every step of the filter is then
+	a loop over the eight lanes of one cache line, which the compiler turns
+	into vector instructions at any width.
+
+	ComputeKFilterBank steps every filter through the equations of
+	ComputeKFilter in the general covariance mode.  inv( R + C P trans(C) )
+	is applied through an L D trans(L) factorization, which needs no pivoting
+	or square roots and so runs branch free across the lanes.  A filter whose
+	innovation covariance is not positive definite only predicts that step.
+
+	Filters are loaded from and stored back to k_filter instances, or fed
+	measurements directly.  A filter masked off for a step predicts only,
+	as with K = 0.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+
+//! Defines
+
+//! filters per interleaved group, one cache line of doubles
+#define KFILTER_BANK_LANES					8
+
+
+//! Data structs
+
+//! data struct bank of Kalman filters
+typedef struct
+{
+	//! number of filters in the bank
+	int num_filters;
+	//! number elements  dimension of the matrices of every filter
+	int num_elements;
+	//! groups of KFILTER_BANK_LANES filters, the last one padded
+	int num_groups;
+	//! block holding every array below, see SizeKFilterBankArena
+	void *arena;
+
+	//! interleaved matrix members
+	double *A;		//! state transition matrix
+	double *B;		//! control input matrix
+	double *C;		//! output matrix
+	double *GQG;	//! G Q trans(G)
+	double *K;		//! Kalman gain matrix
+	double *P;		//! state covariance matrix
+	double *R;		//! measurement noise covariance matrix
+
+	//! interleaved array members
+	//! a posteriori state estimate
+	double *x_hat;
+	//! a priori state estimate
+	double *x_hat_;
+	//! measured data of the transducers
+	double *y;
+	//! control input vector u
+	double *u;
+	// estimated delta y measurement
+	double *y_hat;
+	// prefactor to final estimate of y
+	double *y_hat_;
+	//! 1 for each filter updated this step, 0 for predict only
+	double *mask;
+
+	// computation members shared by the groups
+	//! holds P trans(C), then K C P and P - K C P
+	double *PC;
+	//! holds the factored R + C P trans(C), then C P and ( P - K C P ) trans(A)
+	double *S;
+	//! holds AK
+	double *AK;
+	//! holds y - x_hat_
+	double *innovation;
+
+} k_filter_bank;
+
+
+//! Functions
+
+//! Constructors - create data structs
+k_filter_bank * CreateKFilterBank( void );	//! creates and returns dynamic memory
+
+//! Init Fcns
+//! create num_filters filters of size_matrices in one arena, each as ZeroKFilter leaves it
+int InitKFilterBank ( k_filter_bank *out, int num_filters, int size_matrices );
+//! bytes of arena needed by the bank
+size_t SizeKFilterBankArena( int num_filters, int size_matrices );
+
+//! Destructors
+//! release what InitKFilterBank allocated
+int DestroyKFilterBank ( k_filter_bank *out );
+
+//! Get/Set Functions
+//! loads filter index of the bank from a k_filter of the same size
+int SetKFilterBankFilter ( k_filter_bank *out, int index, k_filter *in );
+//! stores P, K and the estimates of filter index into a k_filter of the same size
+int GetKFilterBankFilter ( k_filter_bank *in, int index, k_filter *out );
+//! sets the measured values of filter index
+int SetKFilterBankMeasured ( k_filter_bank *out, int index, double *array, size_t size_array );
+//! copies the a posteriori estimate of filter index into array
+int GetKFilterBankEstimate ( k_filter_bank *in, int index, double *array, size_t size_array );
+
+//! Compute Fcns
+//! one step of every filter
+//! measurements holds num_filters vectors of y one after another, NULL keeps y
+//! mask holds num_filters flags, 0 predicts only, NULL updates all
+//! returns -1 if any updated filter had to skip its update
+int ComputeKFilterBank ( k_filter_bank *out, double *measurements, int *mask );
+
+#endif  //! define FILTER_BANK_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
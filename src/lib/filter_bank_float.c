@@ -0,0 +1,564 @@
+//! filter_bank_float.c
+//!
+//! single precision Kalman filter bank Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the filter bank in float.  The group step is the
+	template of filter_bank_step.h with its health checks, around which this
+	file promotes the filters that fail them to double k_filter instances.
+
+	Before a group steps its P is kept in P_, so a filter that turns
+	unhealthy is promoted from the state it had before the step and steps
+	that step again in double.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <math.h>			// HUGE_VAL
+
+#include "filter_bank_float.h"
+#include "cpu_dispatch.h"		// instruction set clones of the group step
+
+
+//! lanes per group
+#define BANK_WIDTH							KFILTER_BANK_FLOAT_LANES
+//! lanes of entry (i,j) of a group's n x n matrix M
+#define BANK_ENTRY(M,n,i,j)			((M) + ( (i)*(n) + (j) )*BANK_WIDTH)
+//! lanes of element i of a group's vector v
+#define BANK_ELEMENT(v,i)				((v) + (i)*BANK_WIDTH)
+//! loop over the lanes of a group
+#define BANK_LANES(l)						for (l = 0; l < BANK_WIDTH; l++)
+
+
+//!-------------------------------------------------------
+//! CONSTRUCTORS
+//!-------------------------------------------------------
+k_filter_bank_float * CreateKFilterBankFloat( void )
+{
+
+	//! assign dynamic memory
+	return( (k_filter_bank_float *) malloc(sizeof(k_filter_bank_float)));
+
+}//! end CreateKFilterBankFloat
+
+
+//!-------------------------------------------------------
+//! Arena Fcns - place every array of a bank in one block
+//!-------------------------------------------------------
+//! returns the next region of bytes in arena, or NULL while only sizing
+static void * CarveKFilterBankFloatArena( char *arena, size_t *offset, size_t bytes )
+{
+	void *region = ( arena != NULL ) ? (void *)(arena + *offset) : NULL;
+
+	*offset += KFILTER_ALIGN( bytes );
+
+	return region;
+}
+
+//! aims the members of out into arena and returns the bytes used
+static size_t LayoutKFilterBankFloatArena( k_filter_bank_float *out, int num_filters, int groups, int n, char *arena )
+{
+	size_t offset = 0;
+	size_t lanes = KFILTER_BANK_FLOAT_LANES * sizeof( float );
+	size_t vector = groups * n * lanes;
+	size_t matrix = groups * n * n * lanes;
+
+	// gain
+	out->P 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	out->C 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	out->R 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	out->K 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	// a priori
+	out->A 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	out->B 						= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	out->x_hat_ 			= CarveKFilterBankFloatArena( arena, &offset, vector );
+	out->y 						= CarveKFilterBankFloatArena( arena, &offset, vector );
+	out->x_hat 				= CarveKFilterBankFloatArena( arena, &offset, vector );
+	out->u 						= CarveKFilterBankFloatArena( arena, &offset, vector );
+	// covariance
+	out->GQG 					= CarveKFilterBankFloatArena( arena, &offset, matrix );
+	// a posteriori
+	out->y_hat_ 			= CarveKFilterBankFloatArena( arena, &offset, vector );
+	out->y_hat 				= CarveKFilterBankFloatArena( arena, &offset, vector );
+	out->mask 				= CarveKFilterBankFloatArena( arena, &offset, groups * lanes );
+	// health
+	out->condition 		= CarveKFilterBankFloatArena( arena, &offset, groups * lanes );
+	out->healthy 			= CarveKFilterBankFloatArena( arena, &offset, groups * lanes );
+	out->fallback 		= CarveKFilterBankFloatArena( arena, &offset, num_filters * sizeof( k_filter * ) );
+	// computation members, one group's worth
+	out->PC 					= CarveKFilterBankFloatArena( arena, &offset, n * n * lanes );
+	out->S 						= CarveKFilterBankFloatArena( arena, &offset, n * n * lanes );
+	out->AK 					= CarveKFilterBankFloatArena( arena, &offset, n * n * lanes );
+	out->innovation 	= CarveKFilterBankFloatArena( arena, &offset, n * lanes );
+	out->P_ 					= CarveKFilterBankFloatArena( arena, &offset, n * n * lanes );
+
+	return offset;
+}
+
+//! returns the bytes of arena the bank needs
+size_t SizeKFilterBankFloatArena( int num_filters, int size_matrices )
+{
+	k_filter_bank_float layout;
+
+	if ( num_filters <= 0 || size_matrices <= 0 )
+	{
+		return 0;
+	}
+
+	return LayoutKFilterBankFloatArena( &layout, num_filters,
+																			( num_filters + KFILTER_BANK_FLOAT_LANES - 1 ) / KFILTER_BANK_FLOAT_LANES,
+																			size_matrices, NULL );
+}
+
+
+//!-------------------------------------------------------
+//! Lane Fcns - the lanes of one filter
+//!-------------------------------------------------------
+//! entry (i,j) of filter index in interleaved matrix M
+static float * KFilterBankFloatEntry( k_filter_bank_float *in, float *M, int index, int i, int j )
+{
+	int n = in->num_elements;
+	int g = index / KFILTER_BANK_FLOAT_LANES;
+
+	return BANK_ENTRY(M + g*n*n*KFILTER_BANK_FLOAT_LANES,n,i,j) + index % KFILTER_BANK_FLOAT_LANES;
+}
+
+//! element i of filter index in interleaved vector v
+static float * KFilterBankFloatElement( k_filter_bank_float *in, float *v, int index, int i )
+{
+	int n = in->num_elements;
+	int g = index / KFILTER_BANK_FLOAT_LANES;
+
+	return BANK_ELEMENT(v + g*n*KFILTER_BANK_FLOAT_LANES,i) + index % KFILTER_BANK_FLOAT_LANES;
+}
+
+//! loads the lane of filter index with the identity model and covariance of ZeroKFilter
+static void ClearKFilterBankFloatLane( k_filter_bank_float *out, int index )
+{
+	int n = out->num_elements;
+	int i, j;
+	float diagonal;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			diagonal = ( i == j ) ? 1.0f : 0.0f;
+			*KFilterBankFloatEntry( out, out->A, index, i, j ) 	= diagonal;
+			*KFilterBankFloatEntry( out, out->B, index, i, j ) 	= diagonal;
+			*KFilterBankFloatEntry( out, out->C, index, i, j ) 	= diagonal;
+			*KFilterBankFloatEntry( out, out->GQG, index, i, j ) = diagonal;
+			*KFilterBankFloatEntry( out, out->K, index, i, j ) 	= diagonal;
+			*KFilterBankFloatEntry( out, out->P, index, i, j ) 	= diagonal;
+			*KFilterBankFloatEntry( out, out->R, index, i, j ) 	= diagonal;
+		}
+		*KFilterBankFloatElement( out, out->x_hat, index, i ) 	= 0.0f;
+		*KFilterBankFloatElement( out, out->x_hat_, index, i ) 	= 0.0f;
+		*KFilterBankFloatElement( out, out->y, index, i ) 			= 0.0f;
+		*KFilterBankFloatElement( out, out->u, index, i ) 			= 0.0f;
+		*KFilterBankFloatElement( out, out->y_hat, index, i ) 	= 0.0f;
+		*KFilterBankFloatElement( out, out->y_hat_, index, i ) 	= 0.0f;
+	}
+}
+
+
+//!-------------------------------------------------------
+//! Init Fcns - dynamically create and clear
+//!-------------------------------------------------------
+//! create num_filters filters of size_matrices in one arena
+int InitKFilterBankFloat ( k_filter_bank_float *out, int num_filters, int size_matrices )
+{
+	void *arena;
+	size_t bytes = SizeKFilterBankFloatArena( num_filters, size_matrices );
+	int f;
+
+	if ( bytes == 0 || posix_memalign( &arena, KFILTER_ALIGNMENT, bytes ) != 0 )
+	{
+		return -1;
+	}
+	memset( arena, 0, bytes );
+
+	out->num_filters = num_filters;
+	out->num_elements = size_matrices;
+	out->num_groups = ( num_filters + KFILTER_BANK_FLOAT_LANES - 1 ) / KFILTER_BANK_FLOAT_LANES;
+	out->arena = arena;
+	out->condition_limit = KFILTER_BANK_CONDITION_LIMIT;
+	LayoutKFilterBankFloatArena( out, num_filters, out->num_groups, size_matrices, (char *)arena );
+
+	// identity model and covariance as ZeroKFilter sets them, padding lanes included
+	for (f = 0; f < out->num_groups*KFILTER_BANK_FLOAT_LANES; f++)
+	{
+		ClearKFilterBankFloatLane( out, f );
+		out->healthy[f] = 1.0f;
+	}
+	for (f = 0; f < num_filters; f++)
+	{
+		out->fallback[f] = NULL;
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Destructors
+//!-------------------------------------------------------
+//! releases the double filter of index, if it has one
+static void DemoteKFilterBankFloat( k_filter_bank_float *out, int index )
+{
+	if ( out->fallback[index] != NULL )
+	{
+		DestroyKFilter( out->fallback[index] );
+		free( out->fallback[index] );
+		out->fallback[index] = NULL;
+	}
+}
+
+//! release what InitKFilterBankFloat allocated, promoted filters included
+int DestroyKFilterBankFloat ( k_filter_bank_float *out )
+{
+	int f;
+
+	if ( out->arena == NULL )
+	{
+		// already destroyed
+		return -1;
+	}
+
+	for (f = 0; f < out->num_filters; f++)
+	{
+		DemoteKFilterBankFloat( out, f );
+	}
+	free( out->arena );
+
+	out->arena = NULL;
+	out->num_filters = 0;
+	out->num_groups = 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Functions
+//!-------------------------------------------------------
+//! loads filter index of the bank from a k_filter of the same size, back into float if promoted
+int SetKFilterBankFloatFilter ( k_filter_bank_float *out, int index, k_filter *in )
+{
+	int n = out->num_elements;
+	int i, j, k, m;
+	double sum;
+
+	if ( index < 0 || index >= out->num_filters || in->num_elements != n )
+	{
+		return -1;
+	}
+
+	DemoteKFilterBankFloat( out, index );
+	out->healthy[index] = 1.0f;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			*KFilterBankFloatEntry( out, out->A, index, i, j ) = (float)in->A[i*n + j];
+			*KFilterBankFloatEntry( out, out->B, index, i, j ) = (float)in->B[i*n + j];
+			*KFilterBankFloatEntry( out, out->C, index, i, j ) = (float)in->C[i*n + j];
+			*KFilterBankFloatEntry( out, out->K, index, i, j ) = (float)in->K[i*n + j];
+			*KFilterBankFloatEntry( out, out->P, index, i, j ) = (float)in->P[i*n + j];
+			*KFilterBankFloatEntry( out, out->R, index, i, j ) = (float)in->R[i*n + j];
+
+			// G Q trans(G), summed in double
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				for (m = 0; m < n; m++)
+				{
+					sum += in->G[i*n + k] * in->Q[k*n + m] * in->G[j*n + m];
+				}
+			}
+			*KFilterBankFloatEntry( out, out->GQG, index, i, j ) = (float)sum;
+		}
+		*KFilterBankFloatElement( out, out->x_hat, index, i ) 	= (float)in->x_hat[i];
+		*KFilterBankFloatElement( out, out->x_hat_, index, i ) 	= (float)in->x_hat_[i];
+		*KFilterBankFloatElement( out, out->y, index, i ) 			= (float)in->y[i];
+		*KFilterBankFloatElement( out, out->u, index, i ) 			= (float)in->u[i];
+		*KFilterBankFloatElement( out, out->y_hat, index, i ) 	= (float)in->y_hat[i];
+		*KFilterBankFloatElement( out, out->y_hat_, index, i ) 	= (float)in->y_hat_[i];
+	}
+
+	return 0;
+}
+
+//! stores P, K and the estimates of filter index into a k_filter of the same size
+int GetKFilterBankFloatFilter ( k_filter_bank_float *in, int index, k_filter *out )
+{
+	int n = in->num_elements;
+	k_filter *fallback;
+	int i, j;
+
+	if ( index < 0 || index >= in->num_filters || out->num_elements != n )
+	{
+		return -1;
+	}
+
+	fallback = in->fallback[index];
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			out->K[i*n + j] = ( fallback != NULL ) ? fallback->K[i*n + j] : *KFilterBankFloatEntry( in, in->K, index, i, j );
+			out->P[i*n + j] = ( fallback != NULL ) ? fallback->P[i*n + j] : *KFilterBankFloatEntry( in, in->P, index, i, j );
+		}
+		out->x_hat[i] 	= ( fallback != NULL ) ? fallback->x_hat[i] 	: *KFilterBankFloatElement( in, in->x_hat, index, i );
+		out->x_hat_[i] 	= ( fallback != NULL ) ? fallback->x_hat_[i] 	: *KFilterBankFloatElement( in, in->x_hat_, index, i );
+		out->y_hat[i] 	= ( fallback != NULL ) ? fallback->y_hat[i] 	: *KFilterBankFloatElement( in, in->y_hat, index, i );
+		out->y_hat_[i] 	= ( fallback != NULL ) ? fallback->y_hat_[i] 	: *KFilterBankFloatElement( in, in->y_hat_, index, i );
+	}
+
+	return 0;
+}
+
+//! sets the measured values of filter index
+int SetKFilterBankFloatMeasured ( k_filter_bank_float *out, int index, double *array, size_t size_array )
+{
+	int i;
+
+	if ( index < 0 || index >= out->num_filters || size_array < out->num_elements * sizeof( double ) )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < out->num_elements; i++)
+	{
+		if ( out->fallback[index] != NULL )
+		{
+			out->fallback[index]->y[i] = array[i];
+		}
+		else
+		{
+			*KFilterBankFloatElement( out, out->y, index, i ) = (float)array[i];
+		}
+	}
+
+	return 0;
+}
+
+//! copies the a posteriori estimate of filter index into array
+int GetKFilterBankFloatEstimate ( k_filter_bank_float *in, int index, double *array, size_t size_array )
+{
+	int i;
+
+	if ( index < 0 || index >= in->num_filters || size_array < in->num_elements * sizeof( double ) )
+	{
+		return -1;
+	}
+
+	for (i = 0; i < in->num_elements; i++)
+	{
+		array[i] = ( in->fallback[index] != NULL ) ? in->fallback[index]->x_hat[i]
+																							 : *KFilterBankFloatElement( in, in->x_hat, index, i );
+	}
+
+	return 0;
+}
+
+//! sets the largest condition estimate stepped in float
+int SetKFilterBankFloatConditionLimit ( k_filter_bank_float *out, double limit )
+{
+	if ( !( limit >= 1.0 ) )
+	{
+		// no matrix is better conditioned than the identity
+		return -1;
+	}
+
+	out->condition_limit = limit;
+
+	return 0;
+}
+
+//! condition estimate of filter index at the last step in float, and 1 in promoted once it steps in double
+int GetKFilterBankFloatHealth ( k_filter_bank_float *in, int index, double *condition, int *promoted )
+{
+	if ( index < 0 || index >= in->num_filters )
+	{
+		return -1;
+	}
+
+	// the lane of a promoted filter steps the identity filter, its condition means nothing
+	*promoted = ( in->fallback[index] != NULL );
+	*condition = *promoted ? 0.0 : in->condition[index];
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+//! group step in float with the health checks, see filter_bank_step.h
+#define BANK_REAL			float
+#define BANK_TYPE			k_filter_bank_float
+#define BANK_STEP			ComputeKFilterBankFloatGroup
+#define BANK_HEALTH
+#include "filter_bank_step.h"
+
+//! one step of a double filter, predict only as with K = 0 unless update
+static int StepKFilterBankFloatFallback( k_filter *out, int update )
+{
+	if ( update )
+	{
+		return ComputeKFilter( out );
+	}
+
+	memset( out->K, 0, out->num_elements * out->num_elements * sizeof( double ) );
+	ComputeKFilterAPrioriEstimate( out );
+	ComputeKFilterPMatrix( out );
+	ComputeKFilterAPosterioriEstimate( out );
+
+	return 0;
+}
+
+//! sets a matrix of out from lane l of the group matrix M, the setters take the transpose
+static int PromoteKFilterBankFloatMatrix( k_filter *out, int (*Set)( k_filter *, double *, size_t ),
+																					float *M, int l, double *scratch )
+{
+	int n = out->num_elements;
+	int i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			scratch[j*n + i] = ( M != NULL ) ? BANK_ENTRY(M,n,i,j)[l] : ( i == j );
+		}
+	}
+
+	return Set( out, scratch, n * n * sizeof( double ) );
+}
+
+//! moves filter index, just stepped, to a double k_filter set to its state before the step
+static int PromoteKFilterBankFloat( k_filter_bank_float *out, int index )
+{
+	int n = out->num_elements;
+	int g = index / KFILTER_BANK_FLOAT_LANES;
+	int l = index % KFILTER_BANK_FLOAT_LANES;
+	size_t group = g*n*n*KFILTER_BANK_FLOAT_LANES;
+	k_filter *fallback;
+	double *scratch;
+	int i;
+
+	fallback = CreateKFilter();
+	scratch = (double *) malloc( n * n * sizeof( double ) );
+	if ( fallback == NULL || scratch == NULL || InitKFilter( fallback, n ) != 0 )
+	{
+		free( fallback );
+		free( scratch );
+		return -1;
+	}
+
+	// model as stepped, G Q trans(G) as Q with G = I, P from before the step
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterAMatrix, out->A + group, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterBMatrix, out->B + group, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterCMatrix, out->C + group, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterRMatrix, out->R + group, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterGMatrix, NULL, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterQMatrix, out->GQG + group, l, scratch );
+	PromoteKFilterBankFloatMatrix( fallback, SetKFilterPMatrix, out->P_, l, scratch );
+
+	// the step left the estimate it started from in x_hat_
+	for (i = 0; i < n; i++)
+	{
+		fallback->x_hat[i] 	= *KFilterBankFloatElement( out, out->x_hat_, index, i );
+		fallback->x_hat_[i] = fallback->x_hat[i];
+		fallback->y[i] 			= *KFilterBankFloatElement( out, out->y, index, i );
+		fallback->u[i] 			= *KFilterBankFloatElement( out, out->u, index, i );
+	}
+	// the bank has no steady state gain
+	SetKFilterSteadyState( fallback, KFILTER_NORM_MAX, 0.0, KFILTER_STEADY_STEPS, KFILTER_STEADY_GATE );
+
+	free( scratch );
+	out->fallback[index] = fallback;
+	ClearKFilterBankFloatLane( out, index );
+
+	return 0;
+}
+
+//! one step of every filter, promoting those that turn unhealthy
+int ComputeKFilterBankFloat ( k_filter_bank_float *out, double *measurements, int *mask )
+{
+	int n = out->num_elements;
+	int f, g, i, l;
+	int status = 0;
+
+	if ( out->arena == NULL )
+	{
+		return -1;
+	}
+
+	// scatter the measurements and mask into the lanes, padding and promoted lanes predict only
+	for (f = 0; f < out->num_groups*KFILTER_BANK_FLOAT_LANES; f++)
+	{
+		if ( f < out->num_filters && measurements != NULL )
+		{
+			for (i = 0; i < n; i++)
+			{
+				if ( out->fallback[f] != NULL )
+				{
+					out->fallback[f]->y[i] = measurements[f*n + i];
+				}
+				else
+				{
+					*KFilterBankFloatElement( out, out->y, f, i ) = (float)measurements[f*n + i];
+				}
+			}
+		}
+		out->mask[f] = ( f < out->num_filters && out->fallback[f] == NULL
+										 && ( mask == NULL || mask[f] != 0 ) ) ? 1.0f : 0.0f;
+	}
+
+	// filters promoted at earlier steps
+	for (f = 0; f < out->num_filters; f++)
+	{
+		if ( out->fallback[f] != NULL
+				 && StepKFilterBankFloatFallback( out->fallback[f], mask == NULL || mask[f] != 0 ) != 0 )
+		{
+			status = -1;
+		}
+	}
+
+	for (g = 0; g < out->num_groups; g++)
+	{
+		memcpy( out->P_, out->P + g*n*n*KFILTER_BANK_FLOAT_LANES, n*n*KFILTER_BANK_FLOAT_LANES*sizeof( float ) );
+		ComputeKFilterBankFloatGroup( out, g );
+
+		// filters that turned unhealthy take this step again in double
+		for (l = 0; l < KFILTER_BANK_FLOAT_LANES; l++)
+		{
+			f = g*KFILTER_BANK_FLOAT_LANES + l;
+			if ( f >= out->num_filters || out->fallback[f] != NULL || out->healthy[f] != 0.0f )
+			{
+				continue;
+			}
+			if ( PromoteKFilterBankFloat( out, f ) != 0
+					 || StepKFilterBankFloatFallback( out->fallback[f], mask == NULL || mask[f] != 0 ) != 0 )
+			{
+				status = -1;
+			}
+		}
+	}
+
+	return status;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
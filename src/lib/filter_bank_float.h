@@ -0,0 +1,156 @@
+//! filter_bank_float.h
+//! single precision Kalman filter bank Header File
+//! a filter bank in float that hands unhealthy filters to double
+/*! $Id$ */
+
+/*
+
+	A k_filter_bank_float is the filter bank of filter_bank.h stored and
+	stepped in float.  A cache line holds sixteen lanes instead of eight, so
+	each group steps twice the filters in the same instructions and the bank
+	takes half the memory.
+
+	Single precision loses a filter that is poorly conditioned, so every step
+	also checks the health of each filter:
+
+		the condition of R + C P trans(C), its 1-norm times Hager's estimate
+		of the 1-norm of its inverse from its L D trans(L), must stay under
+		condition_limit
+
+		the new P must stay positive definite
+
+	A filter that fails either check is promoted to a double k_filter.  Its
+	step is taken again in double from the state before the step, and it
+	steps in double from then on while its lane in the bank lies idle.
+	Loading the filter again with SetKFilterBankFloatFilter returns it to the
+	bank.
+
+	Filters are loaded from and stored back to k_filter instances in double,
+	as with the double bank.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_BANK_FLOAT_H
+#define FILTER_BANK_FLOAT_H
+
+
+//! Defines
+
+//! filters per interleaved group, one cache line of floats
+#define KFILTER_BANK_FLOAT_LANES			16
+//! largest condition estimate of R + C P trans(C) stepped in float
+#define KFILTER_BANK_CONDITION_LIMIT	1.0e5
+
+
+//! Data structs
+
+//! data struct single precision bank of Kalman filters
+typedef struct
+{
+	//! number of filters in the bank
+	int num_filters;
+	//! number elements  dimension of the matrices of every filter
+	int num_elements;
+	//! groups of KFILTER_BANK_FLOAT_LANES filters, the last one padded
+	int num_groups;
+	//! block holding every array below, see SizeKFilterBankFloatArena
+	void *arena;
+
+	//! interleaved matrix members
+	float *A;			//! state transition matrix
+	float *B;			//! control input matrix
+	float *C;			//! output matrix
+	float *GQG;		//! G Q trans(G)
+	float *K;			//! Kalman gain matrix
+	float *P;			//! state covariance matrix
+	float *R;			//! measurement noise covariance matrix
+
+	//! interleaved array members
+	//! a posteriori state estimate
+	float *x_hat;
+	//! a priori state estimate
+	float *x_hat_;
+	//! measured data of the transducers
+	float *y;
+	//! control input vector u
+	float *u;
+	// estimated delta y measurement
+	float *y_hat;
+	// prefactor to final estimate of y
+	float *y_hat_;
+	//! 1 for each filter updated this step, 0 for predict only
+	float *mask;
+
+	//! health members
+	//! condition estimate of R + C P trans(C) at the last step
+	float *condition;
+	//! 1 while a filter passes both checks, 0 once it fails one
+	float *healthy;
+	//! largest condition stepped in float, KFILTER_BANK_CONDITION_LIMIT by default
+	double condition_limit;
+	//! double filter stepping in place of each filter, NULL while it steps in float
+	k_filter **fallback;
+
+	// computation members shared by the groups
+	//! holds P trans(C), then K C P and P - K C P
+	float *PC;
+	//! holds the factored R + C P trans(C), then C P and ( P - K C P ) trans(A)
+	float *S;
+	//! holds AK
+	float *AK;
+	//! holds y - x_hat_
+	float *innovation;
+	//! P of the group before its step, the starting point of a promotion
+	float *P_;
+
+} k_filter_bank_float;
+
+
+//! Functions
+
+//! Constructors - create data structs
+k_filter_bank_float * CreateKFilterBankFloat( void );	//! creates and returns dynamic memory
+
+//! Init Fcns
+//! create num_filters filters of size_matrices in one arena, each as ZeroKFilter leaves it
+int InitKFilterBankFloat ( k_filter_bank_float *out, int num_filters, int size_matrices );
+//! bytes of arena needed by the bank
+size_t SizeKFilterBankFloatArena( int num_filters, int size_matrices );
+
+//! Destructors
+//! release what InitKFilterBankFloat allocated, promoted filters included
+int DestroyKFilterBankFloat ( k_filter_bank_float *out );
+
+//! Get/Set Functions
+//! loads filter index of the bank from a k_filter of the same size, back into float if promoted
+int SetKFilterBankFloatFilter ( k_filter_bank_float *out, int index, k_filter *in );
+//! stores P, K and the estimates of filter index into a k_filter of the same size
+int GetKFilterBankFloatFilter ( k_filter_bank_float *in, int index, k_filter *out );
+//! sets the measured values of filter index
+int SetKFilterBankFloatMeasured ( k_filter_bank_float *out, int index, double *array, size_t size_array );
+//! copies the a posteriori estimate of filter index into array
+int GetKFilterBankFloatEstimate ( k_filter_bank_float *in, int index, double *array, size_t size_array );
+//! sets the largest condition estimate stepped in float
+int SetKFilterBankFloatConditionLimit ( k_filter_bank_float *out, double limit );
+//! condition estimate of filter index at the last step in float, and 1 in promoted once it steps in double
+int GetKFilterBankFloatHealth ( k_filter_bank_float *in, int index, double *condition, int *promoted );
+
+//! Compute Fcns
+//! one step of every filter, promoting those that turn unhealthy
+//! measurements holds num_filters vectors of y one after another, NULL keeps y
+//! mask holds num_filters flags, 0 predicts only, NULL updates all
+//! returns -1 if a promotion failed or a promoted filter failed its step
+int ComputeKFilterBankFloat ( k_filter_bank_float *out, double *measurements, int *mask );
+
+#endif  //! define FILTER_BANK_FLOAT_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
@@ -0,0 +1,490 @@
+//! filter_bank_step.h
+//! Kalman filter bank step template
+//! the group step of a filter bank for one element type and lane count
+/*! $Id$ */
+
+/*
+
+	The group step is written once and instantiated by filter_bank.c in
+	double and by filter_bank_float.c in float.
+
+	Every product accumulates into a local lane vector before it is stored so
+	the lane loops carry no possible aliasing and vectorize as they stand.
+	Sums are taken in the order of the filter kernels, see filter_kernel.h.
+	While a group steps, the lower triangle of S holds L and its diagonal D
+	of R + C P trans(C) = L D trans(L).
+
+	Before including this file define
+
+		BANK_REAL					element type of the bank
+		BANK_TYPE					bank struct, with the members of k_filter_bank
+		BANK_STEP					name of the group step to define
+		BANK_ENTRY(M,n,i,j)	lanes of entry (i,j) of a group's matrix
+		BANK_ELEMENT(v,i)		lanes of element i of a group's vector
+		BANK_LANES(l)				loop over the lanes of a group
+
+	and BANK_WIDTH, the lanes per group.  Defining BANK_HEALTH also records
+	per lane, in the condition and healthy members, an estimate of the
+	condition of R + C P trans(C) and whether the new P is positive definite.
+	The condition is || S ||_1 times Hager's estimate of || inv(S) ||_1, which
+	solves with L D trans(L) for at most BANK_CONDITION_STEPS pairs of
+	vectors instead of inverting S.
+
+	BANK_REAL, BANK_TYPE, BANK_STEP and BANK_HEALTH are undefined again at the
+	end so the file can be included once per instantiation.  Only include
+	this from the filter_bank*.c files.
+
+*/
+
+
+//! most Hager iterations of the condition estimate
+#ifndef BANK_CONDITION_STEPS
+#define BANK_CONDITION_STEPS		5
+#endif
+
+//! steps the filters of group g, returns -1 if an updated lane skipped its update
+//! or, with BANK_HEALTH, if a lane turned unhealthy
+static CPU_DISPATCH int BANK_STEP( BANK_TYPE *out, int g )
+{
+	const int n = out->num_elements;
+	BANK_REAL *A 			= out->A + g*n*n*BANK_WIDTH;
+	BANK_REAL *B 			= out->B + g*n*n*BANK_WIDTH;
+	BANK_REAL *C 			= out->C + g*n*n*BANK_WIDTH;
+	BANK_REAL *GQG 		= out->GQG + g*n*n*BANK_WIDTH;
+	BANK_REAL *K 			= out->K + g*n*n*BANK_WIDTH;
+	BANK_REAL *P 			= out->P + g*n*n*BANK_WIDTH;
+	BANK_REAL *R 			= out->R + g*n*n*BANK_WIDTH;
+	BANK_REAL *x_hat 	= out->x_hat + g*n*BANK_WIDTH;
+	BANK_REAL *x_hat_ = out->x_hat_ + g*n*BANK_WIDTH;
+	BANK_REAL *y 			= out->y + g*n*BANK_WIDTH;
+	BANK_REAL *u 			= out->u + g*n*BANK_WIDTH;
+	BANK_REAL *y_hat 	= out->y_hat + g*n*BANK_WIDTH;
+	BANK_REAL *y_hat_ = out->y_hat_ + g*n*BANK_WIDTH;
+	BANK_REAL *mask 	= out->mask + g*BANK_WIDTH;
+	BANK_REAL *PC 		= out->PC;
+	BANK_REAL *S 			= out->S;
+	BANK_REAL *AK 		= out->AK;
+	BANK_REAL *innovation = out->innovation;
+	BANK_REAL sum[BANK_WIDTH];
+	BANK_REAL update[BANK_WIDTH];
+#ifdef BANK_HEALTH
+	BANK_REAL *condition 	= out->condition + g*BANK_WIDTH;
+	BANK_REAL *healthy 		= out->healthy + g*BANK_WIDTH;
+	BANK_REAL pivot_min[BANK_WIDTH];
+	BANK_REAL norm[BANK_WIDTH];
+	BANK_REAL estimate[BANK_WIDTH];
+	BANK_REAL largest[BANK_WIDTH];
+	BANK_REAL along[BANK_WIDTH];
+	int unit[BANK_WIDTH];
+	int next[BANK_WIDTH];
+	int done[BANK_WIDTH];
+	BANK_REAL limit = (BANK_REAL)out->condition_limit;
+	BANK_REAL *x, *v, *w;
+	int step, side, converged;
+#endif
+	BANK_REAL *a, *b, *c;
+	int i, j, k, l;
+	int status = 0;
+
+	// compute K gain
+
+	// P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(P,n,i,k);	b = BANK_ENTRY(C,n,j,k);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			c = BANK_ENTRY(PC,n,i,j);
+			BANK_LANES(l) c[l] = sum[l];
+		}
+	}
+	// R + C P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(C,n,i,k);	b = BANK_ENTRY(PC,n,k,j);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			a = BANK_ENTRY(R,n,i,j);	c = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) c[l] = a[l] + sum[l];
+		}
+	}
+#ifdef BANK_HEALTH
+	// || S ||_1, the largest column sum, before the factors replace S
+	BANK_LANES(l) norm[l] = 0.0;
+	for (j = 0; j < n; j++)
+	{
+		BANK_LANES(l) sum[l] = 0.0;
+		for (i = 0; i < n; i++)
+		{
+			a = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) sum[l] += ( a[l] < 0.0 ) ? -a[l] : a[l];
+		}
+		BANK_LANES(l) norm[l] = ( sum[l] > norm[l] ) ? sum[l] : norm[l];
+	}
+#endif
+	// L D trans(L), a lane that is not positive definite predicts only
+	BANK_LANES(l) update[l] = mask[l];
+#ifdef BANK_HEALTH
+	BANK_LANES(l) pivot_min[l] = BANK_ENTRY(S,n,0,0)[l];
+#endif
+	for (j = 0; j < n; j++)
+	{
+		BANK_LANES(l) sum[l] = BANK_ENTRY(S,n,j,j)[l];
+		for (k = 0; k < j; k++)
+		{
+			a = BANK_ENTRY(S,n,j,k);	b = BANK_ENTRY(S,n,k,k);
+			BANK_LANES(l) sum[l] -= a[l] * a[l] * b[l];
+		}
+		c = BANK_ENTRY(S,n,j,j);
+		BANK_LANES(l)
+		{
+#ifdef BANK_HEALTH
+			pivot_min[l] = ( sum[l] < pivot_min[l] ) ? sum[l] : pivot_min[l];
+#endif
+			update[l] = ( sum[l] > 0.0 ) ? update[l] : 0.0;
+			c[l] = ( sum[l] > 0.0 ) ? sum[l] : 1.0;
+		}
+		for (i = j + 1; i < n; i++)
+		{
+			BANK_LANES(l) sum[l] = BANK_ENTRY(S,n,i,j)[l];
+			for (k = 0; k < j; k++)
+			{
+				a = BANK_ENTRY(S,n,i,k);	b = BANK_ENTRY(S,n,j,k);	c = BANK_ENTRY(S,n,k,k);
+				BANK_LANES(l) sum[l] -= a[l] * b[l] * c[l];
+			}
+			a = BANK_ENTRY(S,n,j,j);	c = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) c[l] = sum[l] / a[l];
+		}
+	}
+	BANK_LANES(l)
+	{
+		status = ( update[l] != mask[l] ) ? -1 : status;
+	}
+#ifdef BANK_HEALTH
+	// Hager's estimate of || inv(S) ||_1 in v and w, AK and innovation being
+	// free until the a priori step: v = inv(S) x from x = e/n, w = inv(S) sign(v),
+	// then x = e_j of the largest | w_j | until that is no more than trans(w) x
+	v = AK;
+	w = innovation;
+	for (i = 0; i < n; i++)
+	{
+		x = BANK_ELEMENT(v,i);
+		BANK_LANES(l) x[l] = 1.0 / n;
+	}
+	BANK_LANES(l)
+	{
+		estimate[l] = 0.0;
+		unit[l] = -1;
+		done[l] = 0;
+	}
+	for (step = 0; step < BANK_CONDITION_STEPS; step++)
+	{
+		for (side = 0; side < 2; side++)
+		{
+			// L D trans(L) x = b in place, as for the rows of K
+			x = ( side == 0 ) ? v : w;
+			for (j = 0; j < n; j++)
+			{
+				BANK_LANES(l) sum[l] = BANK_ELEMENT(x,j)[l];
+				for (k = 0; k < j; k++)
+				{
+					a = BANK_ENTRY(S,n,j,k);	b = BANK_ELEMENT(x,k);
+					BANK_LANES(l) sum[l] -= a[l] * b[l];
+				}
+				c = BANK_ELEMENT(x,j);
+				BANK_LANES(l) c[l] = sum[l];
+			}
+			for (j = n - 1; j >= 0; j--)
+			{
+				a = BANK_ENTRY(S,n,j,j);
+				BANK_LANES(l) sum[l] = BANK_ELEMENT(x,j)[l] / a[l];
+				for (k = j + 1; k < n; k++)
+				{
+					a = BANK_ENTRY(S,n,k,j);	b = BANK_ELEMENT(x,k);
+					BANK_LANES(l) sum[l] -= a[l] * b[l];
+				}
+				c = BANK_ELEMENT(x,j);
+				BANK_LANES(l) c[l] = sum[l];
+			}
+			if ( side == 0 )
+			{
+				// || v ||_1 and the signs of v to solve for next
+				BANK_LANES(l) sum[l] = 0.0;
+				for (i = 0; i < n; i++)
+				{
+					a = BANK_ELEMENT(v,i);	c = BANK_ELEMENT(w,i);
+					BANK_LANES(l)
+					{
+						sum[l] += ( a[l] < 0.0 ) ? -a[l] : a[l];
+						c[l] = ( a[l] < 0.0 ) ? -1.0 : 1.0;
+					}
+				}
+				BANK_LANES(l)
+				{
+					estimate[l] = ( !done[l] && sum[l] > estimate[l] ) ? sum[l] : estimate[l];
+				}
+			}
+		}
+		// the largest | w_j | against trans(w) x
+		BANK_LANES(l)
+		{
+			largest[l] = -1.0;
+			along[l] = 0.0;
+			next[l] = 0;
+		}
+		for (i = 0; i < n; i++)
+		{
+			a = BANK_ELEMENT(w,i);
+			BANK_LANES(l)
+			{
+				along[l] += ( unit[l] < 0 ) ? a[l] / n : ( ( unit[l] == i ) ? a[l] : 0.0 );
+				sum[l] = ( a[l] < 0.0 ) ? -a[l] : a[l];
+				next[l] = ( sum[l] > largest[l] ) ? i : next[l];
+				largest[l] = ( sum[l] > largest[l] ) ? sum[l] : largest[l];
+			}
+		}
+		// a lane is done once w points back at x or at the same e_j
+		converged = 1;
+		BANK_LANES(l)
+		{
+			done[l] = done[l] || largest[l] <= along[l] || next[l] == unit[l];
+			unit[l] = next[l];
+			converged = converged && done[l];
+		}
+		if ( converged )
+		{
+			break;
+		}
+		for (i = 0; i < n; i++)
+		{
+			x = BANK_ELEMENT(v,i);
+			BANK_LANES(l) x[l] = ( unit[l] == i ) ? 1.0 : 0.0;
+		}
+	}
+	// infinite when not positive definite
+	BANK_LANES(l)
+	{
+		condition[l] = ( pivot_min[l] > 0.0 ) ? norm[l] * estimate[l] : HUGE_VAL;
+		healthy[l] = ( condition[l] <= limit ) ? 1.0 : 0.0;
+	}
+#endif
+	// row r of K solves ( R + C P trans(C) ) k = row r of P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		// L z = pc
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = BANK_ENTRY(PC,n,i,j)[l];
+			for (k = 0; k < j; k++)
+			{
+				a = BANK_ENTRY(S,n,j,k);	b = BANK_ENTRY(K,n,i,k);
+				BANK_LANES(l) sum[l] -= a[l] * b[l];
+			}
+			c = BANK_ENTRY(K,n,i,j);
+			BANK_LANES(l) c[l] = sum[l];
+		}
+		// trans(L) k = inv(D) z
+		for (j = n - 1; j >= 0; j--)
+		{
+			a = BANK_ENTRY(S,n,j,j);
+			BANK_LANES(l) sum[l] = BANK_ENTRY(K,n,i,j)[l] / a[l];
+			for (k = j + 1; k < n; k++)
+			{
+				a = BANK_ENTRY(S,n,k,j);	b = BANK_ENTRY(K,n,i,k);
+				BANK_LANES(l) sum[l] -= a[l] * b[l];
+			}
+			// filters not updated keep K = 0
+			c = BANK_ENTRY(K,n,i,j);
+			BANK_LANES(l) c[l] = sum[l] * update[l];
+		}
+	}
+
+	// compute estimate recursion / predictive estimate
+
+	for (i = 0; i < n; i++)
+	{
+		a = BANK_ELEMENT(x_hat,i);	b = BANK_ELEMENT(x_hat_,i);	c = BANK_ELEMENT(innovation,i);
+		BANK_LANES(l)
+		{
+			b[l] = a[l];
+			c[l] = BANK_ELEMENT(y,i)[l] - b[l];
+		}
+	}
+	// AK
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(A,n,i,k);	b = BANK_ENTRY(K,n,k,j);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			c = BANK_ENTRY(AK,n,i,j);
+			BANK_LANES(l) c[l] = sum[l];
+		}
+	}
+	// AK( y - x_hat_ ) + A x_hat_ + Bu
+	for (i = 0; i < n; i++)
+	{
+		BANK_LANES(l) sum[l] = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			a = BANK_ENTRY(AK,n,k,i);	b = BANK_ELEMENT(innovation,k);
+			BANK_LANES(l) sum[l] += a[l] * b[l];
+			a = BANK_ENTRY(A,n,k,i);	b = BANK_ELEMENT(x_hat_,k);
+			BANK_LANES(l) sum[l] += a[l] * b[l];
+			a = BANK_ENTRY(B,n,k,i);	b = BANK_ELEMENT(u,k);
+			BANK_LANES(l) sum[l] += a[l] * b[l];
+		}
+		c = BANK_ELEMENT(x_hat,i);
+		BANK_LANES(l) c[l] = sum[l];
+	}
+
+	// compute covariance recursion
+
+	// C P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(C,n,i,k);	b = BANK_ENTRY(P,n,k,j);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			c = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) c[l] = sum[l];
+		}
+	}
+	// P - K C P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(K,n,i,k);	b = BANK_ENTRY(S,n,k,j);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			a = BANK_ENTRY(P,n,i,j);	c = BANK_ENTRY(PC,n,i,j);
+			BANK_LANES(l) c[l] = a[l] - sum[l];
+		}
+	}
+	// ( P - K C P ) trans(A)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(PC,n,i,k);	b = BANK_ENTRY(A,n,j,k);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			c = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) c[l] = sum[l];
+		}
+	}
+	// P = A ( P - K C P ) trans(A) + G Q trans(G)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			BANK_LANES(l) sum[l] = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				a = BANK_ENTRY(A,n,i,k);	b = BANK_ENTRY(S,n,k,j);
+				BANK_LANES(l) sum[l] += a[l] * b[l];
+			}
+			a = BANK_ENTRY(GQG,n,i,j);	c = BANK_ENTRY(P,n,i,j);
+			BANK_LANES(l) c[l] = sum[l] + a[l];
+		}
+	}
+#ifdef BANK_HEALTH
+	// P must stay positive definite - the pivots of its L D trans(L) in S
+	for (j = 0; j < n; j++)
+	{
+		BANK_LANES(l) sum[l] = BANK_ENTRY(P,n,j,j)[l];
+		for (k = 0; k < j; k++)
+		{
+			a = BANK_ENTRY(S,n,j,k);	b = BANK_ENTRY(S,n,k,k);
+			BANK_LANES(l) sum[l] -= a[l] * a[l] * b[l];
+		}
+		c = BANK_ENTRY(S,n,j,j);
+		BANK_LANES(l)
+		{
+			healthy[l] = ( sum[l] > 0.0 ) ? healthy[l] : 0.0;
+			c[l] = ( sum[l] > 0.0 ) ? sum[l] : 1.0;
+		}
+		for (i = j + 1; i < n; i++)
+		{
+			BANK_LANES(l) sum[l] = BANK_ENTRY(P,n,i,j)[l];
+			for (k = 0; k < j; k++)
+			{
+				a = BANK_ENTRY(S,n,i,k);	b = BANK_ENTRY(S,n,j,k);	c = BANK_ENTRY(S,n,k,k);
+				BANK_LANES(l) sum[l] -= a[l] * b[l] * c[l];
+			}
+			a = BANK_ENTRY(S,n,j,j);	c = BANK_ENTRY(S,n,i,j);
+			BANK_LANES(l) c[l] = sum[l] / a[l];
+		}
+	}
+	BANK_LANES(l)
+	{
+		status = ( healthy[l] == 0.0 && mask[l] != 0.0 ) ? -1 : status;
+	}
+#endif
+
+	// compute state vector estimate
+
+	// C x_hat - y
+	for (i = 0; i < n; i++)
+	{
+		b = BANK_ELEMENT(y,i);
+		BANK_LANES(l) sum[l] = -b[l];
+		for (k = 0; k < n; k++)
+		{
+			a = BANK_ENTRY(C,n,k,i);	b = BANK_ELEMENT(x_hat,k);
+			BANK_LANES(l) sum[l] += a[l] * b[l];
+		}
+		c = BANK_ELEMENT(y_hat_,i);
+		BANK_LANES(l) c[l] = sum[l];
+	}
+	// K ( C x_hat - y ) added to x_hat
+	for (i = 0; i < n; i++)
+	{
+		BANK_LANES(l) sum[l] = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			a = BANK_ENTRY(K,n,k,i);	b = BANK_ELEMENT(y_hat_,k);
+			BANK_LANES(l) sum[l] += a[l] * b[l];
+		}
+		a = BANK_ELEMENT(y_hat,i);	c = BANK_ELEMENT(x_hat,i);
+		BANK_LANES(l)
+		{
+			a[l] = sum[l];
+			c[l] += sum[l];
+		}
+	}
+
+	return status;
+}
+
+
+#undef BANK_REAL
+#undef BANK_TYPE
+#undef BANK_STEP
+#undef BANK_HEALTH
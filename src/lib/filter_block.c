@@ -0,0 +1,395 @@
+//! filter_block.c
+//!
+//! block decomposed Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the block decomposition of the Kalman filter.
+
+	block_index lists the transducer indices grouped by block and
+	block_start[b] is where block b begins within it.  blocks[b] holds the
+	sub-filter of a block of more than one transducer and NULL for a scalar
+	block, stepped directly on the parent.  The scalar step keeps its own
+	steady state in the parent's diagonal entries: P_previous[d], K[d] as
+	the frozen gain, S_steady[i] and steady_counts[i].  The sub-filters are
+	laid out afresh in the block region of the parent's arena at every
+	decomposition, every one of their inputs being reloaded from the parent,
+	and the grouping works in block_label, so decomposing never allocates.
+
+	Entries are mapped between parent and sub-filter as (i,j) to
+	(index[i],index[j]) so the internal ordering of the matrices carries over.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <math.h>			// fabs
+
+#include "filter_block.h"
+#include "filter_plan.h"		// PlanKFilter for the sub-filters
+
+
+//! parent entry of block entry (i,j)
+#define BLOCK_ENTRY(M,n,index,i,j)		((M)[(index)[i] + (n)*(index)[j]])
+
+
+//!-------------------------------------------------------
+//! Destructors
+//!-------------------------------------------------------
+//! forgets every sub-filter and the block structure
+static void ReleaseKFilterBlocks( k_filter *out )
+{
+	k_filter **blocks = (k_filter **)out->blocks;
+	int b;
+
+	for (b = 0; b < out->num_elements; b++)
+	{
+		blocks[b] = NULL;
+	}
+	out->num_blocks = 0;
+}
+
+
+//!-------------------------------------------------------
+//! Decompose Fcns
+//!-------------------------------------------------------
+//! merges the groups of transducers coupled through matrix M
+static void CoupleKFilterBlocks( double *M, int n, int *label )
+{
+	int i, j, k;
+	int keep, drop;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			if ( i != j && M[i + n*j] != 0.0 && label[i] != label[j] )
+			{
+				// relabel the higher group into the lower
+				keep = ( label[i] < label[j] ) ? label[i] : label[j];
+				drop = ( label[i] < label[j] ) ? label[j] : label[i];
+				for (k = 0; k < n; k++)
+				{
+					if ( label[k] == drop )
+					{
+						label[k] = keep;
+					}
+				}
+			}
+		}
+	}
+}
+
+//! copies the block of the parent into a sub-filter of matching size
+static void LoadKFilterBlock( k_filter *in, int *index, k_filter *block )
+{
+	int i, j;
+	int n = in->num_elements;
+	int b = block->num_elements;
+
+	for (i = 0; i < b; i++)
+	{
+		for (j = 0; j < b; j++)
+		{
+			block->A[i + b*j] = BLOCK_ENTRY(in->A,n,index,i,j);
+			block->B[i + b*j] = BLOCK_ENTRY(in->B,n,index,i,j);
+			block->C[i + b*j] = BLOCK_ENTRY(in->C,n,index,i,j);
+			block->G[i + b*j] = BLOCK_ENTRY(in->G,n,index,i,j);
+			block->Q[i + b*j] = BLOCK_ENTRY(in->Q,n,index,i,j);
+			block->R[i + b*j] = BLOCK_ENTRY(in->R,n,index,i,j);
+			block->P[i + b*j] = BLOCK_ENTRY(in->P,n,index,i,j);
+		}
+	}
+
+	// the sub-filter chooses its own kernel for its size and structure
+	block->covariance_mode = in->covariance_mode;
+	block->update_mode = in->update_mode;
+	block->steady_norm = in->steady_norm;
+	block->steady_tolerance = in->steady_tolerance;
+	block->steady_steps = in->steady_steps;
+	block->steady_gate = in->steady_gate;
+	PlanKFilter ( block );
+	SelectKFilterKernel ( block );
+}
+
+//! finds the block structure and loads the sub-filters
+//! -1 if the sub-filters do not fit the block region
+int DecomposeKFilter( k_filter *out )
+{
+	int n = out->num_elements;
+	int *label = out->block_label;
+	int i, b, size, count;
+	size_t used, bytes;
+	k_filter **blocks = (k_filter **)out->blocks;
+
+	// every transducer starts as its own group
+	for (i = 0; i < n; i++)
+	{
+		label[i] = i;
+	}
+
+	// join any transducers coupled through the model or covariance
+	CoupleKFilterBlocks( out->A, n, label );
+	CoupleKFilterBlocks( out->B, n, label );
+	CoupleKFilterBlocks( out->C, n, label );
+	CoupleKFilterBlocks( out->G, n, label );
+	CoupleKFilterBlocks( out->Q, n, label );
+	CoupleKFilterBlocks( out->R, n, label );
+	CoupleKFilterBlocks( out->P, n, label );
+
+	// group the indices by block, blocks ordered by their first transducer
+	count = 0;
+	b = 0;
+	for (i = 0; i < n; i++)
+	{
+		if ( label[i] == i )
+		{
+			// i starts a block - collect its members
+			out->block_start[b] = count;
+			for (size = i; size < n; size++)
+			{
+				if ( label[size] == i )
+				{
+					out->block_index[count++] = size;
+				}
+			}
+			b++;
+		}
+	}
+	out->block_start[b] = count;
+	out->num_blocks = b;
+
+	// K is recomputed block by block, clear the entries between blocks
+	for (i = 0; i < n*n && out->num_blocks > 1; i++)
+	{
+		out->K[i] = 0.0;
+	}
+
+	// lay out the sub-filters one after the other in the block region
+	used = 0;
+	for (b = 0; b < n; b++)
+	{
+		size = ( b < out->num_blocks ) ? out->block_start[b + 1] - out->block_start[b] : 0;
+
+		if ( size < 2 || out->num_blocks < 2 )
+		{
+			// scalar block, whole filter or unused slot
+			blocks[b] = NULL;
+			continue;
+		}
+
+		bytes = KFILTER_ALIGN( sizeof( k_filter ) ) + SizeKFilterBlockArena( size );
+		if ( out->block_arena == NULL || used + bytes > out->block_bytes )
+		{
+			// a sub-filter does not split again, it is stepped whole
+			ReleaseKFilterBlocks( out );
+			return -1;
+		}
+		blocks[b] = (k_filter *)( (char *)out->block_arena + used );
+		InitKFilterBlockArena ( blocks[b], size,
+			(char *)out->block_arena + used + KFILTER_ALIGN( sizeof( k_filter ) ) );
+		used += bytes;
+
+		LoadKFilterBlock( out, &(out->block_index[out->block_start[b]]), blocks[b] );
+	}
+
+	return out->num_blocks;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+//! steps a single transducer block on the parent's matrices
+//! every covariance mode reduces to the same scalar recursion, the Joseph
+//! form aside, and the gain freezes as UpdateKFilterSteadyState would
+static int ComputeKFilterScalar( k_filter *out, int i )
+{
+	int n = out->num_elements;
+	int d = i + n*i;
+	int measured = ( out->update_mode != KFILTER_UPDATE_SEQUENTIAL || out->measured[i] );
+	int steady = ( out->steady_tolerance > 0.0 && out->steady_counts[i] >= out->steady_steps );
+	double pc, s, k, m, innovation;
+
+	if ( steady && !measured )
+	{
+		// the frozen gain belongs to a measured transducer
+		out->steady_counts[i] = 0;
+		steady = 0;
+	}
+
+	// compute K gain
+	if ( steady )
+	{
+		k = out->K[d];
+	}
+	else
+	{
+		pc = out->P[d] * out->C[d];
+		s  = out->C[d] * pc + out->R[d];
+		if ( s == 0.0 )
+		{
+			return -1;
+		}
+		// nothing measured, predict only
+		k = measured ? pc / s : 0.0;
+		out->K[d] = k;
+	}
+
+	// compute estimate recursion / predictive estimate
+	out->x_hat_[i] = out->x_hat[i];
+	out->x_hat[i]  = out->A[d] * k * ( out->y[i] - out->x_hat_[i] )
+								 + out->A[d] * out->x_hat_[i] + out->B[d] * out->u[i];
+
+	if ( steady )
+	{
+		// the innovation y - C x_hat_ far outside S_steady unfreezes the gain
+		innovation = out->y[i] - out->C[d] * out->x_hat_[i];
+		if ( out->steady_gate > 0.0
+				 && innovation*innovation > out->steady_gate*out->steady_gate*out->S_steady[i] )
+		{
+			out->steady_counts[i] = 0;
+			out->P_previous[d] = out->P[d];
+		}
+	}
+	else
+	{
+		// compute covariance recursion
+		if ( out->covariance_mode == KFILTER_COVARIANCE_JOSEPH )
+		{
+			m = ( 1.0 - k * out->C[d] ) * out->P[d] * ( 1.0 - k * out->C[d] ) + k * out->R[d] * k;
+		}
+		else
+		{
+			m = out->P[d] - k * out->C[d] * out->P[d];
+		}
+		out->P[d] = out->A[d] * m * out->A[d] + out->G[d] * out->Q[d] * out->G[d];
+
+		// every norm of a scalar is its magnitude, only measured steps converge
+		if ( out->steady_tolerance > 0.0 )
+		{
+			if ( measured && fabs( out->P[d] - out->P_previous[d] ) <= out->steady_tolerance * fabs( out->P[d] ) )
+			{
+				out->steady_counts[i]++;
+			}
+			else
+			{
+				out->steady_counts[i] = 0;
+			}
+			out->P_previous[d] = out->P[d];
+			if ( out->steady_counts[i] >= out->steady_steps )
+			{
+				out->S_steady[i] = out->R[d] + out->C[d] * out->P[d] * out->C[d];
+			}
+		}
+	}
+
+	// compute state vector estimate
+	out->y_hat_[i] = out->C[d] * out->x_hat[i] - out->y[i];
+	out->y_hat[i]  = k * out->y_hat_[i];
+	out->x_hat[i] += out->y_hat[i];
+
+	return 0;
+}
+
+//! steps every block as one complete filter step
+int ComputeKFilterBlocked( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	k_filter **blocks = (k_filter **)out->blocks;
+	k_filter *block;
+	int n = out->num_elements;
+	int *index;
+	int b, i, j, size;
+	int steady = ( out->steady_tolerance > 0.0 );
+
+	for (b = 0; b < out->num_blocks; b++)
+	{
+		index = &(out->block_index[out->block_start[b]]);
+		block = blocks[b];
+
+		if ( block == NULL )
+		{
+			// scalar block
+			if ( ComputeKFilterScalar( out, index[0] ) != 0 )
+			{
+				return -1;
+			}
+			steady = steady && out->steady_counts[index[0]] >= out->steady_steps;
+			continue;
+		}
+
+		size = block->num_elements;
+
+		// gather the block's inputs from the parent
+		for (i = 0; i < size; i++)
+		{
+			if ( block->measured[i] != out->measured[index[i]] && block->steady_state )
+			{
+				// the frozen gain belongs to the previous mask
+				SelectKFilterKernel ( block );
+			}
+			block->x_hat[i] = out->x_hat[index[i]];
+			block->y[i] 		= out->y[index[i]];
+			block->measured[i] = out->measured[index[i]];
+			block->u[i] 		= out->u[index[i]];
+			for (j = 0; j < size; j++)
+			{
+				block->P[i + size*j] = BLOCK_ENTRY(out->P,n,index,i,j);
+			}
+		}
+
+		if ( ComputeKFilter( block ) != 0 )
+		{
+			return -1;
+		}
+
+		// scatter the block's results into the parent
+		for (i = 0; i < size; i++)
+		{
+			out->x_hat[index[i]] 	= block->x_hat[i];
+			out->x_hat_[index[i]] = block->x_hat_[i];
+			out->y_hat[index[i]] 	= block->y_hat[i];
+			out->y_hat_[index[i]] = block->y_hat_[i];
+			for (j = 0; j < size; j++)
+			{
+				BLOCK_ENTRY(out->P,n,index,i,j) = block->P[i + size*j];
+				BLOCK_ENTRY(out->K,n,index,i,j) = block->K[i + size*j];
+			}
+		}
+		steady = steady && block->steady_state;
+	}
+
+	// the filter reads as frozen once every block is
+	out->steady_state = steady;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the blocked kernel when the filter splits
+int SelectKFilterBlockedKernel( k_filter *out )
+{
+	if ( DecomposeKFilter( out ) < 2 )
+	{
+		// a single block, or a sub-filter that would split again, step it whole
+		return -1;
+	}
+
+	out->ComputeKernel = ComputeKFilterBlocked;
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,62 @@
+//! filter_block.h
+//! block decomposed Kalman filter Header File
+//! splits a filter into independent sub-filters along its block structure
+/*! $Id$ */
+
+/*
+
+	The transducers of a sensor are frequently independent of each other:
+	the IMU quaternion, magfield, accel, angrate and angle groups never
+	interact when Q and R are block diagonal, yet the filter steps them as one
+	dense 16 x 16 system.
+
+	DecomposeKFilter partitions the transducers into the smallest groups for
+	which A, B, C, G, Q, R and P hold no entry between two groups.  With that
+	structure K and P remain block diagonal and each group can be filtered on
+	its own at its own size.  Groups of one transducer are stepped as scalar
+	filters directly on the parent's matrices, in every covariance mode and
+	with their own steady state detection, larger groups get their own
+	k_filter which in turn picks its own kernel.  The sub-filters take the
+	covariance mode, update mode and steady state detection of the parent.
+	The parent reads as steady once every block is.
+
+	The parent stays the owner of all the data.  Each step gathers x_hat, y,
+	u and P into the sub-filters and scatters the results back, so P, K and
+	the estimates of the parent always read as those of the full filter.
+	The sub-filters live in the arena of the parent, which SizeKFilterArena
+	sizes for any split, so no decomposition allocates.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_BLOCK_H
+#define FILTER_BLOCK_H
+
+
+//! Functions
+
+//! Decompose Fcns
+//! finds the block structure and loads the sub-filters
+//! returns the number of blocks found, -1 if the sub-filters do not fit the
+//! block region of the arena, as in a sub-filter, which never splits again
+int DecomposeKFilter( k_filter *out );
+
+//! Select Fcns
+//! aims ComputeKernel at the blocked kernel
+//! returns 0 when the filter splits into more than one block and -1 otherwise
+int SelectKFilterBlockedKernel( k_filter *out );
+
+//! Compute Fcns - steps every block as one complete filter step
+int ComputeKFilterBlocked( void *in );
+
+#endif  //! define FILTER_BLOCK_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
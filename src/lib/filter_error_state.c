@@ -0,0 +1,599 @@
+//! filter_error_state.c
+//!
+//! error state extended Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the error state filter.  The nominal state is moved
+	with the rotation and U matrices of kin_model.c, the error covariance
+	with F built in closed form each step and a sized propagation kernel.
+
+	A correction leaves dx non zero only until ESFilterInject folds it into
+	the nominal state, so every measurement residual is taken against the
+	nominal state alone.  The covariance is not rotated on injection, the
+	first order reset Jacobian being the identity.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_error_state.h"
+#include "filter_kernel.h"	// RM, KFILTER_INLINE
+#include "kin_model.h"			// km_UpdateRotMatrix and km_UpdateUMatrix
+
+
+//!-------------------------------------------------------
+//! CONSTRUCTORS
+//!-------------------------------------------------------
+es_filter * CreateESFilter( void )
+{
+
+	//! assign dynamic memory
+	return( (es_filter *) malloc(sizeof(es_filter)));
+
+}//! end CreateESFilter
+
+
+//!-------------------------------------------------------
+//! Quaternion Fcns - s x y z as in a state_vector
+//!-------------------------------------------------------
+//! scales q to unit length, the identity if it is zero
+static void ESFilterNormalize( double *q )
+{
+	double size = sqrt( q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3] );
+	int i;
+
+	if ( size == 0.0 )
+	{
+		q[0] = 1.0;		q[1] = 0.0;		q[2] = 0.0;		q[3] = 0.0;
+		return;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		q[i] /= size;
+	}
+}
+
+//! a (x) b, the Hamilton product
+static void ESFilterMultiply( const double *a, const double *b, double *out )
+{
+	out[0] = a[0]*b[0] - a[1]*b[1] - a[2]*b[2] - a[3]*b[3];
+	out[1] = a[0]*b[1] + a[1]*b[0] + a[2]*b[3] - a[3]*b[2];
+	out[2] = a[0]*b[2] - a[1]*b[3] + a[2]*b[0] + a[3]*b[1];
+	out[3] = a[0]*b[3] + a[1]*b[2] - a[2]*b[1] + a[3]*b[0];
+}
+
+//! rotation matrix of the nominal orientation, body to world
+static void ESFilterRotation( es_filter *in, rot_matrix *R )
+{
+	PmQuaternion q;
+
+	q.s = in->q[0];		q.x = in->q[1];		q.y = in->q[2];		q.z = in->q[3];
+	km_UpdateRotMatrix ( q, R );
+}
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+int InitESFilter ( es_filter *out, int estimate_bias )
+{
+	//! at rest at the origin facing north with the initial uncertainties
+	int i, n;
+
+	n = ( estimate_bias != 0 ) ? ESFILTER_ELEMENTS : ESFILTER_POSE_ELEMENTS;
+	out->num_elements = n;
+
+	for (i = 0; i < 3; i++)
+	{
+		out->p[i] 				= 0.0;
+		out->v[i] 				= 0.0;
+		out->accel_bias[i] 	= 0.0;
+		out->gyro_bias[i] 	= 0.0;
+		out->omega[i] 			= 0.0;
+	}
+	out->q[0] = 1.0;		out->q[1] = 0.0;		out->q[2] = 0.0;		out->q[3] = 0.0;
+	out->gravity[0] = 0.0;		out->gravity[1] = 0.0;		out->gravity[2] = -ESFILTER_GRAVITY;
+
+	SetESFilterNoise ( out, ESFILTER_ACCEL_NOISE, ESFILTER_GYRO_NOISE,
+										 ESFILTER_ACCEL_BIAS_NOISE, ESFILTER_GYRO_BIAS_NOISE );
+
+	for (i = 0; i < ESFILTER_ELEMENTS; i++)
+	{
+		out->dx[i] = 0.0;
+	}
+	for (i = 0; i < ESFILTER_ELEMENTS*ESFILTER_ELEMENTS; i++)
+	{
+		out->P[i] 	= 0.0;
+		out->F[i] 	= 0.0;
+		out->FP[i] 	= 0.0;
+	}
+	//! independent initial errors
+	for (i = 0; i < 3; i++)
+	{
+		RM(out->P,n,ESFILTER_POSITION + i,ESFILTER_POSITION + i) = ESFILTER_INITIAL_POSITION*ESFILTER_INITIAL_POSITION;
+		RM(out->P,n,ESFILTER_ATTITUDE + i,ESFILTER_ATTITUDE + i) = ESFILTER_INITIAL_ATTITUDE*ESFILTER_INITIAL_ATTITUDE;
+		RM(out->P,n,ESFILTER_VELOCITY + i,ESFILTER_VELOCITY + i) = ESFILTER_INITIAL_VELOCITY*ESFILTER_INITIAL_VELOCITY;
+		if ( n == ESFILTER_ELEMENTS )
+		{
+			RM(out->P,n,ESFILTER_ACCEL_BIAS + i,ESFILTER_ACCEL_BIAS + i) = ESFILTER_INITIAL_BIAS*ESFILTER_INITIAL_BIAS;
+			RM(out->P,n,ESFILTER_GYRO_BIAS + i,ESFILTER_GYRO_BIAS + i) 	= ESFILTER_INITIAL_BIAS*ESFILTER_INITIAL_BIAS;
+		}
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Fcns
+//!-------------------------------------------------------
+int SetESFilterStateVector ( es_filter *out, state_vector *in )
+{
+	//! sets the position and orientation of the nominal state
+	out->p[0] = in->loc.x;
+	out->p[1] = in->loc.y;
+	out->p[2] = in->loc.z;
+
+	out->q[0] = in->orient.s;
+	out->q[1] = in->orient.x;
+	out->q[2] = in->orient.y;
+	out->q[3] = in->orient.z;
+	ESFilterNormalize ( out->q );
+
+	return 0;
+}
+
+int SetESFilterNoise ( es_filter *out, double accel, double gyro, double accel_bias, double gyro_bias )
+{
+	//! sets the four noise densities
+
+	if ( accel < 0.0 || gyro < 0.0 || accel_bias < 0.0 || gyro_bias < 0.0 )
+	{
+		return -1;
+	}
+	out->accel_noise 			= accel;
+	out->gyro_noise 			= gyro;
+	out->accel_bias_noise 	= accel_bias;
+	out->gyro_bias_noise 	= gyro_bias;
+
+	return 0;
+}
+
+int GetESFilterStateVector ( es_filter *in, state_vector *out )
+{
+	//! position and orientation of the nominal state
+	return km_SetStateVector( in->p[0], in->p[1], in->p[2], in->q[0], in->q[1], in->q[2], in->q[3], out );
+}
+
+int GetESFilterVelMatrix ( es_filter *in, vel_matrix *out )
+{
+	//! trans(R) v and the rates, the velocity matrix km_ComputeKinematicModel takes
+	rot_matrix R;
+	int i;
+
+	ESFilterRotation ( in, &R );
+	for (i = 0; i < 3; i++)
+	{
+		out->vel[i] = R.entry[0][i]*in->v[0] + R.entry[1][i]*in->v[1] + R.entry[2][i]*in->v[2];
+		out->vel[i + 3] = in->omega[i];
+	}
+
+	return 0;
+}
+
+int GetESFilterSnapshot ( es_filter *in, es_snapshot *out )
+{
+	//! nominal state and P, with dx zero between steps
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		out->p[i] 					= in->p[i];
+		out->v[i] 					= in->v[i];
+		out->accel_bias[i] 	= in->accel_bias[i];
+		out->gyro_bias[i] 	= in->gyro_bias[i];
+		out->omega[i] 			= in->omega[i];
+	}
+	for (i = 0; i < 4; i++)
+	{
+		out->q[i] = in->q[i];
+	}
+	for (i = 0; i < in->num_elements*in->num_elements; i++)
+	{
+		out->P[i] = in->P[i];
+	}
+
+	return 0;
+}
+
+int SetESFilterSnapshot ( es_filter *out, es_snapshot *in )
+{
+	//! back to the step the snapshot was taken at
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		out->p[i] 					= in->p[i];
+		out->v[i] 					= in->v[i];
+		out->accel_bias[i] 	= in->accel_bias[i];
+		out->gyro_bias[i] 	= in->gyro_bias[i];
+		out->omega[i] 			= in->omega[i];
+	}
+	for (i = 0; i < 4; i++)
+	{
+		out->q[i] = in->q[i];
+	}
+	for (i = 0; i < out->num_elements*out->num_elements; i++)
+	{
+		out->P[i] = in->P[i];
+	}
+	for (i = 0; i < ESFILTER_ELEMENTS; i++)
+	{
+		out->dx[i] = 0.0;
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+
+/*
+	ComputeESFilterCovarianceStep is the body of the propagation kernels.
+	It forms F P and then the lower triangle of F P trans(F) + Q dt, which
+	is mirrored.  Q is diagonal.
+*/
+KFILTER_INLINE void ComputeESFilterCovarianceStep( es_filter *out, const int n, double delta_t )
+{
+	double sum, noise;
+	int i, j, k;
+
+	// F P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->F,n,i,k) * RM(out->P,n,k,j);
+			}
+			RM(out->FP,n,i,j) = sum;
+		}
+	}
+	// F P trans(F)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j <= i; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->FP,n,i,k) * RM(out->F,n,j,k);
+			}
+			RM(out->P,n,i,j) = sum;
+			RM(out->P,n,j,i) = sum;
+		}
+	}
+	// + Q dt
+	for (i = 0; i < 3; i++)
+	{
+		noise = out->gyro_noise;
+		RM(out->P,n,ESFILTER_ATTITUDE + i,ESFILTER_ATTITUDE + i) += noise*noise*delta_t;
+		noise = out->accel_noise;
+		RM(out->P,n,ESFILTER_VELOCITY + i,ESFILTER_VELOCITY + i) += noise*noise*delta_t;
+		if ( n == ESFILTER_ELEMENTS )
+		{
+			noise = out->accel_bias_noise;
+			RM(out->P,n,ESFILTER_ACCEL_BIAS + i,ESFILTER_ACCEL_BIAS + i) += noise*noise*delta_t;
+			noise = out->gyro_bias_noise;
+			RM(out->P,n,ESFILTER_GYRO_BIAS + i,ESFILTER_GYRO_BIAS + i) += noise*noise*delta_t;
+		}
+	}
+}
+
+//! biases estimated
+static CPU_DISPATCH void ComputeESFilterCovariance15( es_filter *out, double delta_t )
+{
+	ComputeESFilterCovarianceStep ( out, ESFILTER_ELEMENTS, delta_t );
+}
+
+//! biases held
+static CPU_DISPATCH void ComputeESFilterCovariance9( es_filter *out, double delta_t )
+{
+	ComputeESFilterCovarianceStep ( out, ESFILTER_POSE_ELEMENTS, delta_t );
+}
+
+int ComputeESFilterPropagate ( es_filter *out, const double *accel, const double *gyro, double delta_t )
+{
+	//! moves the nominal state and the error covariance on by delta_t
+	rot_matrix R;
+	U_matrix U;
+	PmQuaternion q;
+	double a[3], w[3], f[3], dq[4];
+	double dt2;
+	int n = out->num_elements;
+	int i, j, k;
+
+	if ( delta_t <= 0.0 )
+	{
+		//! nothing to propagate
+		return ( delta_t == 0.0 ) ? 0 : -1;
+	}
+
+	//! body frame specific force and rate less the biases
+	for (i = 0; i < 3; i++)
+	{
+		a[i] = accel[i] - out->accel_bias[i];
+		w[i] = gyro[i] - out->gyro_bias[i];
+		out->omega[i] = w[i];
+	}
+
+	//! R and U of the orientation at the start of the step
+	q.s = out->q[0];		q.x = out->q[1];		q.y = out->q[2];		q.z = out->q[3];
+	km_UpdateRotMatrix ( q, &R );
+	km_UpdateUMatrix ( q, &U );
+
+	//! closed form F = I + Fc dt, built before the nominal state moves
+	for (i = 0; i < n*n; i++)
+	{
+		out->F[i] = 0.0;
+	}
+	for (i = 0; i < n; i++)
+	{
+		RM(out->F,n,i,i) = 1.0;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		//! dp' = dv
+		RM(out->F,n,ESFILTER_POSITION + i,ESFILTER_VELOCITY + i) = delta_t;
+		for (j = 0; j < 3; j++)
+		{
+			//! dv' = - R [a]x dtheta, column j of [a]x is a x e_j
+			RM(out->F,n,ESFILTER_VELOCITY + i,ESFILTER_ATTITUDE + j) = -delta_t *
+				( R.entry[i][(j + 1) % 3] * a[(j + 2) % 3] - R.entry[i][(j + 2) % 3] * a[(j + 1) % 3] );
+		}
+	}
+	//! dtheta' = - [w]x dtheta
+	RM(out->F,n,ESFILTER_ATTITUDE + 0,ESFILTER_ATTITUDE + 1) =  w[2]*delta_t;
+	RM(out->F,n,ESFILTER_ATTITUDE + 0,ESFILTER_ATTITUDE + 2) = -w[1]*delta_t;
+	RM(out->F,n,ESFILTER_ATTITUDE + 1,ESFILTER_ATTITUDE + 0) = -w[2]*delta_t;
+	RM(out->F,n,ESFILTER_ATTITUDE + 1,ESFILTER_ATTITUDE + 2) =  w[0]*delta_t;
+	RM(out->F,n,ESFILTER_ATTITUDE + 2,ESFILTER_ATTITUDE + 0) =  w[1]*delta_t;
+	RM(out->F,n,ESFILTER_ATTITUDE + 2,ESFILTER_ATTITUDE + 1) = -w[0]*delta_t;
+	if ( n == ESFILTER_ELEMENTS )
+	{
+		for (i = 0; i < 3; i++)
+		{
+			//! dv' = - R dba
+			for (j = 0; j < 3; j++)
+			{
+				RM(out->F,n,ESFILTER_VELOCITY + i,ESFILTER_ACCEL_BIAS + j) = -R.entry[i][j]*delta_t;
+			}
+			//! dtheta' = - dbg
+			RM(out->F,n,ESFILTER_ATTITUDE + i,ESFILTER_GYRO_BIAS + i) = -delta_t;
+		}
+	}
+
+	//! nominal state
+	dt2 = 0.5*delta_t*delta_t;
+	for (i = 0; i < 3; i++)
+	{
+		f[i] = out->gravity[i];
+		for (k = 0; k < 3; k++)
+		{
+			f[i] += R.entry[i][k] * a[k];
+		}
+		out->p[i] += out->v[i]*delta_t + f[i]*dt2;
+		out->v[i] += f[i]*delta_t;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		dq[i] = 0.0;
+		for (k = 0; k < 3; k++)
+		{
+			dq[i] += 0.5*U.entry[i][k] * w[k];
+		}
+		out->q[i] += dq[i]*delta_t;
+	}
+	ESFilterNormalize ( out->q );
+
+	//! error covariance
+	if ( n == ESFILTER_ELEMENTS )
+	{
+		ComputeESFilterCovariance15 ( out, delta_t );
+	}
+	else
+	{
+		ComputeESFilterCovariance9 ( out, delta_t );
+	}
+
+	return 0;
+}
+
+//! one scalar measurement residual = h dx + noise of variance, Joseph free
+static int ESFilterScalarUpdate( es_filter *out, const double *h, double residual, double variance )
+{
+	double Ph[ESFILTER_ELEMENTS];
+	double s, innovation;
+	int n = out->num_elements;
+	int i, j;
+
+	//! P trans(h), with h dx the prediction of the residual
+	s = variance;
+	innovation = residual;
+	for (i = 0; i < n; i++)
+	{
+		Ph[i] = 0.0;
+		for (j = 0; j < n; j++)
+		{
+			Ph[i] += RM(out->P,n,i,j) * h[j];
+		}
+		s += h[i]*Ph[i];
+		innovation -= h[i]*out->dx[i];
+	}
+	if ( !( s > 0.0 ) )
+	{
+		//! no usable innovation variance
+		return -1;
+	}
+
+	//! dx += K innovation, P -= K h P with K = P trans(h) / s
+	for (i = 0; i < n; i++)
+	{
+		out->dx[i] += Ph[i]*innovation/s;
+		for (j = 0; j < n; j++)
+		{
+			RM(out->P,n,i,j) -= Ph[i]*Ph[j]/s;
+		}
+	}
+
+	return 0;
+}
+
+//! folds dx into the nominal state and zeros it
+static void ESFilterInject( es_filter *out )
+{
+	double half[4], q[4];
+	int i;
+
+	half[0] = 1.0;
+	for (i = 0; i < 3; i++)
+	{
+		out->p[i] += out->dx[ESFILTER_POSITION + i];
+		out->v[i] += out->dx[ESFILTER_VELOCITY + i];
+		half[i + 1] = 0.5*out->dx[ESFILTER_ATTITUDE + i];
+		if ( out->num_elements == ESFILTER_ELEMENTS )
+		{
+			out->accel_bias[i] 	+= out->dx[ESFILTER_ACCEL_BIAS + i];
+			out->gyro_bias[i] 	+= out->dx[ESFILTER_GYRO_BIAS + i];
+		}
+	}
+	ESFilterMultiply ( out->q, half, q );
+	for (i = 0; i < 4; i++)
+	{
+		out->q[i] = q[i];
+	}
+	ESFilterNormalize ( out->q );
+
+	for (i = 0; i < ESFILTER_ELEMENTS; i++)
+	{
+		out->dx[i] = 0.0;
+	}
+}
+
+int ComputeESFilterPosition ( es_filter *out, const double *position, const double *variance )
+{
+	//! h picks one component of dp at a time
+	double h[ESFILTER_ELEMENTS];
+	int status = 0;
+	int i, j;
+
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < ESFILTER_ELEMENTS; j++)
+		{
+			h[j] = 0.0;
+		}
+		h[ESFILTER_POSITION + i] = 1.0;
+		if ( ESFilterScalarUpdate ( out, h, position[i] - out->p[i], variance[i] ) != 0 )
+		{
+			status = -1;
+		}
+	}
+	ESFilterInject ( out );
+
+	return status;
+}
+
+int ComputeESFilterSpeed ( es_filter *out, double speed, double variance )
+{
+	//! speed is x of trans(R) v, so with the body velocity b = trans(R) v
+	//! h dtheta is row x of [b]x and h dv is row x of trans(R)
+	double h[ESFILTER_ELEMENTS];
+	double b[3];
+	rot_matrix R;
+	int i, j;
+
+	ESFilterRotation ( out, &R );
+	for (i = 0; i < 3; i++)
+	{
+		b[i] = R.entry[0][i]*out->v[0] + R.entry[1][i]*out->v[1] + R.entry[2][i]*out->v[2];
+	}
+
+	for (j = 0; j < ESFILTER_ELEMENTS; j++)
+	{
+		h[j] = 0.0;
+	}
+	h[ESFILTER_ATTITUDE + 1] = -b[2];
+	h[ESFILTER_ATTITUDE + 2] =  b[1];
+	for (i = 0; i < 3; i++)
+	{
+		h[ESFILTER_VELOCITY + i] = R.entry[i][0];
+	}
+	if ( ESFilterScalarUpdate ( out, h, speed - b[0], variance ) != 0 )
+	{
+		return -1;
+	}
+	ESFilterInject ( out );
+
+	return 0;
+}
+
+int ComputeESFilterAttitude ( es_filter *out, const double *orient, double variance )
+{
+	//! the residual rotation inv(q) (x) orient is 2 dtheta to first order
+	double h[ESFILTER_ELEMENTS];
+	double conjugate[4], measured[4], error[4];
+	int status = 0;
+	int i, j;
+
+	for (i = 0; i < 4; i++)
+	{
+		measured[i] = orient[i];
+	}
+	ESFilterNormalize ( measured );
+	conjugate[0] = out->q[0];
+	for (i = 1; i < 4; i++)
+	{
+		conjugate[i] = -out->q[i];
+	}
+	ESFilterMultiply ( conjugate, measured, error );
+	if ( error[0] < 0.0 )
+	{
+		//! the shorter of the two rotations
+		for (i = 0; i < 4; i++)
+		{
+			error[i] = -error[i];
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < ESFILTER_ELEMENTS; j++)
+		{
+			h[j] = 0.0;
+		}
+		h[ESFILTER_ATTITUDE + i] = 1.0;
+		if ( ESFilterScalarUpdate ( out, h, 2.0*error[i + 1], variance ) != 0 )
+		{
+			status = -1;
+		}
+	}
+	ESFilterInject ( out );
+
+	return status;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
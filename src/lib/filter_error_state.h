@@ -0,0 +1,186 @@
+//! filter_error_state.h
+//! error state extended Kalman filter Header File
+//! full pose filter propagated by the IMU and corrected by the absolute sensors
+/*! $Id$ */
+
+/*
+
+	The kinematic model of kin_model.c integrates the fused velocities open
+	loop.  An es_filter instead carries a nominal state
+
+		p		position, the loc of a state_vector
+		q		orientation quaternion s x y z, the orient of a state_vector
+		v		velocity in the world frame
+		ba bg	accelerometer and gyro biases
+
+	propagated at the IMU rate with the body frame specific force a and rate
+	w less the biases:
+
+		p += v dt + 1/2 ( R a + g ) dt^2
+		v += ( R a + g ) dt
+		q += 1/2 U w dt, then normalized
+
+	R and U are those of km_UpdateRotMatrix and km_UpdateUMatrix.  Alongside
+	it a Kalman filter tracks the error of the nominal state
+
+		dx = [ dp  dtheta  dv  dba  dbg ]
+
+	with dtheta the small body frame rotation q_true = q (x) [ 1 dtheta/2 ].
+	Its Jacobian is closed form, with [a]x the skew matrix of a:
+
+		dp'		= dv
+		dv'		= - R [a]x dtheta - R dba
+		dtheta'	= - [w]x dtheta - dbg
+
+	and F = I + Fc dt.  The covariance is propagated as F P trans(F) + Q dt
+	by kernels instantiated with the size a constant: ESFILTER_ELEMENTS with
+	the biases estimated, ESFILTER_POSE_ELEMENTS with them held.  A step is
+	about 2 n^3 flops, some 7000 for n = 15, well inside a 1 kHz budget.
+
+	Corrections arrive whenever a sensor has data, each as a run of scalar
+	updates of O(n^2) against a diagonal noise, after which dx is folded into
+	the nominal state and zeroed.  Position, forward speed in the body frame
+	and an orientation quaternion are measured.
+
+	gravity is in the world frame of p, (0, 0, -ESFILTER_GRAVITY) for z up
+	by default.
+
+*/
+
+//! Includes
+#include "filter.h"
+#include "state_vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_ERROR_STATE_H
+#define FILTER_ERROR_STATE_H
+
+
+//! Defines
+
+//! error state elements with the biases estimated
+#define ESFILTER_ELEMENTS				15
+//! error state elements with the biases held, position attitude velocity
+#define ESFILTER_POSE_ELEMENTS		9
+
+//! first element of each block of dx
+#define ESFILTER_POSITION				0
+#define ESFILTER_ATTITUDE				3
+#define ESFILTER_VELOCITY				6
+#define ESFILTER_ACCEL_BIAS			9
+#define ESFILTER_GYRO_BIAS				12
+
+//! standard gravity m/s^2
+#define ESFILTER_GRAVITY				9.80665
+
+//! initial standard deviations of the error state
+#define ESFILTER_INITIAL_POSITION	10.0
+#define ESFILTER_INITIAL_ATTITUDE	0.1
+#define ESFILTER_INITIAL_VELOCITY	1.0
+#define ESFILTER_INITIAL_BIAS			0.1
+
+//! default noise densities, per square root second
+#define ESFILTER_ACCEL_NOISE			0.1
+#define ESFILTER_GYRO_NOISE			0.01
+#define ESFILTER_ACCEL_BIAS_NOISE	0.001
+#define ESFILTER_GYRO_BIAS_NOISE		0.0001
+
+
+//! Data structs
+
+//! data struct error state extended Kalman filter
+typedef struct
+{
+	//! number of error state elements, ESFILTER_ELEMENTS or ESFILTER_POSE_ELEMENTS
+	int num_elements;
+
+	//! nominal state
+	//! position
+	double p[3];
+	//! orientation quaternion s x y z
+	double q[4];
+	//! velocity in the world frame
+	double v[3];
+	//! accelerometer bias
+	double accel_bias[3];
+	//! gyro bias
+	double gyro_bias[3];
+	//! body rate of the last propagation less the gyro bias
+	double omega[3];
+	//! gravity in the world frame
+	double gravity[3];
+
+	//! noise densities of accel, gyro and the two bias random walks
+	double accel_noise;
+	double gyro_noise;
+	double accel_bias_noise;
+	double gyro_bias_noise;
+
+	//! error state dx since the last injection
+	double dx[ESFILTER_ELEMENTS];
+	//! error covariance, row major num_elements x num_elements
+	double P[ESFILTER_ELEMENTS*ESFILTER_ELEMENTS];
+
+	// computation members
+	//! F of the last propagation
+	double F[ESFILTER_ELEMENTS*ESFILTER_ELEMENTS];
+	//! F P
+	double FP[ESFILTER_ELEMENTS*ESFILTER_ELEMENTS];
+
+} es_filter;
+
+//! data struct what a step of an es_filter changes, enough to return to it
+typedef struct
+{
+	double p[3];
+	double q[4];
+	double v[3];
+	double accel_bias[3];
+	double gyro_bias[3];
+	double omega[3];
+	//! error covariance, as P of the es_filter
+	double P[ESFILTER_ELEMENTS*ESFILTER_ELEMENTS];
+
+} es_snapshot;
+
+
+//! Functions
+
+//! Constructors - create data structs
+es_filter * CreateESFilter( void );	//! creates and returns dynamic memory
+
+//! Init Fcns
+//! at rest at the origin facing north, biases estimated when estimate_bias is nonzero
+int InitESFilter ( es_filter *out, int estimate_bias );
+
+//! Get/Set Functions
+//! sets the position and orientation of the nominal state, leaving P
+int SetESFilterStateVector ( es_filter *out, state_vector *in );
+//! sets the four noise densities
+int SetESFilterNoise ( es_filter *out, double accel, double gyro, double accel_bias, double gyro_bias );
+//! position and orientation of the nominal state
+int GetESFilterStateVector ( es_filter *in, state_vector *out );
+//! body frame velocity and rates of the nominal state
+int GetESFilterVelMatrix ( es_filter *in, vel_matrix *out );
+//! copies the nominal state and P out of, and back into, a filter
+int GetESFilterSnapshot ( es_filter *in, es_snapshot *out );
+int SetESFilterSnapshot ( es_filter *out, es_snapshot *in );
+
+//! Compute Fcns
+//! propagates by delta_t with the body frame specific force accel[3] and rate gyro[3]
+int ComputeESFilterPropagate ( es_filter *out, const double *accel, const double *gyro, double delta_t );
+//! corrects with a measured position and the variance of each of its components
+int ComputeESFilterPosition ( es_filter *out, const double *position, const double *variance );
+//! corrects with a measured forward speed, along the body x axis
+int ComputeESFilterSpeed ( es_filter *out, double speed, double variance );
+//! corrects with a measured orientation quaternion s x y z and the variance of each rotation angle
+int ComputeESFilterAttitude ( es_filter *out, const double *orient, double variance );
+
+#endif  //! define FILTER_ERROR_STATE_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
@@ -0,0 +1,255 @@
+//! filter_fixed.c
+//!
+//! fixed size Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the fixed size kernels for the Kalman filter.  A single
+	step body is written once against a size n and then instantiated for each
+	of the scripted sensor sizes with n a constant, so the compiler can unroll
+	every loop and keep the temporaries on the stack.  No BLAS or LAPACK calls
+	are made.
+
+	The order of operations matches ComputeKFilter in filter.c:
+
+		K 		= P trans(C) inv( R + C P trans(C) )
+		x_hat_	= x_hat
+		x_hat	= AK ( y - x_hat_ ) + A x_hat_ + B u
+		P 		= A ( P - K C P ) trans(A) + G Q trans(G)
+		x_hat	= x_hat + K ( C x_hat - y )
+
+	Matrix products use the row major ordering of the cblas_dgemm calls and
+	matrix vector products use the column ordering of MultiplyMatrixVector.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_fixed.h"
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+
+/*
+	ComputeKFilterFixedStep is the body of every fixed kernel.  It computes one
+	complete filter step in the same order as ComputeKFilter.
+*/
+KFILTER_INLINE int ComputeKFilterFixedStep( k_filter *out, const int n )
+{
+	// stack temporaries
+	double PC[KFILTER_FIXED_MAX * KFILTER_FIXED_MAX];
+	double S[KFILTER_FIXED_MAX * KFILTER_FIXED_MAX];
+	double S_inv[KFILTER_FIXED_MAX * KFILTER_FIXED_MAX];
+	double T[KFILTER_FIXED_MAX * KFILTER_FIXED_MAX];
+	double innovation[KFILTER_FIXED_MAX];
+	double sum;
+	int i, j, k;
+
+	// compute K gain
+
+	// P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->P,n,i,k) * RM(out->C,n,j,k);
+			}
+			RM(PC,n,i,j) = sum;
+		}
+	}
+	// R + C P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->R,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,i,k) * RM(PC,n,k,j);
+			}
+			RM(S,n,i,j) = sum;
+		}
+	}
+	// inv( R + C P trans(C) )
+	if ( KFilterKernelInvert( S, S_inv, n ) != 0 )
+	{
+		return -1;
+	}
+	// K = P trans(C) inv( R + C P trans(C) )
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(PC,n,i,k) * RM(S_inv,n,k,j);
+			}
+			RM(out->K,n,i,j) = sum;
+		}
+	}
+
+	// compute estimate recursion / predictive estimate
+
+	KFilterKernelAPriori( out, n, T, innovation );
+
+	// compute covariance recursion
+
+	// C P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,i,k) * RM(out->P,n,k,j);
+			}
+			RM(S,n,i,j) = sum;
+		}
+	}
+	// P - K C P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->P,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum -= RM(out->K,n,i,k) * RM(S,n,k,j);
+			}
+			RM(T,n,i,j) = sum;
+		}
+	}
+	// ( P - K C P ) trans(A)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(T,n,i,k) * RM(out->A,n,j,k);
+			}
+			RM(S,n,i,j) = sum;
+		}
+	}
+	// Q trans(G)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->Q,n,i,k) * RM(out->G,n,j,k);
+			}
+			RM(T,n,i,j) = sum;
+		}
+	}
+	// P = A ( P - K C P ) trans(A) + G Q trans(G)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(S,n,k,j);
+				sum += RM(out->G,n,i,k) * RM(T,n,k,j);
+			}
+			RM(out->P,n,i,j) = sum;
+		}
+	}
+
+	// compute state vector estimate
+
+	KFilterKernelAPosteriori( out, n );
+
+	return 0;
+}
+
+//! one copy per instruction set, stepped through the plain kernels below
+static CPU_DISPATCH int KFilterFixed4( k_filter *out )
+{
+	return ComputeKFilterFixedStep( out, KFILTER_FIXED_ODOM );
+}
+
+static CPU_DISPATCH int KFilterFixed7( k_filter *out )
+{
+	return ComputeKFilterFixedStep( out, KFILTER_FIXED_GPS );
+}
+
+static CPU_DISPATCH int KFilterFixed16( k_filter *out )
+{
+	return ComputeKFilterFixedStep( out, KFILTER_FIXED_IMU );
+}
+
+//! odometer sized kernel
+int ComputeKFilterFixed4( void *in )
+{
+	return KFilterFixed4( (k_filter *)in );
+}
+
+//! gps sized kernel
+int ComputeKFilterFixed7( void *in )
+{
+	return KFilterFixed7( (k_filter *)in );
+}
+
+//! imu sized kernel
+int ComputeKFilterFixed16( void *in )
+{
+	return KFilterFixed16( (k_filter *)in );
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the fixed kernel for the filter size
+int SelectKFilterFixedKernel( k_filter *out )
+{
+	switch ( out->num_elements )
+	{
+		case KFILTER_FIXED_ODOM:
+		{
+			out->ComputeKernel = ComputeKFilterFixed4;
+			break;
+		}
+		case KFILTER_FIXED_GPS:
+		{
+			out->ComputeKernel = ComputeKFilterFixed7;
+			break;
+		}
+		case KFILTER_FIXED_IMU:
+		{
+			out->ComputeKernel = ComputeKFilterFixed16;
+			break;
+		}
+		default:
+		{
+			// no kernel for this size, use BLAS
+			out->ComputeKernel = NULL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,67 @@
+//! filter_fixed.h
+//! fixed size Kalman filter Header File
+//! kernels specialized for the transducer counts of the scripted sensors
+/*! $Id$ */
+
+/*
+
+	The scripted sensors only ever build filters of three sizes:
+	odom (4), gps (7) and imu (16).  At these sizes the call overhead of
+	a dozen cblas_dgemm calls and a clapack_dgesv is greater than the
+	arithmetic itself, so each size gets its own kernel with the loop
+	bounds fixed at compile time and all temporaries on the stack.
+
+	The kernels follow exactly the same equations and matrix orderings
+	as the generic BLAS path in filter.c so either may be used on the
+	same filter.
+
+	They only cover dense systems.  SelectKFilterKernel prefers the
+	blocked kernel of filter_block.h and the planned kernel of
+	filter_plan.h, which skip the work structure saves.  The scripted
+	sensors start from identity A, C, G, Q and R, so they step as scalar
+	blocks, and a fixed kernel only runs once a sensor couples its
+	transducers through dense matrices.  The IMU filter steps in well
+	under a microsecond as sixteen scalar blocks, far inside the
+	millisecond of a 1 kHz feed.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_FIXED_H
+#define FILTER_FIXED_H
+
+
+//! Defines
+
+//! largest filter handled by a fixed kernel - sizes temporaries
+#define KFILTER_FIXED_MAX			16
+
+//! transducer counts with a specialized kernel
+#define KFILTER_FIXED_ODOM		4
+#define KFILTER_FIXED_GPS			7
+#define KFILTER_FIXED_IMU			16
+
+
+//! Functions
+
+//! Select Fcns
+//! aims ComputeKernel at the fixed kernel for the filter size, if one exists
+//! returns 0 when a kernel was assigned and -1 for the generic BLAS path
+int SelectKFilterFixedKernel( k_filter *out );
+
+//! Compute Fcns - one complete filter step: K, a priori, P, a posteriori
+int ComputeKFilterFixed4( void *in );
+int ComputeKFilterFixed7( void *in );
+int ComputeKFilterFixed16( void *in );
+
+#endif  //! define FILTER_FIXED_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
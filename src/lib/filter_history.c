@@ -0,0 +1,286 @@
+//! filter_history.c
+//!
+//! error state filter history Functions
+/* $Id$ */
+
+
+/*
+
+	This c file keeps the ring of es_history_step and steps the filter
+	again from the step a late measurement belongs to.  Steps are found by
+	age, 0 being the newest.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_history.h"
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+size_t SizeESHistoryArena( int capacity )
+{
+	//! bytes of arena for capacity steps
+	if ( capacity <= 0 )
+	{
+		return 0;
+	}
+
+	return KFILTER_ALIGN( capacity * sizeof( es_history_step ) );
+}
+
+int InitESHistoryArena ( es_history *out, int capacity, void *arena )
+{
+	//! an empty history in arena, which the caller keeps
+	if ( capacity <= 0 || arena == NULL )
+	{
+		return -1;
+	}
+	out->step 		= (es_history_step *)arena;
+	out->capacity = capacity;
+
+	return ZeroESHistory ( out );
+}
+
+
+//!-------------------------------------------------------
+//! Zero Fcns
+//!-------------------------------------------------------
+int ZeroESHistory ( es_history *out )
+{
+	//! forgets every step
+	out->count 		= 0;
+	out->newest 	= out->capacity - 1;
+	out->dropped 	= 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Step Fcns - the ring by age
+//!-------------------------------------------------------
+//! step age steps before the newest
+static es_history_step * ESHistoryStep( es_history *in, int age )
+{
+	return &(in->step[ ( in->newest - age + in->capacity ) % in->capacity ]);
+}
+
+//! age of the step covering time, -1 if its step has left the ring
+static int ESHistoryAge( es_history *in, double time )
+{
+	es_history_step *oldest;
+	int age = 0;
+
+	//! the oldest step whose end is not before time
+	while ( age + 1 < in->count && ESHistoryStep( in, age + 1 )->time >= time )
+	{
+		age++;
+	}
+	oldest = ESHistoryStep( in, age );
+	if ( age == in->count - 1 && time < oldest->time - oldest->delta_time )
+	{
+		//! before the start of the ring, no snapshot covers it
+		return -1;
+	}
+
+	return age;
+}
+
+//! one measurement of a step
+static int ApplyESHistoryMeasurement( const es_history_measurement *in, es_filter *filter )
+{
+	switch ( in->kind )
+	{
+		case ESHISTORY_POSITION:
+			return ComputeESFilterPosition ( filter, in->value, in->variance );
+		case ESHISTORY_SPEED:
+			return ComputeESFilterSpeed ( filter, in->value[0], in->variance[0] );
+		case ESHISTORY_ATTITUDE:
+			return ComputeESFilterAttitude ( filter, in->value, in->variance[0] );
+	}
+
+	return -1;
+}
+
+//! the measurements of a step, in the order they came
+static int ApplyESHistoryStep( es_history_step *step, es_filter *filter )
+{
+	int status = 0;
+	int i;
+
+	for (i = 0; i < step->measurements; i++)
+	{
+		if ( ApplyESHistoryMeasurement ( &(step->measurement[i]), filter ) != 0 )
+		{
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+//! returns filter to the step of age and steps it again up to the newest
+static int ReplayESHistory( es_history *hist, es_filter *filter, int age )
+{
+	es_history_step *step;
+	int status = 0;
+	int a;
+
+	for (a = age; a >= 0; a--)
+	{
+		step = ESHistoryStep( hist, a );
+		if ( a == age )
+		{
+			SetESFilterSnapshot ( filter, &(step->start) );
+		}
+		else
+		{
+			//! later steps start from the corrected filter
+			GetESFilterSnapshot ( filter, &(step->start) );
+		}
+		if ( ComputeESFilterPropagate ( filter, step->accel, step->angrate, step->delta_time ) != 0 )
+		{
+			status = -1;
+		}
+		if ( ApplyESHistoryStep ( step, filter ) != 0 )
+		{
+			status = -1;
+		}
+	}
+
+	return status;
+}
+
+//! slot for a measurement taken at time, NULL without a history or if it is dropped
+//! age is set to the age of its step, or -1
+static es_history_measurement * PlaceESHistory( es_history *hist, double time, int *age )
+{
+	es_history_step *step;
+
+	if ( hist->count == 0 )
+	{
+		*age = -1;
+		return NULL;
+	}
+	*age = ESHistoryAge ( hist, time );
+	step = ( *age < 0 ) ? NULL : ESHistoryStep( hist, *age );
+	if ( step == NULL || step->measurements == ESHISTORY_MEASUREMENTS )
+	{
+		*age = -1;
+		hist->dropped++;
+		return NULL;
+	}
+
+	return &(step->measurement[ step->measurements++ ]);
+}
+
+//! applies a placed measurement, directly when it lands on the newest step
+static int CommitESHistory( es_history *hist, es_filter *filter, es_history_measurement *placed, int age )
+{
+	if ( age == 0 )
+	{
+		//! the last of the step, the ones before are already applied
+		return ApplyESHistoryMeasurement ( placed, filter );
+	}
+
+	return ReplayESHistory ( hist, filter, age );
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+int ComputeESHistoryPropagate ( es_history *hist, es_filter *filter, const double *accel, const double *angrate, double delta_t, double time )
+{
+	//! a new step, overwriting the oldest once the ring is full
+	es_history_step *step;
+	int i;
+
+	hist->newest = ( hist->newest + 1 ) % hist->capacity;
+	if ( hist->count < hist->capacity )
+	{
+		hist->count++;
+	}
+	step = ESHistoryStep( hist, 0 );
+
+	step->time 				= time;
+	step->delta_time 	= delta_t;
+	for (i = 0; i < 3; i++)
+	{
+		step->accel[i] 		= accel[i];
+		step->angrate[i] 	= angrate[i];
+	}
+	step->measurements = 0;
+	GetESFilterSnapshot ( filter, &(step->start) );
+
+	return ComputeESFilterPropagate ( filter, accel, angrate, delta_t );
+}
+
+int ComputeESHistoryPosition ( es_history *hist, es_filter *filter, const double *position, const double *variance, double time )
+{
+	es_history_measurement *placed;
+	int age, i;
+
+	placed = PlaceESHistory ( hist, time, &age );
+	if ( placed == NULL )
+	{
+		//! applied as current without a history, dropped when too old
+		return ( hist->count == 0 ) ? ComputeESFilterPosition ( filter, position, variance ) : -1;
+	}
+	placed->kind = ESHISTORY_POSITION;
+	for (i = 0; i < 3; i++)
+	{
+		placed->value[i] 		= position[i];
+		placed->variance[i] = variance[i];
+	}
+
+	return CommitESHistory ( hist, filter, placed, age );
+}
+
+int ComputeESHistorySpeed ( es_history *hist, es_filter *filter, double speed, double variance, double time )
+{
+	es_history_measurement *placed;
+	int age;
+
+	placed = PlaceESHistory ( hist, time, &age );
+	if ( placed == NULL )
+	{
+		return ( hist->count == 0 ) ? ComputeESFilterSpeed ( filter, speed, variance ) : -1;
+	}
+	placed->kind 				= ESHISTORY_SPEED;
+	placed->value[0] 		= speed;
+	placed->variance[0] = variance;
+
+	return CommitESHistory ( hist, filter, placed, age );
+}
+
+int ComputeESHistoryAttitude ( es_history *hist, es_filter *filter, const double *orient, double variance, double time )
+{
+	es_history_measurement *placed;
+	int age, i;
+
+	placed = PlaceESHistory ( hist, time, &age );
+	if ( placed == NULL )
+	{
+		return ( hist->count == 0 ) ? ComputeESFilterAttitude ( filter, orient, variance ) : -1;
+	}
+	placed->kind = ESHISTORY_ATTITUDE;
+	for (i = 0; i < 4; i++)
+	{
+		placed->value[i] = orient[i];
+	}
+	placed->variance[0] = variance;
+
+	return CommitESHistory ( hist, filter, placed, age );
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,133 @@
+//! filter_history.h
+//! error state filter history Header File
+//! past steps of an es_filter so late measurements land at their own time
+/*! $Id$ */
+
+/*
+
+	Measurements reach the localizer late: a GPS fix was taken its latency
+	before the packet arrives, and is fused later still.  An es_history keeps
+	the last capacity steps of an es_filter, each with
+
+		the snapshot of the filter before the step
+		the specific force, rate and length the step was propagated with
+		the measurements applied at the end of the step
+
+	in a ring of fixed size carved from a caller's arena, so nothing is
+	allocated while running.  Step k covers the time after the end of step
+	k-1 up to its own time.  A measurement is kept with the step covering its
+	time:
+
+		in the newest step, as almost all are, it is simply applied
+
+		in an older step the filter returns to the snapshot of that step and
+		only the steps from there on are stepped again, this time with the
+		late measurement in place, at the cost of one propagation each
+
+		before the start of the oldest step, the first one or one whose
+		predecessor was overwritten, no snapshot covers it, it is too old
+		to place and is dropped
+
+	A step holds up to ESHISTORY_MEASUREMENTS measurements, applied in the
+	order they came, so several sensors of one kind each count; one more
+	than that in a step is dropped.
+
+*/
+
+//! Includes
+#include "filter_error_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_HISTORY_H
+#define FILTER_HISTORY_H
+
+
+//! Defines
+
+//! kinds of measurement a step can hold
+#define ESHISTORY_POSITION			1
+#define ESHISTORY_SPEED					2
+#define ESHISTORY_ATTITUDE			4
+
+//! most measurements of a step
+#define ESHISTORY_MEASUREMENTS	8
+
+
+//! Data structs
+
+//! data struct a measurement held by a step
+typedef struct
+{
+	//! ESHISTORY_*
+	int kind;
+	//! position x y z, speed, or orientation s x y z
+	double value[4];
+	//! variance of each position component, or the one of speed or orientation
+	double variance[3];
+
+} es_history_measurement;
+
+//! data struct one step of the filter
+typedef struct
+{
+	//! time at the end of the step, seconds
+	double time;
+	//! length of the step
+	double delta_time;
+	//! specific force and rate the step was propagated with
+	double accel[3];
+	double angrate[3];
+	//! filter before the step
+	es_snapshot start;
+
+	//! measurements applied at the end of the step, in order
+	int measurements;
+	es_history_measurement measurement[ESHISTORY_MEASUREMENTS];
+
+} es_history_step;
+
+//! data struct ring of the last steps
+typedef struct
+{
+	//! steps, capacity of them
+	es_history_step *step;
+	int capacity;
+	//! steps held and the slot of the newest
+	int count;
+	int newest;
+	//! measurements too old to place, or beyond a full step
+	unsigned long dropped;
+
+} es_history;
+
+
+//! Functions
+
+//! Init Fcns
+//! bytes of arena for a history of capacity steps
+size_t SizeESHistoryArena( int capacity );
+//! an empty history of capacity steps in arena, aligned to KFILTER_ALIGNMENT
+int InitESHistoryArena ( es_history *out, int capacity, void *arena );
+
+//! Zero Fcns
+//! forgets every step
+int ZeroESHistory ( es_history *out );
+
+//! Compute Fcns - each acts on filter and records what it did
+//! propagates filter as ComputeESFilterPropagate in a new step ending at time
+int ComputeESHistoryPropagate ( es_history *hist, es_filter *filter, const double *accel, const double *angrate, double delta_t, double time );
+//! applies a position measured at time, as ComputeESFilterPosition
+int ComputeESHistoryPosition ( es_history *hist, es_filter *filter, const double *position, const double *variance, double time );
+//! applies a forward speed measured at time, as ComputeESFilterSpeed
+int ComputeESHistorySpeed ( es_history *hist, es_filter *filter, double speed, double variance, double time );
+//! applies an orientation measured at time, as ComputeESFilterAttitude
+int ComputeESHistoryAttitude ( es_history *hist, es_filter *filter, const double *orient, double variance, double time );
+
+#endif  //! define FILTER_HISTORY_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
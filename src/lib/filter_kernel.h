@@ -0,0 +1,280 @@
+//! filter_kernel.h
+//! Kalman filter kernel Header File
+//! inline building blocks shared by the BLAS free filter kernels
+/*! $Id$ */
+
+/*
+
+	These are the loop bodies common to every kernel that steps a k_filter
+	without BLAS.  They are static inline so a kernel instantiated with a
+	constant n unrolls them completely, while a kernel called with a run time
+	n gets ordinary loops.
+
+	Matrix products use the row major ordering of the cblas_dgemm calls in
+	filter.c and matrix vector products use the column ordering of
+	MultiplyMatrixVector so the results agree with ComputeKFilter.
+
+	Only include this from the filter_*.c files.
+
+*/
+
+//! Includes
+#include <math.h>		// fabs, sqrt
+
+#include "filter.h"
+#include "cpu_dispatch.h"	// CPU_DISPATCH for the kernels built on these bodies
+
+#ifndef FILTER_KERNEL_H
+#define FILTER_KERNEL_H
+
+
+//! Defines
+
+//! force a body into each sized instance
+#ifdef __GNUC__
+#define KFILTER_INLINE		static inline __attribute__((always_inline))
+#else
+#define KFILTER_INLINE		static inline
+#endif
+
+//! row major entry of an n x n matrix as read by cblas_dgemm
+#define RM(M,n,i,j)		((M)[(i)*(n) + (j)])
+
+//! entry of a symmetric matrix of which only the lower triangle is current
+#define SYM(M,n,i,j)	( (i) >= (j) ? RM(M,n,i,j) : RM(M,n,j,i) )
+
+
+//! Functions
+
+/*
+	KFilterKernelAPrioriProduct forms
+		x_hat	= AK ( y - x_hat_ ) + A x_hat_ + B u
+	from AK and innovation = y - x_hat_ already in place.
+*/
+KFILTER_INLINE void KFilterKernelAPrioriProduct( k_filter *out, const int n, double *AK, double *innovation )
+{
+	double sum;
+	int i, k;
+
+	for (i = 0; i < n; i++)
+	{
+		sum = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(AK,n,k,i) * innovation[k];
+			sum += RM(out->A,n,k,i) * out->x_hat_[k];
+			sum += RM(out->B,n,k,i) * out->u[k];
+		}
+		out->x_hat[i] = sum;
+	}
+}
+
+/*
+	KFilterKernelAPriori computes the estimate recursion / predictive estimate
+		x_hat_	= x_hat
+		x_hat	= AK ( y - x_hat_ ) + A x_hat_ + B u
+	AK and innovation are n x n and n scratch storage.
+*/
+KFILTER_INLINE void KFilterKernelAPriori( k_filter *out, const int n, double *AK, double *innovation )
+{
+	double sum;
+	int i, j, k;
+
+	// copy x_hat into x_hat_ and form y - x_hat_
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat_[i] = out->x_hat[i];
+		innovation[i] = out->y[i] - out->x_hat_[i];
+	}
+	// AK
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->K,n,k,j);
+			}
+			RM(AK,n,i,j) = sum;
+		}
+	}
+	// AK( y - x_hat_ ) + A x_hat_ + Bu
+	KFilterKernelAPrioriProduct( out, n, AK, innovation );
+}
+
+/*
+	KFilterKernelAPosteriori computes the current state estimate
+		x_hat	= x_hat + K ( C x_hat - y )
+	leaving C x_hat - y in y_hat_ and the correction in y_hat.
+*/
+KFILTER_INLINE void KFilterKernelAPosteriori( k_filter *out, const int n )
+{
+	double sum;
+	int i, k;
+
+	// C x_hat - y
+	for (i = 0; i < n; i++)
+	{
+		sum = -out->y[i];
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->C,n,k,i) * out->x_hat[k];
+		}
+		out->y_hat_[i] = sum;
+	}
+	// K ( C x_hat - y ) added to x_hat
+	for (i = 0; i < n; i++)
+	{
+		sum = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->K,n,k,i) * out->y_hat_[k];
+		}
+		out->y_hat[i] = sum;
+		out->x_hat[i] += sum;
+	}
+}
+
+/*
+	KFilterKernelInvert computes the inverse of the n x n matrix in S and
+	places it in out.  Gauss-Jordan elimination with partial pivoting is used
+	which is the same factorization clapack_dgesv applies.  S is destroyed.
+	Returns -1 if S is singular.
+*/
+KFILTER_INLINE int KFilterKernelInvert( double *S, double *out, const int n )
+{
+	int i, j, k, p;
+	double pivot, factor, temp;
+
+	// start out as identity
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			RM(out,n,i,j) = ( i == j ) ? 1.0 : 0.0;
+		}
+	}
+
+	for (k = 0; k < n; k++)
+	{
+		// find largest pivot in the column
+		p = k;
+		for (i = k + 1; i < n; i++)
+		{
+			if ( fabs( RM(S,n,i,k) ) > fabs( RM(S,n,p,k) ) )
+			{
+				p = i;
+			}
+		}
+		if ( RM(S,n,p,k) == 0.0 )
+		{
+			// singular matrix
+			return -1;
+		}
+		// swap rows into place
+		if ( p != k )
+		{
+			for (j = 0; j < n; j++)
+			{
+				temp = RM(S,n,k,j);		RM(S,n,k,j) = RM(S,n,p,j);		RM(S,n,p,j) = temp;
+				temp = RM(out,n,k,j);	RM(out,n,k,j) = RM(out,n,p,j);	RM(out,n,p,j) = temp;
+			}
+		}
+		// normalize the pivot row
+		pivot = 1.0 / RM(S,n,k,k);
+		for (j = 0; j < n; j++)
+		{
+			RM(S,n,k,j) 	*= pivot;
+			RM(out,n,k,j) 	*= pivot;
+		}
+		// eliminate the column from all other rows
+		for (i = 0; i < n; i++)
+		{
+			if ( i != k )
+			{
+				factor = RM(S,n,i,k);
+				for (j = 0; j < n; j++)
+				{
+					RM(S,n,i,j) 	-= factor * RM(S,n,k,j);
+					RM(out,n,i,j) 	-= factor * RM(out,n,k,j);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+	KFilterKernelCholesky factors the lower triangle of the symmetric n x n
+	matrix S into L trans(L) in place, dpotrf style.  The upper triangle is
+	not referenced.  Returns -1 if S is not positive definite.
+*/
+KFILTER_INLINE int KFilterKernelCholesky( double *S, const int n )
+{
+	double sum;
+	int i, j, k;
+
+	for (j = 0; j < n; j++)
+	{
+		// diagonal entry
+		sum = RM(S,n,j,j);
+		for (k = 0; k < j; k++)
+		{
+			sum -= RM(S,n,j,k) * RM(S,n,j,k);
+		}
+		if ( sum <= 0.0 )
+		{
+			// not positive definite
+			return -1;
+		}
+		RM(S,n,j,j) = sqrt( sum );
+		// column below the diagonal
+		for (i = j + 1; i < n; i++)
+		{
+			sum = RM(S,n,i,j);
+			for (k = 0; k < j; k++)
+			{
+				sum -= RM(S,n,i,k) * RM(S,n,j,k);
+			}
+			RM(S,n,i,j) = sum / RM(S,n,j,j);
+		}
+	}
+
+	return 0;
+}
+
+/*
+	KFilterKernelCholeskySolve solves L trans(L) z = b in place in b for the
+	factor left in the lower triangle of S by KFilterKernelCholesky, dpotrs
+	style.
+*/
+KFILTER_INLINE void KFilterKernelCholeskySolve( const double *S, const int n, double *b )
+{
+	double sum;
+	int i, k;
+
+	// forward substitution L w = b
+	for (i = 0; i < n; i++)
+	{
+		sum = b[i];
+		for (k = 0; k < i; k++)
+		{
+			sum -= RM(S,n,i,k) * b[k];
+		}
+		b[i] = sum / RM(S,n,i,i);
+	}
+	// back substitution trans(L) z = w
+	for (i = n - 1; i >= 0; i--)
+	{
+		sum = b[i];
+		for (k = i + 1; k < n; k++)
+		{
+			sum -= RM(S,n,k,i) * b[k];
+		}
+		b[i] = sum / RM(S,n,i,i);
+	}
+}
+
+#endif  //! define FILTER_KERNEL_H
@@ -0,0 +1,794 @@
+//! filter_plan.c
+//!
+//! planned Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the planner and the operations it compiles into a
+	filter step.  Each operation is a small fcn over the whole filter so the
+	plan is simply an array of fcn ptrs stored in the k_filter.
+
+	Sources read by an operation follow the skipped work: with C identity
+	P trans(C) is P itself, so the gain operation reads P instead of PC.
+
+	Scratch storage:
+
+		PC		P trans(C)
+		CPC_R	R + C P trans(C)
+		CPC		inv( R + C P trans(C) ), then C P
+		CP		P - K C P
+		AK		AK, then ( P - K C P ) trans(A)
+		Ax		y - x_hat_
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_plan.h"
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Compute Fcns - the planned operations
+//!-------------------------------------------------------
+
+//! gain: P trans(C) for diagonal C
+static int PlanOpGainPCDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			RM(out->PC,n,i,j) = RM(out->P,n,i,j) * RM(out->C,n,j,j);
+		}
+	}
+
+	return 0;
+}
+
+//! gain: P trans(C) for dense C
+CPU_DISPATCH static int PlanOpGainPCDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->P,n,i,k) * RM(out->C,n,j,k);
+			}
+			RM(out->PC,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! gain: R + C P trans(C) for identity C
+static int PlanOpGainSIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i;
+
+	for (i = 0; i < n*n; i++)
+	{
+		out->CPC_R[i] = out->P[i] + out->R[i];
+	}
+
+	return 0;
+}
+
+//! gain: R + C P trans(C) for diagonal C
+static int PlanOpGainSDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			RM(out->CPC_R,n,i,j) = RM(out->C,n,i,i) * RM(out->PC,n,i,j) + RM(out->R,n,i,j);
+		}
+	}
+
+	return 0;
+}
+
+//! gain: R + C P trans(C) for dense C
+CPU_DISPATCH static int PlanOpGainSDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->R,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,i,k) * RM(out->PC,n,k,j);
+			}
+			RM(out->CPC_R,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! gain: K = P trans(C) inv( R + C P trans(C) )
+static int PlanOpGainK( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+	double *PC;
+
+	// P trans(C) is P when C is identity
+	PC = ( out->C_structure == KFILTER_MATRIX_IDENTITY ) ? out->P : out->PC;
+
+	if ( KFilterKernelInvert( out->CPC_R, out->CPC, n ) != 0 )
+	{
+		return -1;
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(PC,n,i,k) * RM(out->CPC,n,k,j);
+			}
+			RM(out->K,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! a priori: x_hat = K ( y - x_hat_ ) + x_hat_ for identity A
+static int PlanOpAPrioriIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat_[i] = out->x_hat[i];
+		out->Ax[i] = out->y[i] - out->x_hat_[i];
+	}
+	for (i = 0; i < n; i++)
+	{
+		sum = out->x_hat_[i];
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->K,n,k,i) * out->Ax[k];
+		}
+		out->x_hat[i] = sum;
+	}
+
+	return 0;
+}
+
+//! a priori: x_hat = AK ( y - x_hat_ ) + A x_hat_ for diagonal A
+static int PlanOpAPrioriDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat_[i] = out->x_hat[i];
+		out->Ax[i] = RM(out->A,n,i,i) * ( out->y[i] - out->x_hat_[i] );
+	}
+	for (i = 0; i < n; i++)
+	{
+		sum = RM(out->A,n,i,i) * out->x_hat_[i];
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->K,n,k,i) * out->Ax[k];
+		}
+		out->x_hat[i] = sum;
+	}
+
+	return 0;
+}
+
+//! a priori: x_hat = AK ( y - x_hat_ ) + A x_hat_ for dense A
+CPU_DISPATCH static int PlanOpAPrioriDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat_[i] = out->x_hat[i];
+		out->Ax[i] = out->y[i] - out->x_hat_[i];
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->K,n,k,j);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		sum = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->AK,n,k,i) * out->Ax[k];
+			sum += RM(out->A,n,k,i) * out->x_hat_[k];
+		}
+		out->x_hat[i] = sum;
+	}
+
+	return 0;
+}
+
+//! control: x_hat += Bu for identity B
+static int PlanOpControlIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int i;
+
+	for (i = 0; i < out->num_elements; i++)
+	{
+		out->x_hat[i] += out->u[i];
+	}
+
+	return 0;
+}
+
+//! control: x_hat += Bu for diagonal B
+static int PlanOpControlDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat[i] += RM(out->B,n,i,i) * out->u[i];
+	}
+
+	return 0;
+}
+
+//! control: x_hat += Bu for dense B
+CPU_DISPATCH static int PlanOpControlDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		sum = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->B,n,k,i) * out->u[k];
+		}
+		out->x_hat[i] += sum;
+	}
+
+	return 0;
+}
+
+//! measurement: P - K C P for identity C
+static int PlanOpMeasurementIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->P,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum -= RM(out->K,n,i,k) * RM(out->P,n,k,j);
+			}
+			RM(out->CP,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! measurement: P - K C P for diagonal C
+static int PlanOpMeasurementDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->P,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum -= RM(out->K,n,i,k) * RM(out->C,n,k,k) * RM(out->P,n,k,j);
+			}
+			RM(out->CP,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! measurement: P - K C P for dense C
+CPU_DISPATCH static int PlanOpMeasurementDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	// C P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,i,k) * RM(out->P,n,k,j);
+			}
+			RM(out->CPC,n,i,j) = sum;
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->P,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum -= RM(out->K,n,i,k) * RM(out->CPC,n,k,j);
+			}
+			RM(out->CP,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! time: P = A P trans(A) + GQG for identity A
+static int PlanOpTimeIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i;
+
+	for (i = 0; i < n*n; i++)
+	{
+		out->P[i] = out->CP[i] + out->GQG[i];
+	}
+
+	return 0;
+}
+
+//! time: P = A P trans(A) + GQG for diagonal A
+static int PlanOpTimeDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			RM(out->P,n,i,j) = RM(out->A,n,i,i) * RM(out->CP,n,i,j) * RM(out->A,n,j,j) + RM(out->GQG,n,i,j);
+		}
+	}
+
+	return 0;
+}
+
+//! time: P = A P trans(A) + GQG for dense A
+CPU_DISPATCH static int PlanOpTimeDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	// P trans(A)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->CP,n,i,k) * RM(out->A,n,j,k);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->GQG,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->AK,n,k,j);
+			}
+			RM(out->P,n,i,j) = sum;
+		}
+	}
+
+	return 0;
+}
+
+//! a posteriori: x_hat += K ( y_hat_ ) once y_hat_ = C x_hat - y is formed
+KFILTER_INLINE void PlanAPosterioriCorrect( k_filter *out, const int n )
+{
+	int i, k;
+	double sum;
+
+	for (i = 0; i < n; i++)
+	{
+		sum = 0.0;
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->K,n,k,i) * out->y_hat_[k];
+		}
+		out->y_hat[i] = sum;
+		out->x_hat[i] += sum;
+	}
+}
+
+//! a posteriori: x_hat += K ( C x_hat - y ) for identity C
+static int PlanOpAPosterioriIdentity( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		out->y_hat_[i] = out->x_hat[i] - out->y[i];
+	}
+	PlanAPosterioriCorrect( out, n );
+
+	return 0;
+}
+
+//! a posteriori: x_hat += K ( C x_hat - y ) for diagonal C
+static int PlanOpAPosterioriDiagonal( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int n = out->num_elements;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		out->y_hat_[i] = RM(out->C,n,i,i) * out->x_hat[i] - out->y[i];
+	}
+	PlanAPosterioriCorrect( out, n );
+
+	return 0;
+}
+
+//! a posteriori: x_hat += K ( C x_hat - y ) for dense C
+CPU_DISPATCH static int PlanOpAPosterioriDense( void *in )
+{
+	k_filter *out = (k_filter *)in;
+
+	KFilterKernelAPosteriori( out, out->num_elements );
+
+	return 0;
+}
+
+//! runs the compiled plan
+int ComputeKFilterPlanned( void *in )
+{
+	k_filter *out = (k_filter *)in;
+	int i;
+
+	for (i = 0; i < out->plan_length; i++)
+	{
+		if ( out->plan[i]( in ) != 0 )
+		{
+			// singular innovation covariance
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Plan Fcns
+//!-------------------------------------------------------
+//! returns the KFILTER_MATRIX_* structure of the n x n matrix
+int ClassifyKFilterMatrix( double *in, int n )
+{
+	int i, j;
+	int zero 			= 1;
+	int identity 	= 1;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			if ( i != j && RM(in,n,i,j) != 0.0 )
+			{
+				// off diagonal entry
+				return KFILTER_MATRIX_DENSE;
+			}
+		}
+		if ( RM(in,n,i,i) != 0.0 )
+		{
+			zero = 0;
+		}
+		if ( RM(in,n,i,i) != 1.0 )
+		{
+			identity = 0;
+		}
+	}
+
+	if ( zero )
+	{
+		return KFILTER_MATRIX_ZERO;
+	}
+	if ( identity )
+	{
+		return KFILTER_MATRIX_IDENTITY;
+	}
+	return KFILTER_MATRIX_DIAGONAL;
+}
+
+//! tags the model matrices, caches GQG and compiles the plan
+int PlanKFilter( k_filter *out )
+{
+	int n = out->num_elements;
+	int i, j, k;
+	double sum;
+
+	// tag the model matrices
+	out->A_structure = ClassifyKFilterMatrix( out->A, n );
+	out->B_structure = ClassifyKFilterMatrix( out->B, n );
+	out->C_structure = ClassifyKFilterMatrix( out->C, n );
+	out->G_structure = ClassifyKFilterMatrix( out->G, n );
+	out->Q_structure = ClassifyKFilterMatrix( out->Q, n );
+	out->R_structure = ClassifyKFilterMatrix( out->R, n );
+
+	// cache G Q trans(G), constant until G or Q are set
+	if ( out->G_structure == KFILTER_MATRIX_IDENTITY )
+	{
+		CopyMatrix( out->Q, out->GQG, n );
+	}
+	else
+	{
+		// Q trans(G)
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < n; j++)
+			{
+				sum = 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->Q,n,i,k) * RM(out->G,n,j,k);
+				}
+				RM(out->QG,n,i,j) = sum;
+			}
+		}
+		// G Q trans(G)
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < n; j++)
+			{
+				sum = 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->G,n,i,k) * RM(out->QG,n,k,j);
+				}
+				RM(out->GQG,n,i,j) = sum;
+			}
+		}
+	}
+
+	// compile the step - a zero C or A acts as a diagonal one
+	out->plan_length = 0;
+
+	// gain
+	switch ( out->C_structure )
+	{
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpGainSIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpGainPCDense;
+			out->plan[out->plan_length++] = PlanOpGainSDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpGainPCDiagonal;
+			out->plan[out->plan_length++] = PlanOpGainSDiagonal;
+			break;
+		}
+	}
+	out->plan[out->plan_length++] = PlanOpGainK;
+
+	// a priori
+	switch ( out->A_structure )
+	{
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpAPrioriIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpAPrioriDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpAPrioriDiagonal;
+			break;
+		}
+	}
+
+	// control
+	switch ( out->B_structure )
+	{
+		case KFILTER_MATRIX_ZERO:
+		{
+			// nil control input matrix
+			break;
+		}
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpControlIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpControlDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpControlDiagonal;
+			break;
+		}
+	}
+
+	// measurement update of P
+	switch ( out->C_structure )
+	{
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpMeasurementIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpMeasurementDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpMeasurementDiagonal;
+			break;
+		}
+	}
+
+	// time update of P
+	switch ( out->A_structure )
+	{
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpTimeIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpTimeDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpTimeDiagonal;
+			break;
+		}
+	}
+
+	// a posteriori
+	switch ( out->C_structure )
+	{
+		case KFILTER_MATRIX_IDENTITY:
+		{
+			out->plan[out->plan_length++] = PlanOpAPosterioriIdentity;
+			break;
+		}
+		case KFILTER_MATRIX_DENSE:
+		{
+			out->plan[out->plan_length++] = PlanOpAPosterioriDense;
+			break;
+		}
+		default:
+		{
+			out->plan[out->plan_length++] = PlanOpAPosterioriDiagonal;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the planned kernel when structure can be exploited
+int SelectKFilterPlannedKernel( k_filter *out )
+{
+	if ( out->A_structure == KFILTER_MATRIX_DENSE &&
+			 out->B_structure == KFILTER_MATRIX_DENSE &&
+			 out->C_structure == KFILTER_MATRIX_DENSE )
+	{
+		// nothing to skip, leave the choice to the other kernels
+		return -1;
+	}
+
+	out->ComputeKernel = ComputeKFilterPlanned;
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
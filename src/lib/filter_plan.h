@@ -0,0 +1,62 @@
+//! filter_plan.h
+//! planned Kalman filter Header File
+//! compiles a filter step from the structure of the model matrices
+/*! $Id$ */
+
+/*
+
+	The filter is formulated with A = I, G = I and B nil, yet the general path
+	multiplies through every one of them on each step, recomputes G Q trans(G)
+	although neither G nor Q change, and copies matrices around to work
+	around cblas_dgemm aliasing.
+
+	PlanKFilter inspects A, B, C, G, Q and R whenever they are set and tags
+	each one as zero, identity, diagonal or dense.  It then caches the
+	invariant product G Q trans(G) in GQG and compiles the shortest sequence
+	of operations that computes the same step as ComputeKFilter:
+
+		gain			K = P trans(C) inv( R + C P trans(C) )
+		a priori		x_hat = AK ( y - x_hat_ ) + A x_hat_
+		control			x_hat += Bu						(omitted when B is zero)
+		measurement		P = P - K C P
+		time			P = A P trans(A) + GQG
+		a posteriori	x_hat += K ( C x_hat - y )
+
+	Every stage has a variant for an identity, diagonal and dense matrix.  The
+	plan stays current until one of the SetKFilter*Matrix fcns changes a
+	matrix and replans.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_PLAN_H
+#define FILTER_PLAN_H
+
+
+//! Functions
+
+//! Plan Fcns
+//! returns the KFILTER_MATRIX_* structure of the n x n matrix
+int ClassifyKFilterMatrix( double *in, int n );
+//! tags the model matrices, caches GQG and compiles the plan
+int PlanKFilter( k_filter *out );
+
+//! Select Fcns
+//! aims ComputeKernel at the planned kernel
+//! returns 0 when the plan saves work over a dense step and -1 otherwise
+int SelectKFilterPlannedKernel( k_filter *out );
+
+//! Compute Fcns - runs the compiled plan as one complete filter step
+int ComputeKFilterPlanned( void *in );
+
+#endif  //! define FILTER_PLAN_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
@@ -0,0 +1,249 @@
+//! filter_sequential.c
+//!
+//! sequential update Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the sequential update kernels for the Kalman filter.
+
+	As with the fixed kernels a single step body is instantiated for each of
+	the scripted sensor sizes with n a constant, plus once with a run time n
+	for any other size.  The filter's own computation matrices are used as
+	scratch storage:
+
+		CP		P after the measurement update
+		PC		row j holds P trans(c) of measurement j
+		CPC		row j holds c P of measurement j
+		AK		AK, then A P
+		Ax		y - x_hat_
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_sequential.h"
+#include "filter_fixed.h"		// scripted sensor sizes
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+
+/*
+	ComputeKFilterSequentialStep is the body of every sequential kernel.  It
+	computes one complete filter step in the same order as ComputeKFilter.
+*/
+KFILTER_INLINE int ComputeKFilterSequentialStep( k_filter *out, const int n )
+{
+	double sum, s;
+	int i, j, k;
+
+	// measurement update one measurement at a time
+
+	for (i = 0; i < n*n; i++)
+	{
+		out->CP[i] = out->P[i];
+	}
+	for (j = 0; j < n; j++)
+	{
+		if ( !out->measured[j] )
+		{
+			continue;
+		}
+		// P trans(c) and c P
+		for (i = 0; i < n; i++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->CP,n,i,k) * RM(out->C,n,j,k);
+			}
+			RM(out->PC,n,j,i) = sum;
+
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,j,k) * RM(out->CP,n,k,i);
+			}
+			RM(out->CPC,n,j,i) = sum;
+		}
+		// s = c P trans(c) + r
+		s = RM(out->R,n,j,j);
+		for (i = 0; i < n; i++)
+		{
+			s += RM(out->C,n,j,i) * RM(out->PC,n,j,i);
+		}
+		if ( s <= 0.0 || RM(out->R,n,j,j) <= 0.0 )
+		{
+			return -1;
+		}
+		// P = P - P trans(c) ( c P ) / s
+		s = 1.0 / s;
+		for (i = 0; i < n; i++)
+		{
+			for (k = 0; k < n; k++)
+			{
+				RM(out->CP,n,i,k) -= RM(out->PC,n,j,i) * RM(out->CPC,n,j,k) * s;
+			}
+		}
+	}
+
+	// compute K gain as P trans(C) inv(R)
+
+	for (j = 0; j < n; j++)
+	{
+		if ( !out->measured[j] )
+		{
+			for (i = 0; i < n; i++)
+			{
+				RM(out->K,n,i,j) = 0.0;
+			}
+			continue;
+		}
+		s = 1.0 / RM(out->R,n,j,j);
+		for (i = 0; i < n; i++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->CP,n,i,k) * RM(out->C,n,j,k);
+			}
+			RM(out->K,n,i,j) = sum * s;
+		}
+	}
+
+	// compute estimate recursion / predictive estimate
+
+	KFilterKernelAPriori( out, n, out->AK, out->Ax );
+
+	// compute covariance recursion
+
+	// A P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->CP,n,k,j);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	// P = A P trans(A) + GQG
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->GQG,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->AK,n,i,k) * RM(out->A,n,j,k);
+			}
+			RM(out->P,n,i,j) = sum;
+		}
+	}
+
+	// compute state vector estimate
+
+	KFilterKernelAPosteriori( out, n );
+
+	return 0;
+}
+
+//! one copy per instruction set, stepped through the plain kernels below
+static CPU_DISPATCH int KFilterSequential( k_filter *out )
+{
+	return ComputeKFilterSequentialStep( out, out->num_elements );
+}
+
+static CPU_DISPATCH int KFilterSequential4( k_filter *out )
+{
+	return ComputeKFilterSequentialStep( out, KFILTER_FIXED_ODOM );
+}
+
+static CPU_DISPATCH int KFilterSequential7( k_filter *out )
+{
+	return ComputeKFilterSequentialStep( out, KFILTER_FIXED_GPS );
+}
+
+static CPU_DISPATCH int KFilterSequential16( k_filter *out )
+{
+	return ComputeKFilterSequentialStep( out, KFILTER_FIXED_IMU );
+}
+
+//! any size
+int ComputeKFilterSequential( void *in )
+{
+	return KFilterSequential( (k_filter *)in );
+}
+
+//! odometer sized kernel
+int ComputeKFilterSequential4( void *in )
+{
+	return KFilterSequential4( (k_filter *)in );
+}
+
+//! gps sized kernel
+int ComputeKFilterSequential7( void *in )
+{
+	return KFilterSequential7( (k_filter *)in );
+}
+
+//! imu sized kernel
+int ComputeKFilterSequential16( void *in )
+{
+	return KFilterSequential16( (k_filter *)in );
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the sequential kernel for the filter size
+int SelectKFilterSequentialKernel( k_filter *out )
+{
+	// correlated measurements need the batch update
+	if ( out->R_structure != KFILTER_MATRIX_DIAGONAL && out->R_structure != KFILTER_MATRIX_IDENTITY )
+	{
+		return -1;
+	}
+
+	switch ( out->num_elements )
+	{
+		case KFILTER_FIXED_ODOM:
+		{
+			out->ComputeKernel = ComputeKFilterSequential4;
+			break;
+		}
+		case KFILTER_FIXED_GPS:
+		{
+			out->ComputeKernel = ComputeKFilterSequential7;
+			break;
+		}
+		case KFILTER_FIXED_IMU:
+		{
+			out->ComputeKernel = ComputeKFilterSequential16;
+			break;
+		}
+		default:
+		{
+			out->ComputeKernel = ComputeKFilterSequential;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,64 @@
+//! filter_sequential.h
+//! sequential update Kalman filter Header File
+//! processes the measurements one at a time when R is diagonal
+/*! $Id$ */
+
+/*
+
+	With R diagonal the measurements are uncorrelated and the measurement
+	update P = P - K C P can be applied one measurement at a time.  Each one
+	costs a scalar division and a rank one update of P:
+
+		v		= P trans(c)
+		s		= c P trans(c) + r
+		P		= P - v ( c P ) / s
+
+	where c is the row of C and r the entry of R for that measurement.  Once
+	all are applied the gain follows without any factorization as
+
+		K		= P trans(C) inv(R)
+
+	which equals P trans(C) inv( R + C P trans(C) ) of the batch update.  The
+	rest of the step is unchanged so the results agree with ComputeKFilter
+	within rounding.
+
+	Elements of y whose measured flag is clear are skipped, their column of K
+	is zero and they leave P and x_hat untouched: a partial measurement
+	vector needs no resizing of the filter.
+
+	The sequential kernel is opt-in through SetKFilterUpdateMode.  It is only
+	used while R is diagonal and with every positive entry of R, otherwise the
+	filter steps with its batch kernel.  The covariance update is always the
+	general form whatever covariance_mode holds.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_SEQUENTIAL_H
+#define FILTER_SEQUENTIAL_H
+
+
+//! Functions
+
+//! Select Fcns
+//! aims ComputeKernel at the sequential kernel for the filter size
+//! returns 0 when selected and -1 when R is not diagonal
+int SelectKFilterSequentialKernel( k_filter *out );
+
+//! Compute Fcns - each does one complete filter step
+int ComputeKFilterSequential( void *in );		//! any size
+int ComputeKFilterSequential4( void *in );	//! odometer
+int ComputeKFilterSequential7( void *in );	//! gps
+int ComputeKFilterSequential16( void *in );	//! imu
+
+#endif  //! define FILTER_SEQUENTIAL_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
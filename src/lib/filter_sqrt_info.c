@@ -0,0 +1,481 @@
+//! filter_sqrt_info.c
+//!
+//! square root information Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the square root information kernels for the Kalman
+	filter.  Both triangularizations are Householder reflections that skip
+	the entries already zero, so the QR costs about 2 n^3 and the RQ about
+	3 n^3 flops.  Every reflection leaves a positive diagonal so the factors
+	stay unique from step to step.
+
+	As with the fixed kernels a single step body is instantiated for each of
+	the scripted sensor sizes with n a constant, plus once with a run time n
+	for any other size.  The filter's own computation matrices are used as
+	scratch storage:
+
+		CPC_R	L of R = L trans(L)
+		PC		inv(L) C, then inv(L) C S trans(S)
+		CPC		inv(L) C reduced by the QR, then inv(L) C S
+		CP		S = inv(info_root) after the measurement update
+		AK		AK, then A S, then S_
+		QG		Lq of Q = Lq trans(Lq)
+		GQG		G Lq, reduced by the RQ
+		Ax		y - x_hat_
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_sqrt_info.h"
+#include "filter_symmetric.h"	// fallback when P cannot be factored
+#include "filter_fixed.h"		// scripted sensor sizes
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Factor Fcns
+//!-------------------------------------------------------
+
+/*
+	KFilterSqrtInfoInvert computes the inverse of the upper triangular T
+	into the upper triangle of out, the strict lower triangle of out is
+	zeroed.  Returns -1 if T is singular.
+*/
+KFILTER_INLINE int KFilterSqrtInfoInvert( const double *T, double *out, const int n )
+{
+	double sum;
+	int i, j, k;
+
+	for (j = n - 1; j >= 0; j--)
+	{
+		if ( RM(T,n,j,j) == 0.0 )
+		{
+			// singular factor
+			return -1;
+		}
+		RM(out,n,j,j) = 1.0 / RM(T,n,j,j);
+		for (i = j - 1; i >= 0; i--)
+		{
+			sum = 0.0;
+			for (k = i + 1; k <= j; k++)
+			{
+				sum += RM(T,n,i,k) * RM(out,n,k,j);
+			}
+			RM(out,n,i,j) = -sum / RM(T,n,i,i);
+		}
+		for (i = j + 1; i < n; i++)
+		{
+			RM(out,n,i,j) = 0.0;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	KFilterSqrtInfoCholesky factors the symmetric positive semidefinite M,
+	of which only the lower triangle is read, into L trans(L) with L lower
+	triangular.  A pivot that is not positive leaves a zero column, as a
+	process noise with fewer inputs than states does.
+*/
+KFILTER_INLINE void KFilterSqrtInfoCholesky( const double *M, double *L, const int n )
+{
+	double sum;
+	int i, j, k;
+
+	for (j = 0; j < n; j++)
+	{
+		sum = RM(M,n,j,j);
+		for (k = 0; k < j; k++)
+		{
+			sum -= RM(L,n,j,k) * RM(L,n,j,k);
+		}
+		RM(L,n,j,j) = ( sum > 0.0 ) ? sqrt( sum ) : 0.0;
+		for (i = j + 1; i < n; i++)
+		{
+			sum = RM(M,n,i,j);
+			for (k = 0; k < j; k++)
+			{
+				sum -= RM(L,n,i,k) * RM(L,n,j,k);
+			}
+			RM(L,n,i,j) = ( RM(L,n,j,j) > 0.0 ) ? sum / RM(L,n,j,j) : 0.0;
+		}
+		for (i = 0; i < j; i++)
+		{
+			RM(L,n,i,j) = 0.0;
+		}
+	}
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+
+/*
+	ComputeKFilterSqrtInfoStep is the body of every square root information
+	kernel.  It computes one complete filter step in the same order as
+	ComputeKFilter.
+*/
+KFILTER_INLINE int ComputeKFilterSqrtInfoStep( k_filter *out, const int n )
+{
+	double *T = out->info_root;
+	double sum, alpha, norm, diagonal, v, factor;
+	int i, j, k;
+
+	// measurement update
+
+	// R = L trans(L)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j <= i; j++)
+		{
+			RM(out->CPC_R,n,i,j) = RM(out->R,n,i,j);
+		}
+	}
+	if ( KFilterKernelCholesky( out->CPC_R, n ) != 0 )
+	{
+		return -1;
+	}
+	// inv(L) C by forward substitution, kept in PC and reduced in CPC
+	for (j = 0; j < n; j++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			sum = RM(out->C,n,i,j);
+			for (k = 0; k < i; k++)
+			{
+				sum -= RM(out->CPC_R,n,i,k) * RM(out->PC,n,k,j);
+			}
+			RM(out->PC,n,i,j) = sum / RM(out->CPC_R,n,i,i);
+			RM(out->CPC,n,i,j) = RM(out->PC,n,i,j);
+		}
+	}
+	// QR of info_root over inv(L) C, column j reflects row j of info_root with column j of CPC
+	for (j = 0; j < n; j++)
+	{
+		sum = 0.0;
+		for (i = 0; i < n; i++)
+		{
+			sum += RM(out->CPC,n,i,j) * RM(out->CPC,n,i,j);
+		}
+		if ( sum == 0.0 )
+		{
+			// nothing measured through this state
+			continue;
+		}
+		alpha = RM(T,n,j,j);
+		norm = sqrt( alpha*alpha + sum );
+		diagonal = ( alpha > 0.0 ) ? -norm : norm;
+		v = alpha - diagonal;
+		factor = 1.0 / ( v*v + sum );
+		for (k = j + 1; k < n; k++)
+		{
+			sum = v * RM(T,n,j,k);
+			for (i = 0; i < n; i++)
+			{
+				sum += RM(out->CPC,n,i,j) * RM(out->CPC,n,i,k);
+			}
+			sum *= 2.0 * factor;
+			RM(T,n,j,k) -= sum * v;
+			for (i = 0; i < n; i++)
+			{
+				RM(out->CPC,n,i,k) -= sum * RM(out->CPC,n,i,j);
+			}
+			// the sign flip of the row keeps the diagonal positive
+			if ( diagonal < 0.0 )
+			{
+				RM(T,n,j,k) = -RM(T,n,j,k);
+			}
+		}
+		RM(T,n,j,j) = fabs( diagonal );
+	}
+	// S = inv(info_root), P - K C P = S trans(S)
+	if ( KFilterSqrtInfoInvert( T, out->CP, n ) != 0 )
+	{
+		return -1;
+	}
+
+	// compute K gain
+
+	// K = S trans(S) trans(C) inv(R), trans(K) = inv(trans(L)) inv(L) C S trans(S)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k <= j; k++)
+			{
+				sum += RM(out->PC,n,i,k) * RM(out->CP,n,k,j);
+			}
+			RM(out->CPC,n,i,j) = sum;
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = j; k < n; k++)
+			{
+				sum += RM(out->CPC,n,i,k) * RM(out->CP,n,j,k);
+			}
+			RM(out->PC,n,i,j) = sum;
+		}
+	}
+	// back substitution through trans(L), row i of trans(K) is column i of K
+	for (i = n - 1; i >= 0; i--)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = RM(out->PC,n,i,j);
+			for (k = i + 1; k < n; k++)
+			{
+				sum -= RM(out->CPC_R,n,k,i) * RM(out->K,n,j,k);
+			}
+			RM(out->K,n,j,i) = sum / RM(out->CPC_R,n,i,i);
+		}
+	}
+
+	// compute estimate recursion / predictive estimate
+
+	KFilterKernelAPriori( out, n, out->AK, out->Ax );
+
+	// compute covariance recursion
+
+	// A S
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k <= j; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->CP,n,k,j);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	// G Lq
+	KFilterSqrtInfoCholesky( out->Q, out->QG, n );
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = j; k < n; k++)
+			{
+				sum += RM(out->G,n,i,k) * RM(out->QG,n,k,j);
+			}
+			RM(out->GQG,n,i,j) = sum;
+		}
+	}
+	// RQ of | A S  G Lq |, row i is reflected onto column i over columns 0..i of AK and all of GQG
+	for (i = n - 1; i >= 0; i--)
+	{
+		sum = 0.0;
+		for (k = 0; k < i; k++)
+		{
+			sum += RM(out->AK,n,i,k) * RM(out->AK,n,i,k);
+		}
+		for (k = 0; k < n; k++)
+		{
+			sum += RM(out->GQG,n,i,k) * RM(out->GQG,n,i,k);
+		}
+		alpha = RM(out->AK,n,i,i);
+		if ( sum > 0.0 )
+		{
+			norm = sqrt( alpha*alpha + sum );
+			diagonal = ( alpha > 0.0 ) ? -norm : norm;
+			v = alpha - diagonal;
+			factor = 1.0 / ( v*v + sum );
+			for (j = 0; j < i; j++)
+			{
+				sum = v * RM(out->AK,n,j,i);
+				for (k = 0; k < i; k++)
+				{
+					sum += RM(out->AK,n,j,k) * RM(out->AK,n,i,k);
+				}
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->GQG,n,j,k) * RM(out->GQG,n,i,k);
+				}
+				sum *= 2.0 * factor;
+				RM(out->AK,n,j,i) -= sum * v;
+				for (k = 0; k < i; k++)
+				{
+					RM(out->AK,n,j,k) -= sum * RM(out->AK,n,i,k);
+				}
+				for (k = 0; k < n; k++)
+				{
+					RM(out->GQG,n,j,k) -= sum * RM(out->GQG,n,i,k);
+				}
+			}
+			RM(out->AK,n,i,i) = diagonal;
+			for (k = 0; k < i; k++)
+			{
+				RM(out->AK,n,i,k) = 0.0;
+			}
+			for (k = 0; k < n; k++)
+			{
+				RM(out->GQG,n,i,k) = 0.0;
+			}
+		}
+		// the sign flip of the column keeps the diagonal positive
+		if ( RM(out->AK,n,i,i) < 0.0 )
+		{
+			for (j = 0; j <= i; j++)
+			{
+				RM(out->AK,n,j,i) = -RM(out->AK,n,j,i);
+			}
+		}
+	}
+	// info_root = inv(S_)
+	if ( KFilterSqrtInfoInvert( out->AK, T, n ) != 0 )
+	{
+		return -1;
+	}
+	// P = S_ trans(S_), upper triangle of AK only
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j <= i; j++)
+		{
+			sum = 0.0;
+			for (k = i; k < n; k++)
+			{
+				sum += RM(out->AK,n,i,k) * RM(out->AK,n,j,k);
+			}
+			RM(out->P,n,i,j) = sum;
+			RM(out->P,n,j,i) = sum;
+		}
+	}
+
+	// compute state vector estimate
+
+	KFilterKernelAPosteriori( out, n );
+
+	return 0;
+}
+
+//! one copy per instruction set, stepped through the plain kernels below
+static CPU_DISPATCH int KFilterSqrtInfo( k_filter *out )
+{
+	return ComputeKFilterSqrtInfoStep( out, out->num_elements );
+}
+
+static CPU_DISPATCH int KFilterSqrtInfo4( k_filter *out )
+{
+	return ComputeKFilterSqrtInfoStep( out, KFILTER_FIXED_ODOM );
+}
+
+static CPU_DISPATCH int KFilterSqrtInfo7( k_filter *out )
+{
+	return ComputeKFilterSqrtInfoStep( out, KFILTER_FIXED_GPS );
+}
+
+static CPU_DISPATCH int KFilterSqrtInfo16( k_filter *out )
+{
+	return ComputeKFilterSqrtInfoStep( out, KFILTER_FIXED_IMU );
+}
+
+//! any size
+int ComputeKFilterSqrtInfo( void *in )
+{
+	return KFilterSqrtInfo( (k_filter *)in );
+}
+
+//! odometer sized kernel
+int ComputeKFilterSqrtInfo4( void *in )
+{
+	return KFilterSqrtInfo4( (k_filter *)in );
+}
+
+//! gps sized kernel
+int ComputeKFilterSqrtInfo7( void *in )
+{
+	return KFilterSqrtInfo7( (k_filter *)in );
+}
+
+//! imu sized kernel
+int ComputeKFilterSqrtInfo16( void *in )
+{
+	return KFilterSqrtInfo16( (k_filter *)in );
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! factors P into info_root and aims ComputeKernel at the square root information kernel
+int SelectKFilterSqrtInfoKernel( k_filter *out )
+{
+	int n = out->num_elements;
+	double *S = out->CP;
+	double sum;
+	int i, j, k;
+
+	// P = S trans(S) with S upper triangular, a Cholesky factorization from the last row up
+	for (j = n - 1; j >= 0; j--)
+	{
+		sum = SYM(out->P,n,j,j);
+		for (k = j + 1; k < n; k++)
+		{
+			sum -= RM(S,n,j,k) * RM(S,n,j,k);
+		}
+		if ( sum <= 0.0 )
+		{
+			// not positive definite, no factor to carry
+			SelectKFilterSymmetricKernel ( out );
+			return -1;
+		}
+		RM(S,n,j,j) = sqrt( sum );
+		for (i = j - 1; i >= 0; i--)
+		{
+			sum = SYM(out->P,n,i,j);
+			for (k = j + 1; k < n; k++)
+			{
+				sum -= RM(S,n,i,k) * RM(S,n,j,k);
+			}
+			RM(S,n,i,j) = sum / RM(S,n,j,j);
+		}
+	}
+	KFilterSqrtInfoInvert( S, out->info_root, n );
+
+	switch ( n )
+	{
+		case KFILTER_FIXED_ODOM:
+		{
+			out->ComputeKernel = ComputeKFilterSqrtInfo4;
+			break;
+		}
+		case KFILTER_FIXED_GPS:
+		{
+			out->ComputeKernel = ComputeKFilterSqrtInfo7;
+			break;
+		}
+		case KFILTER_FIXED_IMU:
+		{
+			out->ComputeKernel = ComputeKFilterSqrtInfo16;
+			break;
+		}
+		default:
+		{
+			out->ComputeKernel = ComputeKFilterSqrtInfo;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
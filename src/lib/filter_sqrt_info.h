@@ -0,0 +1,72 @@
+//! filter_sqrt_info.h
+//! square root information Kalman filter Header File
+//! kernels that carry a triangular factor of inv(P) instead of P
+/*! $Id$ */
+
+/*
+
+	Over a long run the P - K C P of the general path subtracts two nearly
+	equal matrices every step and rounding eventually leaves P indefinite.
+	The square root information kernels never form that difference.  They
+	carry the upper triangular info_root with
+
+		inv(P)	= trans(info_root) info_root
+
+	and update it with orthogonal transformations only, so the P it stands
+	for is symmetric positive definite by construction.
+
+	With R = L trans(L) the measurement update triangularizes
+
+		| info_root      |              | info_root_ |
+		| inv(L) C       |  by QR into  |     0      |
+
+	which is the information form of P - K C P.  The time update needs no
+	inverse of A: with S = inv(info_root_) and Q = Lq trans(Lq)
+
+		| A S   G Lq |  is factored by RQ into  | S_  0 |
+
+	so that A ( P - K C P ) trans(A) + G Q trans(G) = S_ trans(S_), and the
+	new info_root is inv(S_).  Both are triangular inverses.
+
+	K, the estimates and P = S_ trans(S_) are produced as by ComputeKFilter
+	so the rest of the library reads the filter as before.  A step costs
+	about 15 n^3 flops against about 22 n^3 for the general path.
+
+	The kernel is selected by SetKFilterCovarianceMode with
+	KFILTER_COVARIANCE_SQRT_INFO, which factors the current P, as does any
+	change of the filter while in that mode.  A P that is not positive
+	definite cannot be factored and the filter steps with the symmetric
+	kernel instead.  As with the other covariance modes the sequential
+	update, where selected, takes precedence.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_SQRT_INFO_H
+#define FILTER_SQRT_INFO_H
+
+
+//! Functions
+
+//! Select Fcns
+//! factors P into info_root and aims ComputeKernel at the square root information kernel
+//! returns -1 when P is not positive definite and the symmetric kernel was selected
+int SelectKFilterSqrtInfoKernel( k_filter *out );
+
+//! Compute Fcns - each does one complete filter step
+int ComputeKFilterSqrtInfo( void *in );		//! any size
+int ComputeKFilterSqrtInfo4( void *in );	//! odometer
+int ComputeKFilterSqrtInfo7( void *in );	//! gps
+int ComputeKFilterSqrtInfo16( void *in );	//! imu
+
+#endif  //! define FILTER_SQRT_INFO_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
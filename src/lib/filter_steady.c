@@ -0,0 +1,245 @@
+//! filter_steady.c
+//!
+//! steady state Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the steady state gain detection for the Kalman filter.
+
+	While frozen the filter's computation members hold
+
+		AK		A K of the frozen gain
+		Ax		y - x_hat_
+
+	and S_steady the innovation variances of the frozen gain.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_steady.h"
+#include "filter_block.h"		// ComputeKFilterBlocked
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Zero Fcns
+//!-------------------------------------------------------
+//! drops any frozen gain and restarts convergence detection from the current P
+int ResetKFilterSteadyState( k_filter *out )
+{
+	int i;
+
+	out->steady_state = 0;
+	out->steady_count = 0;
+
+	for (i = 0; i < out->num_elements*out->num_elements; i++)
+	{
+		out->P_previous[i] = out->P[i];
+	}
+	for (i = 0; i < out->num_elements; i++)
+	{
+		out->steady_counts[i] = 0;
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Update Fcns
+//!-------------------------------------------------------
+//! returns the steady_norm of M, or of M - N when N is not NULL
+static double NormKFilterMatrix( k_filter *in, double *M, double *N )
+{
+	int n = in->num_elements;
+	int i, j;
+	double entry, sum, norm;
+
+	norm = 0.0;
+	for (j = 0; j < n; j++)
+	{
+		sum = 0.0;
+		for (i = 0; i < n; i++)
+		{
+			entry = ( N == NULL ) ? M[i + n*j] : M[i + n*j] - N[i + n*j];
+			switch ( in->steady_norm )
+			{
+				case KFILTER_NORM_ONE:
+				{
+					sum += fabs( entry );
+					break;
+				}
+				case KFILTER_NORM_FROBENIUS:
+				{
+					sum += entry*entry;
+					break;
+				}
+				default:
+				{
+					if ( fabs( entry ) > norm )
+					{
+						norm = fabs( entry );
+					}
+					break;
+				}
+			}
+		}
+		if ( in->steady_norm == KFILTER_NORM_ONE && sum > norm )
+		{
+			// largest column sum
+			norm = sum;
+		}
+		else if ( in->steady_norm == KFILTER_NORM_FROBENIUS )
+		{
+			norm += sum;
+		}
+	}
+
+	if ( in->steady_norm == KFILTER_NORM_FROBENIUS )
+	{
+		norm = sqrt( norm );
+	}
+
+	return norm;
+}
+
+//! caches what the frozen gain needs and aims ComputeKernel at it
+static void FreezeKFilterGain( k_filter *out )
+{
+	int n = out->num_elements;
+	int i, j, k;
+	double sum, s;
+
+	// AK
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * RM(out->K,n,k,j);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	// diag( R + C P trans(C) ), C read as ComputeKFilterSteady gates C x_hat_
+	for (i = 0; i < n; i++)
+	{
+		s = RM(out->R,n,i,i);
+		for (k = 0; k < n; k++)
+		{
+			sum = 0.0;
+			for (j = 0; j < n; j++)
+			{
+				sum += RM(out->P,n,k,j) * RM(out->C,n,j,i);
+			}
+			s += RM(out->C,n,k,i) * sum;
+		}
+		out->S_steady[i] = s;
+	}
+
+	out->steady_state = 1;
+	out->ComputeKernel = ComputeKFilterSteady;
+}
+
+//! measures the change in P after a complete step and freezes K once converged
+int UpdateKFilterSteadyState( k_filter *out )
+{
+	int i;
+	double change;
+
+	if ( out->steady_state || out->steady_tolerance <= 0.0 || out->ComputeKernel == ComputeKFilterBlocked )
+	{
+		// frozen, disabled or left to the sub-filters
+		return 0;
+	}
+
+	change = NormKFilterMatrix( out, out->P, out->P_previous );
+	if ( change <= out->steady_tolerance * NormKFilterMatrix( out, out->P, NULL ) )
+	{
+		out->steady_count++;
+	}
+	else
+	{
+		out->steady_count = 0;
+	}
+
+	for (i = 0; i < out->num_elements*out->num_elements; i++)
+	{
+		out->P_previous[i] = out->P[i];
+	}
+
+	if ( out->steady_count >= out->steady_steps )
+	{
+		FreezeKFilterGain( out );
+	}
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+//! one filter step with the frozen gain, one copy per instruction set
+static CPU_DISPATCH int KFilterSteady( k_filter *out )
+{
+	int n = out->num_elements;
+	int i, k;
+	int diverged = 0;
+	double innovation;
+
+	// compute estimate recursion / predictive estimate
+	for (i = 0; i < n; i++)
+	{
+		out->x_hat_[i] = out->x_hat[i];
+		out->Ax[i] = out->y[i] - out->x_hat_[i];
+	}
+	KFilterKernelAPrioriProduct( out, n, out->AK, out->Ax );
+
+	// a measurement far outside the frozen gain's variance means divergence,
+	// judged on the innovation y - C x_hat_ that S_steady is the variance of,
+	// C x_hat_ formed as KFilterKernelAPosteriori forms C x_hat
+	for (i = 0; i < n && out->steady_gate > 0.0 && !diverged; i++)
+	{
+		if ( out->update_mode == KFILTER_UPDATE_SEQUENTIAL && !out->measured[i] )
+		{
+			continue;
+		}
+		innovation = out->y[i];
+		for (k = 0; k < n; k++)
+		{
+			innovation -= RM(out->C,n,k,i) * out->x_hat_[k];
+		}
+		diverged = ( innovation*innovation > out->steady_gate*out->steady_gate*out->S_steady[i] );
+	}
+
+	// compute state vector estimate
+	KFilterKernelAPosteriori( out, n );
+
+	if ( diverged )
+	{
+		// back to the full step from the next step on
+		SelectKFilterKernel ( out );
+	}
+
+	return 0;
+}
+
+//! one filter step with the frozen gain
+int ComputeKFilterSteady( void *in )
+{
+	return KFilterSteady( (k_filter *)in );
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,60 @@
+//! filter_steady.h
+//! steady state Kalman filter Header File
+//! detects a converged gain and steps with it frozen
+/*! $Id$ */
+
+/*
+
+	With constant A, C, G, Q and R the covariance P and the gain K converge
+	within a few hundred steps, after which every step recomputes the same K
+	and P in O(n^3).
+
+	UpdateKFilterSteadyState runs after each complete step and measures the
+	change in P with the norm chosen by steady_norm.  Once that change stays
+	within steady_tolerance of the norm of P for steady_steps consecutive
+	steps, K is frozen: AK = A K and the innovation variances
+	diag( R + C P trans(C) ) are cached and ComputeKernel is aimed at
+	ComputeKFilterSteady, which only runs the a priori and a posteriori
+	estimate equations in O(n^2).  P keeps its converged value.
+
+	The frozen gain is dropped, and the normal kernel reselected, when
+
+		- any SetKFilter*Matrix fcn or a mode change reselects the kernel
+		- the measured mask changes
+		- an element of the innovation y - C x_hat_, taken before the
+		  a posteriori correction, exceeds steady_gate standard deviations
+
+	A steady_tolerance of 0 disables detection and a steady_gate of 0 the
+	divergence check.  A blocked filter leaves detection to its sub-filters.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_STEADY_H
+#define FILTER_STEADY_H
+
+
+//! Functions
+
+//! Zero Fcns
+//! drops any frozen gain and restarts convergence detection from the current P
+int ResetKFilterSteadyState( k_filter *out );
+
+//! Update Fcns
+//! measures the change in P after a complete step and freezes K once converged
+int UpdateKFilterSteadyState( k_filter *out );
+
+//! Compute Fcns - one filter step with the frozen gain
+int ComputeKFilterSteady( void *in );
+
+#endif  //! define FILTER_STEADY_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
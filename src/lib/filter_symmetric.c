@@ -0,0 +1,311 @@
+//! filter_symmetric.c
+//!
+//! symmetric covariance Kalman filter Functions
+/* $Id$ */
+
+
+/*
+
+	This c file holds the symmetric covariance kernels for the Kalman filter.
+	P, Q, R and S = R + C P trans(C) are symmetric so only their lower
+	triangles are read or computed, within the dense n x n arrays.  K is found by a Cholesky solve against S
+	rather than by forming inv(S).
+
+	As with the fixed kernels a single step body is instantiated for each of
+	the scripted sensor sizes with n a constant, plus once with a run time n
+	for any other size.  The filter's own computation matrices are used as
+	scratch storage:
+
+		PC		P trans(C)
+		CPC_R	S, then its Cholesky factor L
+		CP		P after the measurement update
+		AK		AK, then ( I - KC ) P, then A P
+		CPC		I - KC
+		QG		K R, then G Q
+		Ax		y - x_hat_
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "filter_symmetric.h"
+#include "filter_fixed.h"		// scripted sensor sizes
+#include "filter_kernel.h"	// shared inline bodies
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+
+/*
+	ComputeKFilterSymmetricStep is the body of every symmetric kernel.  It
+	computes one complete filter step in the same order as ComputeKFilter.
+*/
+KFILTER_INLINE int ComputeKFilterSymmetricStep( k_filter *out, const int n )
+{
+	double sum;
+	int i, j, k;
+
+	// compute K gain
+
+	// P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += SYM(out->P,n,i,k) * RM(out->C,n,j,k);
+			}
+			RM(out->PC,n,i,j) = sum;
+		}
+	}
+	// lower triangle of S = R + C P trans(C)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j <= i; j++)
+		{
+			sum = RM(out->R,n,i,j);
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->C,n,i,k) * RM(out->PC,n,k,j);
+			}
+			RM(out->CPC_R,n,i,j) = sum;
+		}
+	}
+	// S = L trans(L)
+	if ( KFilterKernelCholesky( out->CPC_R, n ) != 0 )
+	{
+		return -1;
+	}
+	// each row of K solves S trans(k) = trans(P trans(C)) for that row
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			RM(out->K,n,i,j) = RM(out->PC,n,i,j);
+		}
+		KFilterKernelCholeskySolve( out->CPC_R, n, &RM(out->K,n,i,0) );
+	}
+
+	// compute estimate recursion / predictive estimate
+
+	KFilterKernelAPriori( out, n, out->AK, out->Ax );
+
+	// compute covariance recursion
+
+	if ( out->covariance_mode == KFILTER_COVARIANCE_JOSEPH )
+	{
+		// I - KC
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < n; j++)
+			{
+				sum = ( i == j ) ? 1.0 : 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum -= RM(out->K,n,i,k) * RM(out->C,n,k,j);
+				}
+				RM(out->CPC,n,i,j) = sum;
+			}
+		}
+		// ( I - KC ) P
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < n; j++)
+			{
+				sum = 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->CPC,n,i,k) * SYM(out->P,n,k,j);
+				}
+				RM(out->AK,n,i,j) = sum;
+			}
+		}
+		// K R
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j < n; j++)
+			{
+				sum = 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->K,n,i,k) * SYM(out->R,n,k,j);
+				}
+				RM(out->QG,n,i,j) = sum;
+			}
+		}
+		// lower triangle of ( I - KC ) P trans( I - KC ) + K R trans(K)
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= i; j++)
+			{
+				sum = 0.0;
+				for (k = 0; k < n; k++)
+				{
+					sum += RM(out->AK,n,i,k) * RM(out->CPC,n,j,k);
+					sum += RM(out->QG,n,i,k) * RM(out->K,n,j,k);
+				}
+				RM(out->CP,n,i,j) = sum;
+			}
+		}
+	}
+	else
+	{
+		// lower triangle of P - K C P where C P = trans( P trans(C) )
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= i; j++)
+			{
+				sum = RM(out->P,n,i,j);
+				for (k = 0; k < n; k++)
+				{
+					sum -= RM(out->K,n,i,k) * RM(out->PC,n,j,k);
+				}
+				RM(out->CP,n,i,j) = sum;
+			}
+		}
+	}
+	// A P
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->A,n,i,k) * SYM(out->CP,n,k,j);
+			}
+			RM(out->AK,n,i,j) = sum;
+		}
+	}
+	// G Q
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->G,n,i,k) * SYM(out->Q,n,k,j);
+			}
+			RM(out->QG,n,i,j) = sum;
+		}
+	}
+	// lower triangle of P = A P trans(A) + G Q trans(G)
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j <= i; j++)
+		{
+			sum = 0.0;
+			for (k = 0; k < n; k++)
+			{
+				sum += RM(out->AK,n,i,k) * RM(out->A,n,j,k);
+				sum += RM(out->QG,n,i,k) * RM(out->G,n,j,k);
+			}
+			RM(out->P,n,i,j) = sum;
+		}
+	}
+	// mirror into the upper triangle so P reads as dense elsewhere
+	for (i = 0; i < n; i++)
+	{
+		for (j = i + 1; j < n; j++)
+		{
+			RM(out->P,n,i,j) = RM(out->P,n,j,i);
+		}
+	}
+
+	// compute state vector estimate
+
+	KFilterKernelAPosteriori( out, n );
+
+	return 0;
+}
+
+//! one copy per instruction set, stepped through the plain kernels below
+static CPU_DISPATCH int KFilterSymmetric( k_filter *out )
+{
+	return ComputeKFilterSymmetricStep( out, out->num_elements );
+}
+
+static CPU_DISPATCH int KFilterSymmetric4( k_filter *out )
+{
+	return ComputeKFilterSymmetricStep( out, KFILTER_FIXED_ODOM );
+}
+
+static CPU_DISPATCH int KFilterSymmetric7( k_filter *out )
+{
+	return ComputeKFilterSymmetricStep( out, KFILTER_FIXED_GPS );
+}
+
+static CPU_DISPATCH int KFilterSymmetric16( k_filter *out )
+{
+	return ComputeKFilterSymmetricStep( out, KFILTER_FIXED_IMU );
+}
+
+//! any size
+int ComputeKFilterSymmetric( void *in )
+{
+	return KFilterSymmetric( (k_filter *)in );
+}
+
+//! odometer sized kernel
+int ComputeKFilterSymmetric4( void *in )
+{
+	return KFilterSymmetric4( (k_filter *)in );
+}
+
+//! gps sized kernel
+int ComputeKFilterSymmetric7( void *in )
+{
+	return KFilterSymmetric7( (k_filter *)in );
+}
+
+//! imu sized kernel
+int ComputeKFilterSymmetric16( void *in )
+{
+	return KFilterSymmetric16( (k_filter *)in );
+}
+
+
+//!-------------------------------------------------------
+//! Select Fcns
+//!-------------------------------------------------------
+//! aims ComputeKernel at the symmetric kernel for the filter size
+int SelectKFilterSymmetricKernel( k_filter *out )
+{
+	switch ( out->num_elements )
+	{
+		case KFILTER_FIXED_ODOM:
+		{
+			out->ComputeKernel = ComputeKFilterSymmetric4;
+			break;
+		}
+		case KFILTER_FIXED_GPS:
+		{
+			out->ComputeKernel = ComputeKFilterSymmetric7;
+			break;
+		}
+		case KFILTER_FIXED_IMU:
+		{
+			out->ComputeKernel = ComputeKFilterSymmetric16;
+			break;
+		}
+		default:
+		{
+			out->ComputeKernel = ComputeKFilterSymmetric;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
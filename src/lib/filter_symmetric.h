@@ -0,0 +1,55 @@
+//! filter_symmetric.h
+//! symmetric covariance Kalman filter Header File
+//! kernels that keep P symmetric and solve for K by Cholesky factorization
+/*! $Id$ */
+
+/*
+
+	The general path builds inv( R + C P trans(C) ) with clapack_dgesv against
+	an identity matrix and then multiplies it out, and stores P as a dense
+	general matrix.  Rounding lets P drift away from symmetry over long runs.
+
+	The symmetric kernels only compute the lower triangle of P and of the
+	innovation covariance S = R + C P trans(C), factor S = L trans(L) in place
+	(dpotrf style) and solve S trans(K) = C P by substitution (dpotrs style)
+	so the inverse is never formed.  The saving is in arithmetic, not in
+	storage: P, S and the scratch matrices stay dense n x n arrays, and P is
+	mirrored into the upper triangle at the end of every step so the rest of
+	the library may read it as dense.
+
+	The Joseph form of the covariance update
+		( I - KC ) P trans( I - KC ) + K R trans(K)
+	costs more but stays positive definite in the presence of rounding in K.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FILTER_SYMMETRIC_H
+#define FILTER_SYMMETRIC_H
+
+
+//! Functions
+
+//! Select Fcns
+//! aims ComputeKernel at the symmetric kernel for the filter size
+int SelectKFilterSymmetricKernel( k_filter *out );
+
+//! Compute Fcns - one complete filter step: K, a priori, P, a posteriori
+//! generic size
+int ComputeKFilterSymmetric( void *in );
+//! sized to the scripted sensors
+int ComputeKFilterSymmetric4( void *in );
+int ComputeKFilterSymmetric7( void *in );
+int ComputeKFilterSymmetric16( void *in );
+
+#endif  //! define FILTER_SYMMETRIC_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
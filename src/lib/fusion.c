@@ -0,0 +1,275 @@
+//! fusion.c
+//!
+//! information form fusion Functions
+/* $Id$ */
+
+
+/*
+
+	This c file accumulates trans(H) inv(P_s) H and trans(H) inv(P_s) z of
+	each sensor and solves the sum.  Every matrix here is at most
+	FUSION_MAX_ELEMENTS square and lives on the stack or in the fusion_info,
+	so a step allocates nothing.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <math.h>			// sqrt
+
+#include "fusion.h"
+
+
+//! row major entry of an n x n matrix
+#define FUSION_ENTRY(M,n,i,j)		((M)[(i)*(n) + (j)])
+
+
+//!-------------------------------------------------------
+//! Factor Fcns - small dense Cholesky for the fused blocks
+//!-------------------------------------------------------
+//! factors the lower triangle of the symmetric n x n S into L trans(L) in place
+//! returns -1 if S is not positive definite
+static int FusionCholesky( double *S, int n )
+{
+	double sum;
+	int i, j, k;
+
+	for (j = 0; j < n; j++)
+	{
+		//! diagonal entry
+		sum = FUSION_ENTRY(S,n,j,j);
+		for (k = 0; k < j; k++)
+		{
+			sum -= FUSION_ENTRY(S,n,j,k) * FUSION_ENTRY(S,n,j,k);
+		}
+		if ( sum <= 0.0 )
+		{
+			//! not positive definite
+			return -1;
+		}
+		FUSION_ENTRY(S,n,j,j) = sqrt( sum );
+		//! column below the diagonal
+		for (i = j + 1; i < n; i++)
+		{
+			sum = FUSION_ENTRY(S,n,i,j);
+			for (k = 0; k < j; k++)
+			{
+				sum -= FUSION_ENTRY(S,n,i,k) * FUSION_ENTRY(S,n,j,k);
+			}
+			FUSION_ENTRY(S,n,i,j) = sum / FUSION_ENTRY(S,n,j,j);
+		}
+	}
+
+	return 0;
+}
+
+//! solves L trans(L) z = b in place in b for the factor left by FusionCholesky
+static void FusionCholeskySolve( const double *S, int n, double *b )
+{
+	double sum;
+	int i, k;
+
+	//! forward substitution L w = b
+	for (i = 0; i < n; i++)
+	{
+		sum = b[i];
+		for (k = 0; k < i; k++)
+		{
+			sum -= FUSION_ENTRY(S,n,i,k) * b[k];
+		}
+		b[i] = sum / FUSION_ENTRY(S,n,i,i);
+	}
+	//! back substitution trans(L) z = w
+	for (i = n - 1; i >= 0; i--)
+	{
+		sum = b[i];
+		for (k = i + 1; k < n; k++)
+		{
+			sum -= FUSION_ENTRY(S,n,k,i) * b[k];
+		}
+		b[i] = sum / FUSION_ENTRY(S,n,i,i);
+	}
+}
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+int InitFusionInformation ( fusion_info *out, int num_elements )
+{
+	//! sets the number of fused elements and zeros the information
+
+	if ( num_elements < 1 || num_elements > FUSION_MAX_ELEMENTS )
+	{
+		//! does not fit the fixed arrays
+		return -1;
+	}
+	out->num_elements = num_elements;
+
+	return ZeroFusionInformation ( out );
+}
+
+
+//!-------------------------------------------------------
+//! Zero Fcns
+//!-------------------------------------------------------
+int ZeroFusionInformation ( fusion_info *out )
+{
+	//! drops the information of every sensor
+	int i;
+
+	for (i = 0; i < out->num_elements*out->num_elements; i++)
+	{
+		out->Y[i] = 0.0;
+	}
+	for (i = 0; i < out->num_elements; i++)
+	{
+		out->y[i] = 0.0;
+	}
+	out->sensors = 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Update Fcns
+//!-------------------------------------------------------
+int AddFusionInformation ( fusion_info *out, k_filter *filter, const int *map, const double *z )
+{
+	//! adds trans(H) inv(P_s) H to Y and trans(H) inv(P_s) z to y
+	//! where P_s is the block of the filter P over the mapped transducers
+	int element[FUSION_MAX_ELEMENTS];
+	double L[FUSION_MAX_ELEMENTS*FUSION_MAX_ELEMENTS];
+	double column[FUSION_MAX_ELEMENTS];
+	double w[FUSION_MAX_ELEMENTS];
+	int n = filter->num_elements;
+	int N = out->num_elements;
+	int m = 0;
+	int a, b;
+
+	//! gather the elements this sensor supplies
+	for (a = 0; a < N; a++)
+	{
+		if ( map[a] == FUSION_NO_TRANSDUCER )
+		{
+			continue;
+		}
+		if ( map[a] < 0 || map[a] >= n )
+		{
+			//! no such transducer in the filter
+			return -1;
+		}
+		element[m++] = a;
+	}
+	if ( m == 0 )
+	{
+		//! nothing to add
+		return 0;
+	}
+
+	//! P_s from the filter, stored X[i + n*j] and symmetric
+	for (a = 0; a < m; a++)
+	{
+		for (b = 0; b < m; b++)
+		{
+			FUSION_ENTRY(L,m,a,b) = filter->P[ map[element[a]] + n*map[element[b]] ];
+		}
+	}
+	if ( FusionCholesky ( L, m ) != 0 )
+	{
+		//! a sensor without a usable covariance adds nothing
+		return -1;
+	}
+
+	//! w = inv(P_s) z
+	for (a = 0; a < m; a++)
+	{
+		w[a] = z[element[a]];
+	}
+	FusionCholeskySolve ( L, m, w );
+	for (a = 0; a < m; a++)
+	{
+		out->y[element[a]] += w[a];
+	}
+
+	//! inv(P_s) a column at a time scattered into Y
+	for (b = 0; b < m; b++)
+	{
+		for (a = 0; a < m; a++)
+		{
+			column[a] = ( a == b ) ? 1.0 : 0.0;
+		}
+		FusionCholeskySolve ( L, m, column );
+		for (a = 0; a < m; a++)
+		{
+			FUSION_ENTRY(out->Y,N,element[a],element[b]) += column[a];
+		}
+	}
+	out->sensors++;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+int SolveFusionInformation ( fusion_info *in, double *x )
+{
+	//! solves Y x = y over the elements some sensor supplied
+	int element[FUSION_MAX_ELEMENTS];
+	double L[FUSION_MAX_ELEMENTS*FUSION_MAX_ELEMENTS];
+	double w[FUSION_MAX_ELEMENTS];
+	int N = in->num_elements;
+	int m = 0;
+	int a, b;
+
+	if ( in->sensors == 0 )
+	{
+		//! no sensor this step, x keeps its value
+		return 0;
+	}
+
+	//! an element no sensor supplied has no information
+	for (a = 0; a < N; a++)
+	{
+		if ( FUSION_ENTRY(in->Y,N,a,a) > 0.0 )
+		{
+			element[m++] = a;
+		}
+	}
+	if ( m == 0 )
+	{
+		return 0;
+	}
+
+	for (a = 0; a < m; a++)
+	{
+		for (b = 0; b < m; b++)
+		{
+			FUSION_ENTRY(L,m,a,b) = FUSION_ENTRY(in->Y,N,element[a],element[b]);
+		}
+		w[a] = in->y[element[a]];
+	}
+	if ( FusionCholesky ( L, m ) != 0 )
+	{
+		//! x keeps its value
+		return -1;
+	}
+	FusionCholeskySolve ( L, m, w );
+	for (a = 0; a < m; a++)
+	{
+		x[element[a]] = w[a];
+	}
+
+	return m;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
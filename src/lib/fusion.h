@@ -0,0 +1,90 @@
+//! fusion.h
+//! information form fusion Header File
+//! combines the estimates of several sensors weighted by their filter covariances
+/*! $Id$ */
+
+/*
+
+	Each sensor places some of its filtered transducers into elements of the
+	state vector or the velocity matrix.  With z the elements a sensor
+	supplies, H the selection of those elements and P_s the covariance of
+	the transducers behind them, taken from the sensor filter P, the fused
+	estimate x solves
+
+		Y x = y		with	Y = sum trans(H) inv(P_s) H
+							y = sum trans(H) inv(P_s) z
+
+	The sums are additive, so a sensor is folded in by AddFusionInformation
+	in any order and a sensor without new data is simply not added.  A
+	sensor supplying m elements costs one m x m Cholesky factorization and
+	O(m^2) accumulation; m is at most FUSION_MAX_ELEMENTS.
+
+	SolveFusionInformation solves only for the elements some sensor
+	supplied this step.  The others keep the value passed in, which is the
+	previous fused value.
+
+*/
+
+//! Includes
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FUSION_H
+#define FUSION_H
+
+
+//! Defines
+
+//! most elements fused in one struct, a state_vector
+#define FUSION_MAX_ELEMENTS		7
+//! map entry of an element the sensor does not supply
+#define FUSION_NO_TRANSDUCER	-1
+
+
+//! Data structs
+
+//! data struct information accumulated over the sensors of one step
+typedef struct
+{
+	//! number of fused elements
+	int num_elements;
+	//! number of sensors added since the last ZeroFusionInformation
+	int sensors;
+	//! information matrix Y, row major num_elements x num_elements
+	double Y[FUSION_MAX_ELEMENTS*FUSION_MAX_ELEMENTS];
+	//! information vector y
+	double y[FUSION_MAX_ELEMENTS];
+
+} fusion_info;
+
+
+//! Functions
+
+//! Init Fcns
+//! sets the number of fused elements and zeros the information
+int InitFusionInformation ( fusion_info *out, int num_elements );
+
+//! Zero Fcns
+//! drops the information of every sensor, done at the start of each step
+int ZeroFusionInformation ( fusion_info *out );
+
+//! Update Fcns
+//! adds the information of one sensor
+//! map holds num_elements transducer numbers of filter, FUSION_NO_TRANSDUCER where
+//! the sensor supplies nothing, and z the elements the sensor supplies
+//! returns -1 and adds nothing if the covariance of the mapped transducers is not positive definite
+int AddFusionInformation ( fusion_info *out, k_filter *filter, const int *map, const double *z );
+
+//! Compute Fcns
+//! overwrites the elements of x supplied by some sensor with the fused estimate
+//! returns the number of elements solved for, -1 if Y is not positive definite
+int SolveFusionInformation ( fusion_info *in, double *x );
+
+#endif  //! define FUSION_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
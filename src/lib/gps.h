@@ -1,6 +1,7 @@
 // scripted sensor type gps
 /* $Id: gps.h,v 1.4 2005/06/10 15:10:59 dave Exp $ */
-sensor gps = 
+// read only template, each localize runs a copy made by CloneSensor
+const sensor gps_template = 
 {
 	// pt_sec
 	0,
@@ -50,5 +51,14 @@ sensor gps =
 	GPSGenerateVelMatrix,
 	// update from data
 	GPSUpdateSensor,
+	// CONFIGURATION
+	// filter update formulation
+	KFILTER_UPDATE_BATCH,
+	// filter covariance formulation
+	KFILTER_COVARIANCE_GENERAL,
+	// transducers behind the state vector
+	{ 3, 4, 2, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER },
+	// transducers behind the velocity matrix
+	{ FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER },
 
 };
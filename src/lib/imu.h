@@ -1,6 +1,7 @@
 // scripted sensor type imu
 /* $Id: imu.h,v 1.5 2005/06/10 15:10:59 dave Exp $ */
-sensor imu = 
+// read only template, each localize runs a copy made by CloneSensor
+const sensor imu_template = 
 {
 	// pt_sec
 	0,
@@ -60,5 +61,14 @@ sensor imu =
 	ImuGenerateVelMatrix,
 	// update from data
 	ImuUpdateSensor,
+	// CONFIGURATION
+	// filter update formulation
+	KFILTER_UPDATE_BATCH,
+	// filter covariance formulation
+	KFILTER_COVARIANCE_GENERAL,
+	// transducers behind the state vector
+	{ FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, 0, 1, 2, 3 },
+	// transducers behind the velocity matrix
+	{ 7, 8, 9, 10, 11, 12 },
 
 };
@@ -8,6 +8,7 @@
 #ifndef KIN_MODEL_H
 #include "kin_model.h"
 #endif
+#include "cpu_dispatch.h"		// instruction set clones of the hot kernels
 
 
 //-------------------------------------------------------
@@ -119,6 +120,8 @@ int km_ZeroJacobian ( Jacobian *out )
 	// clear U Matrix
 	km_ZeroUMatrix ( &(out->U) );
 	
+	// built from no orientation
+	out->built = 0;
 	
 	return 0;
 	
@@ -213,8 +216,29 @@ int km_UpdateJacobian ( PmQuaternion q, Jacobian *out  )
 	// create U matrix portion
 	km_UpdateUMatrix (  q, &(out->U) );
 	
+	// remember the orientation for km_RefreshJacobian
+	out->q 			= q;
+	out->built 	= 1;
+	
+	return 0;
+	
 }// end km_UpdateJacobian
 
+int km_RefreshJacobian ( PmQuaternion q, Jacobian *out  )
+{
+	// R and U depend on the orientation alone, so while it holds 
+	// still, as when stopped or not turning, the Jacobian stands
+	if ( out->built && out->q.s == q.s && out->q.x == q.x 
+		&& out->q.y == q.y && out->q.z == q.z )
+	{
+		return 0;
+	}
+	km_UpdateJacobian ( q, out );
+	
+	return 1;
+	
+}// end km_RefreshJacobian
+
 
 
 //-------------------------------------------------------
@@ -330,7 +354,7 @@ int km_ComputeStateVector( Jacobian J, vel_matrix v, state_vector *out)
 //-------------------------------------------------------
 // Kinematic Model Fcns
 //-------------------------------------------------------
-int km_ComputeKinematicModel ( Jacobian *J, vel_matrix v, double delta_t, state_vector *delta, state_vector *out  )
+CPU_DISPATCH int km_ComputeKinematicModel ( Jacobian *J, vel_matrix v, double delta_t, state_vector *delta, state_vector *out  )
 {
 	
 	// this fcn takes the input from the Jacobian and the velocity matrix
@@ -344,11 +368,8 @@ int km_ComputeKinematicModel ( Jacobian *J, vel_matrix v, double delta_t, state_
 	// update the current state vector
 	km_UpdateStateVector ( *(delta), delta_t, out );
 
-	// update R Matrix
-	km_UpdateRotMatrix ( (out->orient), &(J->R));
-
-	// update U Matrix
-	km_UpdateUMatrix ( (out->orient), &(J->U) );
+	// update R and U Matrix, when the orientation changed
+	km_RefreshJacobian ( (out->orient), J );
 
 	return 0;
 }// end km_ApplyKinematicModel
@@ -61,6 +61,9 @@ typedef struct
 	rot_matrix R;	// Rotation matrix applied to linear velocities
 	U_matrix   U;	// U matrix applied to angular velocities
 	
+	PmQuaternion q;	// orientation R and U were built from
+	int built;			// nonzero once built, so km_RefreshJacobian can compare q
+	
 } Jacobian;
 
 
@@ -87,6 +90,7 @@ int km_UpdateSkewMatrix ( PmQuaternion q, skew_matrix *out );				// fcn places q
 int	km_UpdateRotMatrix ( PmQuaternion q, rot_matrix *out );					// creates rotation matrix based on quaternions
 int	km_UpdateUMatrix ( PmQuaternion q, U_matrix *out );							// creates U matrix based on quaternions
 int km_UpdateJacobian ( PmQuaternion q, Jacobian *out  ); 					// constructs Jacobian from primitives
+int km_RefreshJacobian ( PmQuaternion q, Jacobian *out  ); 					// as km_UpdateJacobian unless already built from q, returns 1 if rebuilt
 
 
 // Compute fcns
@@ -14,13 +14,14 @@
 extern "C" {
 #endif
 
+#include <math.h>			// ceil
+#include <limits.h>		// INT_MAX
+
 // fcn header
 #include "localize.h"
 
-// data headers for various sensor types
-#include "gps.h"
-#include "imu.h"
-#include "odom.h"
+// the scripted sensor types are gps_template, imu_template and
+// odom_template of sensor_gps.c, sensor_imu.c and sensor_odom.c
 
 
 //-------------------------------------------------------
@@ -29,24 +30,82 @@ extern "C" {
 localize * CreateLocalize( void )
 {
 	
-	// assign dynamic memory
-	return( (localize *) malloc(sizeof(localize)));
+	// assign dynamic memory, aligned for the cache line members of the imu ring
+	void *out;
+	
+	if ( posix_memalign( &out, KFILTER_ALIGNMENT, sizeof(localize) ) != 0 )
+	{
+		return NULL;
+	}
+	return( (localize *)out );
 
 }// end CreateLocalize
 
 //-------------------------------------------------------
 // Destructors
 //-------------------------------------------------------
-
-
+int DestroyLocalize( localize *out )
+{
+	// releases the sensors and the arena of InitLocalize
+	// a localize from CreateLocalize is then released with free
+	int i;
+	
+	if ( out->arena == NULL )
+	{
+		// already destroyed
+		return -1;
+	}
+	
+	for (i = 0; i < out->sensors; i++)
+	{
+		DestroySensor ( out->slot[i].ptr );
+		free( out->slot[i].queue_arena );
+		out->slot[i].queue_arena = NULL;
+	}
+	out->sensors 			= 0;
+	out->queues 			= 0;
+	out->num_updated 	= 0;
+	
+	free( out->arena );
+	out->arena = NULL;
+	free( out->history_arena );
+	out->history_arena = NULL;
+	
+	return 0;
+}
 
 
 //-------------------------------------------------------
 // Init Fcns
 //-------------------------------------------------------
+// gives a sensor the slot of index, on the clock of the localize
+static void InitLocalizeSlot( localize *out, int index, sensor *in, int role )
+{
+	localize_slot *slot = &(out->slot[index]);
+	
+	slot->ptr 	= in;
+	slot->role 	= role;
+	slot->dirty = 0;
+	// no queue until SetLocalizeQueue
+	slot->queue_arena = NULL;
+	km_ZeroStateVector ( &(slot->state) );
+	km_ZeroVelocityMatrix ( &(slot->velocity) );
+	
+	in->clock 	= &(out->clock);
+}
+
 int InitLocalize( localize *out )
 {
 	// inits the sub-members of the Localize data struct
+	// with sensors of its own cloned from the scripted templates
+	return InitLocalizeSensors ( out, NULL, NULL, NULL );
+}
+
+int InitLocalizeSensors( localize *out, sensor *gps, sensor *imu, sensor *odom )
+{
+	// as InitLocalize with sensors of the caller, those NULL 
+	// cloned from the scripted templates into this localize
+	char *region;
 	
 	// aim pointers at the sub-elements
 	out->ptr_jacob 								= &(out->jacob);// Jacobian Matrix
@@ -54,20 +113,40 @@ int InitLocalize( localize *out )
 	out->ptr_fused_delta_state		= &(out->fused_delta_state);	// delta state vector
 	out->ptr_fused_vel_matrix 		= &(out->fused_vel_matrix);		// velocity matrix from relative sensors
 	
-	// init the state vectors
-	km_ZeroStateVector ( &(out->gps_state));					
-	km_ZeroStateVector ( &(out->imu_state));	
-	km_ZeroStateVector ( &(out->odom_state));	
-	
-	// init the velocity matrices
-  km_ZeroVelocityMatrix ( &(out->gps_velocity) );
-  km_ZeroVelocityMatrix ( &(out->imu_velocity) );
-  km_ZeroVelocityMatrix ( &(out->odom_velocity) );		
+	// no sensor information yet
+	InitFusionInformation ( &(out->state_info), STATE_ARRAY );
+	InitFusionInformation ( &(out->vel_info), VEL_ARRAY );
 										
-	// aim sensor pointer at external sensors
-	out->ptr_gps   								= &(gps);	
-	out->ptr_odom									= &(odom);
-	out->ptr_imu									= &(imu);
+	// each localize runs its own sensors, the templates are only 
+	// read, so any number of them can run side by side
+	if ( gps == NULL )
+	{
+		CloneSensor ( &gps_template, &(out->slot[GPS_SENSOR].own) );
+		gps = &(out->slot[GPS_SENSOR].own);
+	}
+	if ( odom == NULL )
+	{
+		CloneSensor ( &odom_template, &(out->slot[ODOM_SENSOR].own) );
+		odom = &(out->slot[ODOM_SENSOR].own);
+	}
+	if ( imu == NULL )
+	{
+		CloneSensor ( &imu_template, &(out->slot[IMU_SENSOR].own) );
+		imu = &(out->slot[IMU_SENSOR].own);
+	}
+	
+	// the first slots, more can follow with AddLocalizeSensor
+	InitLocalizeSlot ( out, GPS_SENSOR, gps, LOCALIZE_ROLE_POSITION );
+	InitLocalizeSlot ( out, IMU_SENSOR, imu, LOCALIZE_ROLE_INERTIAL );
+	InitLocalizeSlot ( out, ODOM_SENSOR, odom, LOCALIZE_ROLE_SPEED );
+	out->sensors 			= 3;
+	out->num_updated 	= 0;
+	out->queues 			= 0;
+	
+	// aim sensor pointer at the sensors
+	out->ptr_gps   								= gps;	
+	out->ptr_odom									= odom;
+	out->ptr_imu									= imu;
 	
 	
 	// initialize the internal data structs to zero state
@@ -84,17 +163,52 @@ int InitLocalize( localize *out )
 	// set the Jacobian to the current state vector pointing north
 	km_UpdateJacobian ( (out->ptr_fused_state->orient), out->ptr_jacob  );
 	
+	// kinematic model until SetLocalizeEngine selects another,
+	// every sensor stepped until SetLocalizeIncremental
+	out->engine 			= LOCALIZE_ENGINE_KINEMATIC;
+	out->incremental 	= 0;
+	InitESFilter ( &(out->es), 1 );
+	// no preintegration until SetLocalizeUpdatePeriod
+	InitImuPreintegrator ( &(out->imu_preint), 0.0 );
+	out->imu_delta.samples = 0;
+	
+	// the wall clock until SetLocalizeClock selects another
+	InitSensorClock ( &(out->clock), SENSOR_CLOCK_WALL );
+	
 	// initialize the sensors
 	
+	// one block for the dynamic memory of every sensor
+	if ( posix_memalign( &(out->arena), KFILTER_ALIGNMENT, 
+											 SizeSensorArena( out->ptr_gps->transducers ) 
+										 + SizeSensorArena( out->ptr_imu->transducers )
+										 + SizeSensorArena( out->ptr_odom->transducers ) ) != 0 )
+	{
+		out->arena = NULL;
+		return -1;
+	}
+	region = (char *)out->arena;
+	
 	// init the gps - assuming the struct was created and static elements are set
-	// still need to allocate the dynamic memory for arrays
-	InitSensor ( out->ptr_gps->transducers,  out->ptr_gps );
+	// still need to place the dynamic memory for arrays
+	InitSensorArena ( out->ptr_gps->transducers,  out->ptr_gps, region );
+	region += SizeSensorArena( out->ptr_gps->transducers );
 	
 	// init the imu
-	InitSensor ( out->ptr_imu->transducers,  out->ptr_imu );	
+	InitSensorArena ( out->ptr_imu->transducers,  out->ptr_imu, region );	
+	region += SizeSensorArena( out->ptr_imu->transducers );
 
 	// init the odometry
-	InitSensor ( out->ptr_odom->transducers,  out->ptr_odom );			
+	InitSensorArena ( out->ptr_odom->transducers,  out->ptr_odom, region );			
+	
+	// the error state filter history, a block of its own as
+	// SetLocalizeHistory sizes it again
+	out->history_arena = NULL;
+	if ( SetLocalizeHistory ( out, LOCALIZE_HISTORY_SPAN, LOCALIZE_HISTORY_PERIOD ) != 0 )
+	{
+		free( out->arena );
+		out->arena = NULL;
+		return -1;
+	}
 	
 	// init time stamps - two passes through update time
 	UpdateLocalizeTime2 ( out );	
@@ -104,9 +218,101 @@ int InitLocalize( localize *out )
 	return 0;
 }
 
+int AddLocalizeSensor( localize *out, sensor *in, int role )
+{
+	// inits a sensor of the caller, its scripted members set as by
+	// CloneSensor, in a block of its own as the arena of the
+	// localize is already carved, and gives it the next slot
+	int index = out->sensors;
+	
+	if ( in == NULL || index >= LOCALIZE_MAX_SENSORS 
+		|| role < LOCALIZE_ROLE_NONE || role > LOCALIZE_ROLE_SPEED )
+	{
+		return -1;
+	}
+	
+	// on the clock of the localize before its times are primed
+	InitLocalizeSlot ( out, index, in, role );
+	if ( InitSensor ( -1, in ) != 0 )
+	{
+		return -1;
+	}
+	out->sensors++;
+	
+	return index;
+}
+
+int AddLocalizeSensorTemplate( localize *out, const sensor *scripted, int role )
+{
+	// as AddLocalizeSensor with a clone of a scripted template kept
+	// in the slot, so a second GPS or IMU is one more call
+	localize_slot *slot;
+	
+	if ( scripted == NULL || out->sensors >= LOCALIZE_MAX_SENSORS )
+	{
+		return -1;
+	}
+	slot = &(out->slot[out->sensors]);
+	CloneSensor ( scripted, &(slot->own) );
+	
+	return AddLocalizeSensor ( out, &(slot->own), role );
+}
+
 //-------------------------------------------------------
 // Zero Fcns
 //-------------------------------------------------------
+int ResetLocalize( localize *out )
+{
+	// returns an initialized localize to its state after InitLocalize
+	// without touching the heap - for replaying one log after another
+	// the sensors added since keep their slots
+	int i;
+	
+	// init the state vectors and velocity matrices, no data yet
+	for (i = 0; i < out->sensors; i++)
+	{
+		km_ZeroStateVector ( &(out->slot[i].state) );
+		km_ZeroVelocityMatrix ( &(out->slot[i].velocity) );
+		out->slot[i].dirty = 0;
+		// the queues empty, their drivers stopped meanwhile
+		if ( out->slot[i].queue_arena != NULL )
+		{
+			ZeroSensorQueue ( &(out->slot[i].queue) );
+		}
+	}
+	out->num_updated = 0;
+	
+	// no sensor information yet
+	InitFusionInformation ( &(out->state_info), STATE_ARRAY );
+	InitFusionInformation ( &(out->vel_info), VEL_ARRAY );
+	
+	// zero the previous state vector	
+	km_ZeroStateVector ( &(out->previous_fused_state) );	
+	// fused state, delta state, velocity matrix and Jacobian
+	ZeroLocalize ( out );
+	// the engine stays selected, the error state filter starts over
+	InitESFilter ( &(out->es), 1 );
+	ZeroESHistory ( &(out->history) );
+	// as does the update period, with no samples queued
+	InitImuPreintegrator ( &(out->imu_preint), out->imu_preint.update_period );
+	out->imu_delta.samples = 0;
+	// a packet clock waits for the first packet of the next log
+	InitSensorClock ( &(out->clock), out->clock.source );
+	
+	// reset the sensors
+	for (i = 0; i < out->sensors; i++)
+	{
+		ResetSensor ( out->slot[i].ptr );
+	}
+	
+	// init time stamps - two passes through update time
+	UpdateLocalizeTime2 ( out );	
+	UpdateLocalizeTime2 ( out );		
+	
+	return 0;
+}
+
+
 int ZeroLocalize( localize *in)
 {
 	// zeros the elements within Localize
@@ -156,38 +362,331 @@ state_vector GetCurrentLocalize( localize *in )
 	
 }// end GetCurrentLocalize
 
+// GetLocalizeSensor returns the sensor of a slot, as given to
+// UpdateLocalizeData
+sensor * GetLocalizeSensor( localize *in, int index )
+{
+	if ( index < 0 || index >= in->sensors )
+	{
+		return NULL;
+	}
+	
+	return in->slot[index].ptr;
+}
+
+// SetLocalizeEngine switches between the kinematic model and 
+// the error state filter, which starts at the current fused state
+int SetLocalizeEngine( localize *out, int engine )
+{
+	switch (engine)
+	{
+		case LOCALIZE_ENGINE_KINEMATIC:
+		{
+			break;
+		}
+		case LOCALIZE_ENGINE_ERROR_STATE:
+		{
+			// biases estimated, uncertain start at the current pose
+			InitESFilter ( &(out->es), 1 );
+			SetESFilterStateVector ( &(out->es), out->ptr_fused_state );
+			ZeroESHistory ( &(out->history) );
+			break;
+		}
+		default:
+		{
+			// no such engine
+			return -1;
+		}
+	}
+	out->engine = engine;
+	
+	return 0;
+}
+
+// SetLocalizeUpdatePeriod decouples ComputeLocalize from the 
+// IMU rate, queued samples are kept
+int SetLocalizeUpdatePeriod( localize *out, double period )
+{
+	if ( period < 0.0 )
+	{
+		return -1;
+	}
+	out->imu_preint.update_period = period;
+	
+	return 0;
+}
+
+// SetLocalizeHistory sizes the ring of error state steps a late
+// measurement is placed in to span seconds, a step per IMU sample
+// of imu_period or per update when preintegrating over a longer
+// period, so set after SetLocalizeUpdatePeriod and before the first
+// data as the ring starts empty
+int SetLocalizeHistory( localize *out, double span, double imu_period )
+{
+	void *arena = NULL;
+	double period = imu_period;
+	double steps;
+	
+	if ( out->imu_preint.update_period > period )
+	{
+		period = out->imu_preint.update_period;
+	}
+	if ( span <= 0.0 || period <= 0.0 )
+	{
+		return -1;
+	}
+	steps = ceil( span/period );
+	if ( steps > (double)( INT_MAX/sizeof( es_history_step ) )
+		|| posix_memalign( &arena, KFILTER_ALIGNMENT, SizeESHistoryArena( (int)steps ) ) != 0 )
+	{
+		return -1;
+	}
+	
+	// the old ring goes, with the steps in it
+	free( out->history_arena );
+	out->history_arena 	= arena;
+	out->history_span 	= span;
+	out->history_period = imu_period;
+	
+	return InitESHistoryArena ( &(out->history), (int)steps, arena );
+}
+
+// SetLocalizeIncremental steps the filter, state vector and 
+// velocity matrix of a sensor only in the steps with its data.
+// Neither engine uses those of a sensor without new data, so this
+// saves their work - a 10 Hz GPS on a 200 Hz step is idle 19 steps
+// in 20 - but a filter then steps once per packet rather than once
+// per step and weighs its sensor by the covariance of its own rate.
+int SetLocalizeIncremental( localize *out, int incremental )
+{
+	out->incremental = ( incremental != 0 );
+	
+	return 0;
+}
+
+// SetLocalizeClock selects the clock of the localize and its 
+// sensors, before the first data as the times start over
+int SetLocalizeClock( localize *out, int source )
+{
+	int i;
+	
+	if ( InitSensorClock ( &(out->clock), source ) != 0 )
+	{
+		return -1;
+	}
+	
+	// times of the old clock mean nothing to the new one,
+	// two passes through update time as in InitLocalize
+	for (i = 0; i < out->sensors; i++)
+	{
+		UpdateSensorTime2 ( out->slot[i].ptr );
+		UpdateSensorTime2 ( out->slot[i].ptr );
+	}
+	UpdateLocalizeTime2 ( out );	
+	UpdateLocalizeTime2 ( out );		
+	
+	return 0;
+}
+
+// SetLocalizeQueue lets the driver of a sensor push its packets 
+// from its own thread, with neither a lock nor a wait on the step.
+// Set up, or taken down, before the driver starts
+int SetLocalizeQueue( localize *out, int sensor, unsigned long capacity, size_t packet_size )
+{
+	localize_slot *slot;
+	void *arena = NULL;
+	
+	if ( sensor < 0 || sensor >= out->sensors )
+	{
+		return -1;
+	}
+	slot = &(out->slot[sensor]);
+	
+	if ( capacity > 0 
+		&& ( SizeSensorQueueArena ( capacity, packet_size ) == 0
+			|| posix_memalign( &arena, KFILTER_ALIGNMENT, SizeSensorQueueArena ( capacity, packet_size ) ) != 0 ) )
+	{
+		return -1;
+	}
+	
+	// the old ring goes, with any packets left in it
+	if ( slot->queue_arena != NULL )
+	{
+		free( slot->queue_arena );
+		slot->queue_arena = NULL;
+		out->queues--;
+	}
+	if ( arena != NULL )
+	{
+		InitSensorQueueArena ( &(slot->queue), capacity, packet_size, arena );
+		slot->queue_arena = arena;
+		out->queues++;
+	}
+	
+	return 0;
+}
+
+int GetLocalizeQueueStats( localize *in, int sensor, sensor_queue_stats *out )
+{
+	if ( sensor < 0 || sensor >= in->sensors || in->slot[sensor].queue_arena == NULL )
+	{
+		return -1;
+	}
+	
+	return GetSensorQueueStats ( &(in->slot[sensor].queue), out );
+}
+
 //-------------------------------------------------------
 // Update Fcns
 //-------------------------------------------------------
+// keeps the updated slots in the order of their index, so the
+// sensors are fused in the same order whatever order data came in
+static void MarkLocalizeUpdated( localize *in, int index, int dirty )
+{
+	int i, j;
+	
+	if ( in->slot[index].dirty == dirty )
+	{
+		return;
+	}
+	in->slot[index].dirty = dirty;
+	
+	for (i = 0; i < in->num_updated && in->updated[i] < index; i++)
+	{
+	}
+	if ( dirty )
+	{
+		for (j = in->num_updated; j > i; j--)
+		{
+			in->updated[j] = in->updated[j - 1];
+		}
+		in->updated[i] = index;
+		in->num_updated++;
+	}
+	else
+	{
+		in->num_updated--;
+		for (j = i; j < in->num_updated; j++)
+		{
+			in->updated[j] = in->updated[j + 1];
+		}
+	}
+}
+
+// the step has used the data, no slot is updated until more comes
+static void ClearLocalizeUpdated( localize *in )
+{
+	int i;
+	
+	for (i = 0; i < in->num_updated; i++)
+	{
+		in->slot[ in->updated[i] ].dirty = 0;
+	}
+	in->num_updated = 0;
+}
+
 int UpdateLocalizeData( int sensor,  localize *in, size_t size_data, void *data  )
 {
-	// updates the external sensors data
+	// updates the sensor of the slot of index sensor, found 
+	// directly rather than by kind, with its data or none
+	if ( sensor < 0 || sensor >= in->sensors )
+	{
+		return -1;
+	}
+	UpdateSensorData( in->slot[sensor].ptr, size_data, data );
+	MarkLocalizeUpdated ( in, sensor, in->slot[sensor].ptr->updated );
+	
+	return 0;
+}
+// UpdateLocalizeImuSample is the producer side of the IMU ring
+// and may run in the thread reading the IMU while another
+// calls ComputeLocalize
+int UpdateLocalizeImuSample( localize *in, const double *accel, const double *angrate, double delta_time )
+{
+	return PushImuSample ( &(in->imu_preint), accel, angrate, delta_time );
+}
+// PushLocalizeData is the producer side of the queue of a slot
+// and may run in the thread of its driver while another calls 
+// ComputeLocalize; the time orders the packets of every queue
+int PushLocalizeData( int sensor, localize *in, unsigned long time_sec, unsigned long time_usec, size_t size_data, void *data )
+{
+	if ( sensor < 0 || sensor >= in->sensors || in->slot[sensor].queue_arena == NULL )
+	{
+		return -1;
+	}
+	
+	return PushSensorQueue ( &(in->slot[sensor].queue), time_sec, time_usec, size_data, data );
+}
+
+// DrainLocalizeQueues is the consumer side of every queue, run
+// by ComputeLocalize at the start of each step
+int DrainLocalizeQueues( localize *in )
+{
+	// the packets published when the drain starts, merged oldest
+	// first across the queues, equal times in the order of the slots;
+	// a queued sensor without a packet is handed no data, as a live 
+	// caller does, unless the caller updated it directly
+	unsigned long head[LOCALIZE_MAX_SENSORS];
+	int fresh[LOCALIZE_MAX_SENSORS];
+	sensor_queue_packet *packet, *oldest;
+	int drained = 0;
+	int i, next;
 	
-	// this fcn will be a stop gap until the full fcn list is 
-	// finally worked out
-	switch (sensor)
+	if ( in->queues == 0 )
+	{
+		return 0;
+	}
+	for (i = 0; i < in->sensors; i++)
 	{
-		case GPS_SENSOR:	
+		fresh[i] = 0;
+		if ( in->slot[i].queue_arena != NULL )
 		{
-			// send data to the gps
-			UpdateSensorData( (in->ptr_gps), size_data, data );
-			break;
+			head[i] = SensorQueueHead ( &(in->slot[i].queue) );
 		}
-		case IMU_SENSOR:	
+	}
+	
+	for ( ;; )
+	{
+		next 		= -1;
+		oldest 	= NULL;
+		for (i = 0; i < in->sensors; i++)
 		{
-			// send data to the imu
-			UpdateSensorData( (in->ptr_imu), size_data, data );
-			break;
-		}	
-		case ODOM_SENSOR:	
+			if ( in->slot[i].queue_arena == NULL 
+				|| ( packet = SensorQueueFront ( &(in->slot[i].queue), head[i] ) ) == NULL )
+			{
+				continue;
+			}
+			if ( oldest == NULL || packet->t_sec < oldest->t_sec 
+				|| ( packet->t_sec == oldest->t_sec && packet->t_usec < oldest->t_usec ) )
+			{
+				next 		= i;
+				oldest 	= packet;
+			}
+		}
+		if ( next < 0 )
 		{
-			// send data to the odom
-			UpdateSensorData( (in->ptr_odom), size_data, data );
 			break;
-		}	
+		}
+		
+		// a packet clock takes the time of the packet, the only one of the odometry
+		SetSensorClockPacket ( &(in->clock), (long)oldest->t_sec, (long)oldest->t_usec );
+		UpdateLocalizeData ( next, in, oldest->size, SensorQueueData ( oldest ) );
+		PopSensorQueue ( &(in->slot[next].queue) );
+		fresh[next] = 1;
+		drained++;
+	}
+	
+	for (i = 0; i < in->sensors; i++)
+	{
+		if ( in->slot[i].queue_arena != NULL && fresh[i] == 0 && in->slot[i].dirty == 0 )
+		{
+			UpdateLocalizeData ( i, in, 0, NULL );
+		}
 	}
 	
+	return drained;
 }
+
 int UpdateLocalize( localize *in )
 {
 	// updates the Localize 
@@ -200,25 +699,26 @@ int UpdateLocalize( localize *in )
 //! The IDLs do not all have timestamps, nor do some of the sensors
 //! and so I will use the computer time for the moment to make realistic 
 //! if not completely accurate computations.
+//! The time now comes from the localize clock, that of the sensors
 int UpdateLocalizeTime2 (localize *out )
 {
-	//! get time from computer and substitute it into the current time stamp
+	//! get time from the clock and substitute it into the current time stamp
 	//! and then compute the latest delta time for computation.
-	struct timeval   computer_time;
-	
-	gettimeofday( &computer_time, 0 );//! timezone not implemented under linux, needs to be zero
 	
 	//! update the time data from sequential measurements
 	(out->pt_sec) 	= (out->t_sec);
 	(out->pt_usec) 	= (out->t_usec);
 	
-	//! update new time from computer
-	out->t_sec			= ( unsigned long )computer_time.tv_sec;
-	out->t_usec 		= ( unsigned long )computer_time.tv_usec;
+	//! update new time from the clock
+	GetSensorClockTime ( &(out->clock), &(out->t_sec), &(out->t_usec) );
 	
 	//! compute delta time step adding microseconds to seconds
 	out->delta_time  = ((double)out->t_sec - (double)out->pt_sec ) + (MICROSECOND_CONVERSION)*((double)out->t_usec - (double)out->pt_usec);
-	//printf("%e \n", out->delta_time );
+	if ( out->pt_sec == 0 && out->pt_usec == 0 )
+	{
+		//! no previous time, a packet clock before its first packet
+		out->delta_time = 0.0;
+	}
 
 	return 0;
 }//! end UpdateSensorTime2
@@ -233,74 +733,41 @@ int UpdateLocalizeTime2 (localize *out )
 //-------------------------------------------------------
 // Compute Fcns
 //-------------------------------------------------------
-// compute the state vector of attached sensors
+// compute the state vector of the sensor of a slot
 int ComputeSensorStateVector( int sensor,  localize *in )
 {
-	// compute the state vector of attached sensors
-	switch (sensor)
+	localize_slot *slot;
+	
+	if ( sensor < 0 || sensor >= in->sensors )
 	{
-		case GPS_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			// 	int (*GenerateStateVector)( void *in, state_vector *out);
-			in->ptr_gps->GenerateStateVector( (void *)in->ptr_gps, &(in->ptr_gps->sv) );
-			// place the computed state vector within Localize
-			CopyStateVector ( &(in->ptr_gps->sv), &(in->gps_state));
-			break;
-		}
-		case IMU_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			in->ptr_imu->GenerateStateVector( (void *)in->ptr_imu, &(in->ptr_imu->sv) );
-			// place the computed state vector within Localize
-			CopyStateVector ( &(in->ptr_imu->sv), &(in->imu_state));
-			break;
-		}	
-		case ODOM_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			in->ptr_odom->GenerateStateVector( (void *)in->ptr_odom, &(in->ptr_odom->sv) );
-			// place the computed state vector within Localize
-			CopyStateVector ( &(in->ptr_odom->sv), &(in->odom_state));			
-			break;
-		}	
-		
+		return -1;
 	}
+	slot = &(in->slot[sensor]);
+	
+	// force the sensor to compute internal state vector
+	// 	int (*GenerateStateVector)( void *in, state_vector *out);
+	slot->ptr->GenerateStateVector( (void *)slot->ptr, &(slot->ptr->sv) );
+	// place the computed state vector within Localize
+	CopyStateVector ( &(slot->ptr->sv), &(slot->state));
 	
 	return 0;
 }
  
-// compute the vel matrix of a single attached sensor
+// compute the vel matrix of the sensor of a slot
 int ComputeSensorVelMatrix( int sensor,  localize *in)
 {
-	// compute the velocity matrix of attached sensors
-	switch (sensor)
+	localize_slot *slot;
+	
+	if ( sensor < 0 || sensor >= in->sensors )
 	{
-		case GPS_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			in->ptr_gps->GenerateVelMatrix( (void *)in->ptr_gps, &(in->ptr_gps->vm) );
-			// place the computed state vector within Localize
-			km_SetVelMatrix2( (in->ptr_gps->vm),&(in->gps_velocity));// vel matrix version
-			break;
-		}
-		case IMU_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			in->ptr_imu->GenerateVelMatrix( (void *)in->ptr_imu, &(in->ptr_imu->vm) );
-			// place the computed state vector within Localize
-			km_SetVelMatrix2( (in->ptr_imu->vm), &(in->imu_velocity));
-			break;
-		}	
-		case ODOM_SENSOR:	
-		{
-			// force GPS to compute internal state vector
-			in->ptr_odom->GenerateVelMatrix( (void *)in->ptr_odom, &(in->ptr_odom->vm) );
-			// place the computed state vector within Localize
-			km_SetVelMatrix2( (in->ptr_odom->vm), &(in->odom_velocity));			
-			break;
-		}	
+		return -1;
 	}
+	slot = &(in->slot[sensor]);
+	
+	// force the sensor to compute internal velocity matrix
+	slot->ptr->GenerateVelMatrix( (void *)slot->ptr, &(slot->ptr->vm) );
+	// place the computed velocity matrix within Localize
+	km_SetVelMatrix2( (slot->ptr->vm), &(slot->velocity));
 
 	return 0;
 }
@@ -322,49 +789,40 @@ int FuseSensorStateVector( localize *in )
 {
 	// fuses the respective estimates from the various 
 	// sensors into a fused output
-
-	// first version just send back GPS version
-	//*(in->ptr_fused_state) = (in->gps_state);
 	
-	// The second version attempts to reduce the
-	// "snapback problem" that would occur from a bad
-	// predicted value of an absolute sensor that 
-	// wrongfully negates velocity and acceleration from the previous
-	// timestep.
+	// Each sensor with new data adds the information of the
+	// elements it supplies, weighted by the covariance of its
+	// filter, and the sum is solved for the fused state.  A
+	// sensor without new data adds nothing, and an element no
+	// sensor supplied keeps its previous fused value.  This
+	// replaces taking GPS position and IMU heading as they are.
+	sensor *updated;
+	double z[STATE_ARRAY];
+	double x[STATE_ARRAY];
+	int i;
 	
-	// If first iteration, take the value of GPS reading as a start to
-	// begin the computation.  This speeds up the convergence of a solution
 	// copy to previous state
 	CopyStateVector ( in->ptr_fused_state, &(in->previous_fused_state));// copy contents from in into out
-			
-	// first version just send back GPS state 
-	CopyStateVector ( &(in->ptr_gps->sv), in->ptr_fused_state);// copy contents from in into out
-
 	
-	//printf("FuseStateVector:%e %e %e\n", in->ptr_gps->sv.loc.x, in->ptr_gps->sv.loc.y, in->ptr_gps->sv.loc.z );	
-	
-	// copy imu heading into fused state quaternions
-	in->ptr_fused_state->orient.s = in->ptr_imu->sv.orient.s;
-	in->ptr_fused_state->orient.x = in->ptr_imu->sv.orient.x;
-	in->ptr_fused_state->orient.y = in->ptr_imu->sv.orient.y;
-	in->ptr_fused_state->orient.z = in->ptr_imu->sv.orient.z;				
-/*		// Weigh the old vector with the 
-		// new estimate.
-		
-		// copy current to previous state
-		CopyStateVector ( in->ptr_fused_state, &(in->previous_fused_state));// copy contents from in into out
-		
-		// weigh GPS vector with into fused state vector
-		WeighStateVectors ( in->gps_state, 0.75, in->ptr_fused_state );	
-		
-		// This is where additional absolute measurements may be applied to the 
-		// state of the system while fused together.  The next step will be to analyze the 
-		// other sensors and find a way to weight the inputs.
-		
+	if ( in->num_updated == 0 )
+	{
+		// nothing new, the fused state stands as the solve would leave it
+		return 0;
 	}
-	else // not first data point and no new measurement
+	
+	// information of this step only, from the updated slots alone
+	ZeroFusionInformation ( &(in->state_info) );
+	for (i = 0; i < in->num_updated; i++)
 	{
-*/
+		updated = in->slot[ in->updated[i] ].ptr;
+		km_GetStateArray ( &(updated->sv), z );
+		AddFusionInformation ( &(in->state_info), updated->filter, updated->sv_transducer, z );
+	}
+	
+	// solve over the elements supplied, the rest keep their value
+	km_GetStateArray ( in->ptr_fused_state, x );
+	SolveFusionInformation ( &(in->state_info), x );
+	km_SetStateArray ( x, in->ptr_fused_state );
 
 	return 0;
 }
@@ -373,63 +831,243 @@ int FuseSensorVelMatrix( localize *in )
 {
 	// fuses the respective estimates from the various 
 	// sensors into a fused output
+	
+	// information form as for the state vector, so the IMU and
+	// odometer Vx are now blended by their filter variances
+	sensor *updated;
+	int increment;
+	int i;
+	
+	// an imu increment is new data without UpdateLocalizeData
+	increment = ( in->imu_delta.samples > 0 && in->slot[IMU_SENSOR].dirty == 0 );
+	if ( in->num_updated == 0 && !increment )
+	{
+		// nothing new, the fused velocities stand
+		return 0;
+	}
+	
+	// information of this step only, from the updated slots alone
+	ZeroFusionInformation ( &(in->vel_info) );
+	for (i = 0; i < in->num_updated; i++)
+	{
+		if ( increment && in->updated[i] > IMU_SENSOR )
+		{
+			// in its place among the slots
+			AddFusionInformation ( &(in->vel_info), in->ptr_imu->filter, in->ptr_imu->vm_transducer, in->ptr_imu->vm.vel );
+			increment = 0;
+		}
+		updated = in->slot[ in->updated[i] ].ptr;
+		AddFusionInformation ( &(in->vel_info), updated->filter, updated->vm_transducer, updated->vm.vel );
+	}
+	if ( increment )
+	{
+		AddFusionInformation ( &(in->vel_info), in->ptr_imu->filter, in->ptr_imu->vm_transducer, in->ptr_imu->vm.vel );
+	}
+	
+	// solve over the elements supplied, the rest keep their value
+	SolveFusionInformation ( &(in->vel_info), in->ptr_fused_vel_matrix->vel );
 
-	// first version just send back GPS version
-	//*(in->ptr_fused_vel_matrix) = (in->imu_velocity);
-	
-	
-	// second version
-	// average Vx components
-	in->ptr_fused_vel_matrix->vel[0] = in->imu_velocity.vel[0];//0.75*(in->imu_velocity.vel[0]) + 0.25*(in->odom_velocity.vel[0]);
-	printf("fused velocity: %e   imu:%e  odom:%e \n", in->ptr_fused_vel_matrix->vel[0], (in->imu_velocity.vel[0]), (in->odom_velocity.vel[0])  );
-	// Use IMU component for Vx
-	in->ptr_fused_vel_matrix->vel[1] = 1.0*in->imu_velocity.vel[1]; 
-	// Use IMU component for Vz
-	in->ptr_fused_vel_matrix->vel[2] = 1.0*in->imu_velocity.vel[2]; 
-	// Use IMU component for Omegax
-	in->ptr_fused_vel_matrix->vel[3] = 1.0*in->imu_velocity.vel[3];	
-	// Use IMU component for Omegay
-	in->ptr_fused_vel_matrix->vel[4] = 1.0*in->imu_velocity.vel[4];
-	// Use IMU component for Omegaz
-	in->ptr_fused_vel_matrix->vel[5] = 1.0*in->imu_velocity.vel[5];	
+	return 0;
+}
+// variance of a transducer as its sensor filter has it
+static double SensorVariance ( sensor *in, int transducer )
+{
+	return in->filter->P[ transducer + in->filter->num_elements*transducer ];
+}
 
+// corrects the error state filter with what a sensor of role 
+// measured, weighted by its filter variance, at its stamp
+static int CorrectLocalizeErrorState( localize *in, sensor *measured, int role )
+{
+	double z[STATE_ARRAY];
+	double variance[3];
+	int i;
+	
+	switch (role)
+	{
+		case LOCALIZE_ROLE_INERTIAL:
+		{
+			// quaternion of the imu, a rotation angle is twice a quaternion element
+			km_GetStateArray ( &(measured->sv), z );
+			variance[0] = 0.0;
+			for (i = 4; i < STATE_ARRAY; i++)
+			{
+				variance[0] += 4.0*SensorVariance ( measured, measured->sv_transducer[i] )/3.0;
+			}
+			return ComputeESHistoryAttitude ( &(in->history), &(in->es), &(z[3]), variance[0], measured->stamp );
+		}
+		case LOCALIZE_ROLE_POSITION:
+		{
+			// utm easting, northing and altitude
+			km_GetStateArray ( &(measured->sv), z );
+			for (i = 0; i < 3; i++)
+			{
+				variance[i] = SensorVariance ( measured, measured->sv_transducer[i] );
+			}
+			// at the time of the fix, which is before now by the gps latency
+			return ComputeESHistoryPosition ( &(in->history), &(in->es), z, variance, measured->stamp );
+		}
+		case LOCALIZE_ROLE_SPEED:
+		{
+			// forward speed
+			return ComputeESHistorySpeed ( &(in->history), &(in->es), measured->vm.vel[0], 
+																		 SensorVariance ( measured, measured->vm_transducer[0] ), measured->stamp );
+		}
+	}
+	
+	// nothing for the filter
 	return 0;
 }
-int ComputeLocalize (localize *in )
+
+// error state engine
+int ComputeLocalizeErrorState( localize *in )
 {
-	// macro fcn to compute the Localize
+	// propagates the error state filter with the IMU specific force
+	// and rates, then corrects it with whatever the sensors measured
+	// since the last step, each weighted by its filter variance and
+	// applied at its sensor stamp, which may be before this step
+	static const int roles[3] = { LOCALIZE_ROLE_INERTIAL, LOCALIZE_ROLE_POSITION, LOCALIZE_ROLE_SPEED };
+	localize_slot *slot;
+	double accel[3], angrate[3];
+	double now;
+	int status = 0;
+	int i, r;
 	
-	// First Algorithm 
+	// copy to previous state
+	CopyStateVector ( in->ptr_fused_state, &(in->previous_fused_state));
 	
-	// Compute Sensor Absolute State Vectors
-	//printf("[%e %e %e ][ %f %f %f %f]\n", in->ptr_fused_state->loc.x, in->ptr_fused_state->loc.y, in->ptr_fused_state->loc.z, in->ptr_fused_state->orient.s, in->ptr_fused_state->orient.x, in->ptr_fused_state->orient.y, in->ptr_fused_state->orient.z );
-	// compute gps
-	ComputeSensorStateVector( GPS_SENSOR, in );
+	// this step ends now, on the clock of the sensor stamps
+	UpdateLocalizeTime2 ( in );	
+	now = (double)in->t_sec + (MICROSECOND_CONVERSION)*(double)in->t_usec;
 	
-	// compute imu
-	ComputeSensorStateVector( IMU_SENSOR, in );
+	if ( in->imu_delta.samples > 0 )
+	{
+		// one step over the preintegrated increment with its mean
+		// specific force and rate, both in the body at the start
+		for (i = 0; i < 3; i++)
+		{
+			accel[i] 		= in->imu_delta.delta_velocity[i]/in->imu_delta.delta_time;
+			angrate[i] 	= in->imu_delta.delta_angle[i]/in->imu_delta.delta_time;
+		}
+		if ( ComputeESHistoryPropagate ( &(in->history), &(in->es), accel, angrate, in->imu_delta.delta_time, now ) != 0 )
+		{
+			status = -1;
+		}
+	}
+	// accel 7-9 and angrate 10-12 of the imu transducers, unless preintegrated
+	if ( in->slot[IMU_SENSOR].dirty != 0 && in->imu_preint.update_period == 0.0 
+		&& ComputeESHistoryPropagate ( &(in->history), &(in->es), &(in->ptr_imu->array->value[7]), 
+																	 &(in->ptr_imu->array->value[10]), in->ptr_imu->delta_time, now ) != 0 )
+	{
+		status = -1;
+	}
 	
-	// compute odom
-	ComputeSensorStateVector( ODOM_SENSOR, in );
-		
-	// Fuse the absolute state vector with current state vector
-	// and alter the absolute Localize directly
-	FuseSensorStateVector( in );
+	// the updated sensors, attitude then position then speed,
+	// any number of each in the order of their slots
+	for (r = 0; r < 3; r++)
+	{
+		for (i = 0; i < in->num_updated; i++)
+		{
+			slot = &(in->slot[ in->updated[i] ]);
+			if ( slot->role == roles[r] && CorrectLocalizeErrorState ( in, slot->ptr, slot->role ) != 0 )
+			{
+				status = -1;
+			}
+		}
+	}
+	
+	// the filter state is the localize output
+	GetESFilterStateVector ( &(in->es), in->ptr_fused_state );
+	GetESFilterVelMatrix ( &(in->es), in->ptr_fused_vel_matrix );
+	
+	// keep the Jacobian and the rates of the state in step for callers
+	km_RefreshJacobian ( (in->ptr_fused_state->orient), in->ptr_jacob );
+	km_ComputeStateVector( *(in->ptr_jacob), in->fused_vel_matrix, in->ptr_fused_delta_state );
+	
+	return status;
+}
+
+// ComputeLocalizeIngest, ComputeLocalizeSensor and ComputeLocalizeFusion
+// are the stages of ComputeLocalize, for an executor that runs the
+// sensors of a step side by side, see localize_pipeline.h
+int ComputeLocalizeIngest( localize *in )
+{
+	// the packets the drivers queued since the last step
+	DrainLocalizeQueues ( in );
+	
+	// With an update period the IMU samples queued since the last
+	// update are preintegrated, and nothing else is done until they
+	// span the period.
+	in->imu_delta.samples = 0;
+	if ( in->imu_preint.update_period > 0.0 )
+	{
+		if ( ComputeImuPreintegration ( &(in->imu_preint) ) == 0 )
+		{
+			return 0;
+		}
+		GetImuIncrement ( &(in->imu_preint), &(in->imu_delta) );
+	}
+	
+	return 1;
+}
 
-				
-	// Compute the relative delta state vector
+int ComputeLocalizeSensor( int sensor, localize *in )
+{
+	// the filter, state vector and velocity matrix of one slot, of
+	// every slot or when incremental of those with new data alone;
+	// touches that slot and its sensor only
+	if ( sensor < 0 || sensor >= in->sensors )
+	{
+		return -1;
+	}
+	if ( in->incremental && in->slot[sensor].dirty == 0 
+		&& !( sensor == IMU_SENSOR && in->imu_delta.samples > 0 ) )
+	{
+		return 0;
+	}
 	
-	// First compute velocity matrices
-	// then transform using Jacobian into delta state vector
+	// Compute Sensor Absolute State Vector
+	if ( !in->incremental || in->slot[sensor].dirty != 0 )
+	{
+		ComputeSensorStateVector( sensor, in );
+	}
 	
-	// compute gps
-	ComputeSensorVelMatrix( GPS_SENSOR, in );
+	// then the velocity matrix, to be transformed using the Jacobian
+	// into the delta state vector - the imu from the increment when
+	// preintegrating, for the kinematic model
+	if ( sensor == IMU_SENSOR && in->imu_delta.samples > 0 
+		&& in->engine == LOCALIZE_ENGINE_KINEMATIC )
+	{
+		ImuIncrementVelMatrix ( &(in->imu_delta), &(in->ptr_imu->vm) );
+		km_SetVelMatrix2( (in->ptr_imu->vm), &(in->slot[IMU_SENSOR].velocity));
+		return 0;
+	}
+	if ( !in->incremental || in->slot[sensor].dirty != 0 )
+	{
+		ComputeSensorVelMatrix( sensor, in );
+	}
 	
-	// compute imu
-	ComputeSensorVelMatrix( IMU_SENSOR, in );
+	return 0;
+}
+
+int ComputeLocalizeFusion( localize *in )
+{
+	// joins the sensors of the step
+	int status;
 	
-	// compute odom
-	ComputeSensorVelMatrix( ODOM_SENSOR, in );
+	if ( in->engine == LOCALIZE_ENGINE_ERROR_STATE )
+	{
+		// the error state filter takes the place of both fusions
+		// and the kinematic model
+		status = ComputeLocalizeErrorState( in );
+		ClearLocalizeUpdated ( in );
+		
+		return status;
+	}
+		
+	// Fuse the absolute state vector with current state vector
+	// and alter the absolute Localize directly
+	FuseSensorStateVector( in );
 	
 	// Fuse velocity matrices
 	FuseSensorVelMatrix( in );
@@ -444,12 +1082,35 @@ int ComputeLocalize (localize *in )
 	// in->delta_time
 	km_ComputeKinematicModel ( in->ptr_jacob, in->fused_vel_matrix, in->delta_time, in->ptr_fused_delta_state, in->ptr_fused_state );
 	
-	
+	// the data of this step is used
+	ClearLocalizeUpdated ( in );
 	
 
 	return 0;
 }
 
+int ComputeLocalize (localize *in )
+{
+	// macro fcn to compute the Localize
+	int i;
+	
+	if ( ComputeLocalizeIngest ( in ) == 0 )
+	{
+		// no step yet
+		return 0;
+	}
+	
+	// First Algorithm 
+	
+	// each sensor, then their fusion
+	for (i = 0; i < in->sensors; i++)
+	{
+		ComputeLocalizeSensor ( i, in );
+	}
+	
+	return ComputeLocalizeFusion ( in );
+}
+
 
 //-------------------------------------------------------
 // Output Fcns
@@ -36,6 +36,22 @@
 #include "sensor_odom.h"
 #endif
 
+#ifndef FUSION_H
+#include "fusion.h"
+#endif
+
+#ifndef FILTER_ERROR_STATE_H
+#include "filter_error_state.h"
+#endif
+
+#ifndef FILTER_HISTORY_H
+#include "filter_history.h"
+#endif
+
+#ifndef SENSOR_QUEUE_H
+#include "sensor_queue.h"
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,20 +65,77 @@ extern "C" {
 
 #define DATA_TYPE_LENGTH	36
 
+//!slots of the sensors InitLocalize sets up, those of AddLocalizeSensor follow
 #define GPS_SENSOR 				0
 #define IMU_SENSOR				1
 #define	ODOM_SENSOR				2
 
+//!most sensors of a localize
+#define LOCALIZE_MAX_SENSORS			16
+
+//!what the error state filter takes from a sensor, the kinematic engine fuses every one
+#define LOCALIZE_ROLE_NONE				0		//!nothing
+#define LOCALIZE_ROLE_POSITION		1		//!absolute position, as a GPS
+#define LOCALIZE_ROLE_INERTIAL		2		//!attitude, and propagation from that of IMU_SENSOR
+#define LOCALIZE_ROLE_SPEED				3		//!forward speed, as an odometer
+
+//!pose engines selected by SetLocalizeEngine
+#define LOCALIZE_ENGINE_KINEMATIC		0		//!fusion then the open loop kinematic model
+#define LOCALIZE_ENGINE_ERROR_STATE	1		//!error state filter at the IMU rate
+
+//!seconds of error state filter steps kept for late measurements, and the
+//!IMU period they are counted in until SetLocalizeHistory
+#define LOCALIZE_HISTORY_SPAN				0.5
+#define LOCALIZE_HISTORY_PERIOD			0.001
+
 //!Data structs
 //!predefined sensor types
 
+//! a sensor of the localize, found by its index
+typedef struct
+{
+	//!the sensor, own or the caller's
+	sensor *ptr;
+	//!LOCALIZE_ROLE_*
+	int role;
+	
+	//!sensor state vector and velocity matrix as of the last step
+	state_vector  state;
+	vel_matrix 		velocity;
+	
+	//!nonzero when data came since the last step
+	int dirty;
+	
+	//!a clone of a scripted template such as gps_template,
+	//!when the caller supplies no sensor of its own
+	sensor own;
+	
+	//!packets pushed by the thread of its driver, see SetLocalizeQueue,
+	//!and the block of the ring, NULL without one
+	sensor_queue queue;
+	void *queue_arena;
+	
+} localize_slot;
+
 //! localize data struct
 typedef struct
 {
-	//!Sensors involved are external objects
-	//!that are pointed to from this one.
+	//!Sensors involved are pointed to from the slots,
+	//!at the sensors of this localize or those of the
+	//!caller given to InitLocalizeSensors and AddLocalizeSensor.
 	//!This allows the sensors to be changed and 
 	//!initiated without altering this struct
+	localize_slot slot[LOCALIZE_MAX_SENSORS];
+	int sensors;
+	
+	//!slots with data since the last step, in the order of their index
+	int updated[LOCALIZE_MAX_SENSORS];
+	int num_updated;
+	//!slots with a queue
+	int queues;
+	
+	//!sensors of the GPS_SENSOR, IMU_SENSOR and ODOM_SENSOR slots,
+	//!the IMU of propagation and the GPS of the UTM zone
 	sensor *ptr_gps;
 	
 	sensor *ptr_odom;
@@ -77,11 +150,6 @@ typedef struct
 	state_vector  fused_state;
 	state_vector *ptr_fused_state;
 	
-	//!sensor state vectors
-	state_vector  gps_state;
-	state_vector  imu_state;
-	state_vector  odom_state;
-	
 	state_vector  fused_delta_state;
 	state_vector  previous_fused_state;
 	state_vector *ptr_fused_delta_state;	
@@ -90,10 +158,30 @@ typedef struct
 	vel_matrix 		fused_vel_matrix;
 	vel_matrix   *ptr_fused_vel_matrix;
 	
-	//!sensor velocity matrices
-	vel_matrix  gps_velocity;
-	vel_matrix  imu_velocity;
-	vel_matrix  odom_velocity;	
+	//!information of the updated sensors, rebuilt by each step with data - see fusion.h
+	fusion_info state_info;
+	fusion_info vel_info;
+	
+	//!pose engine, LOCALIZE_ENGINE_*
+	int engine;
+	//!nonzero to step only the sensors with new data, see SetLocalizeIncremental
+	int incremental;
+	//!error state filter of LOCALIZE_ENGINE_ERROR_STATE
+	es_filter es;
+	//!its last steps, so a measurement is applied at its sensor stamp,
+	//!span seconds of steps of period, and the block of the ring
+	es_history history;
+	double history_span;
+	double history_period;
+	void *history_arena;
+	
+	//!IMU samples preintegrated between updates, see sensor_imu.h
+	imu_preintegrator imu_preint;
+	//!increment of this update, no samples when not preintegrating
+	imu_increment imu_delta;
+	
+	//!clock of every time stamp of the localize and its sensors
+	sensor_clock clock;
 	
 	
 	//! previous time update in seconds
@@ -107,6 +195,10 @@ typedef struct
 	//! time difference between updates
 	double delta_time;	
 	
+	//! block holding the transducers and filters of the sensors of
+	//! InitLocalize, those added later have their own
+	void *arena;
+	
 } localize;
 
 
@@ -116,33 +208,61 @@ typedef struct
 localize * CreateLocalize( void );	//!creates and returns dynamic memory
 
 //!Destructors
+int DestroyLocalize( localize *out ); //!releases the sensors and the arena of InitLocalize
 
 //!Init Fcns
 int InitLocalize( localize *out ); //!inits the sub-members of the Localize data struct
+int InitLocalizeSensors( localize *out, sensor *gps, sensor *imu, sensor *odom ); //!as InitLocalize with the sensors of the caller, cloned from the templates where NULL
+int AddLocalizeSensor( localize *out, sensor *in, int role ); //!inits and adds a sensor of the caller with a LOCALIZE_ROLE_*, returns its index or -1
+int AddLocalizeSensorTemplate( localize *out, const sensor *scripted, int role ); //!as AddLocalizeSensor with a clone of a template such as gps_template
 
 //!Zero Fcns - zero the elements
 int ZeroLocalize( localize *in ); 
+int ResetLocalize( localize *out ); //!back to the initialized state without touching the heap
 
 //!Get/Set Functions - resets specific values into the data struct
 int SetCurrentLocalize( state_vector in,  localize *out ); //!adjusts the state vector and updates the Jacobian Matrix
 state_vector GetCurrentLocalize( localize *in );//!returns the current state vector
+sensor * GetLocalizeSensor( localize *in, int index ); //!returns the sensor of a slot, NULL if there is none
+int SetLocalizeEngine( localize *out, int engine ); //!selects the pose engine, starting the error state filter at the current state
+int SetLocalizeUpdatePeriod( localize *out, double period ); //!preintegrates the IMU and updates every period seconds, 0 for every call
+int SetLocalizeHistory( localize *out, double span, double imu_period ); //!keeps span seconds of error state steps for late measurements, the IMU at imu_period
+int SetLocalizeIncremental( localize *out, int incremental ); //!nonzero steps the filter of a sensor only on its data, 0 every step
+int SetLocalizeClock( localize *out, int source ); //!selects the SENSOR_CLOCK_* source of every time stamp and restarts the times
+int SetLocalizeQueue( localize *out, int sensor, unsigned long capacity, size_t packet_size ); //!gives a slot a queue of capacity packets, a power of two, 0 for none
+int GetLocalizeQueueStats( localize *in, int sensor, sensor_queue_stats *out ); //!depth and drop counts of the queue of a slot, from any thread
 
 
 //!Update Fcns - updates the sensors with latest data and updates predictions
-int UpdateLocalizeData( int sensor,  localize *in, size_t size_data, void *data  );//!updates the external sensors data
+int UpdateLocalizeData( int sensor,  localize *in, size_t size_data, void *data  );//!updates the sensor of a slot with its data, or none
 int UpdateLocalize( localize *in );//!updates the Localize 
-int	UpdateLocalizeTime2(localize *out);//! use computer time to update the timestamp
+int	UpdateLocalizeTime2(localize *out);//! use the localize clock to update the timestamp
+int UpdateLocalizeImuSample( localize *in, const double *accel, const double *angrate, double delta_time );//!queues one IMU sample, safe from one other thread
+int PushLocalizeData( int sensor, localize *in, unsigned long time_sec, unsigned long time_usec, size_t size_data, void *data );//!queues a packet of a slot taken at time_sec, time_usec, safe from one other thread per slot
+int DrainLocalizeQueues( localize *in );//!hands the queued packets to UpdateLocalizeData oldest first, returns how many
 
 //!Compute Fcns
-//!compute the state vector of attached sensors
+//!compute the state vector of the sensor of a slot
 int ComputeSensorStateVector( int sensor,  localize *in); 
-//!compute the vel matrix of attached sensors
+//!compute the vel matrix of the sensor of a slot
 int ComputeSensorVelMatrix( int sensor,  localize *in);
 
-//!Fuse the state vectors of attached sensors
+//!Fuse the state vectors of attached sensors in information form,
+//!each updated sensor weighted by the covariance of its filter
 int FuseSensorStateVector(  localize *in); 
-//!Fuse the vel matrices of attached sensors
+//!Fuse the vel matrices of attached sensors the same way
 int FuseSensorVelMatrix(  localize *in);
+//!propagate the error state filter with the IMU and correct it with the other sensors
+int ComputeLocalizeErrorState( localize *in );
+//!a step of the localize with the data of the last UpdateLocalizeData calls,
+//!after those queued since the last step
+int ComputeLocalize( localize *in );
+//!the stages of ComputeLocalize: the queued packets, 0 while preintegrating short of the period,
+int ComputeLocalizeIngest( localize *in );
+//!each sensor, side by side for distinct sensors,
+int ComputeLocalizeSensor( int sensor, localize *in );
+//!and the fusion of the sensors into the pose
+int ComputeLocalizeFusion( localize *in );
 
 //! Output Fcn - output to external functions
 
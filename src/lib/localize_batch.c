@@ -0,0 +1,319 @@
+//! localize_batch.c
+//!
+//! localize batch Functions
+/* $Id$ */
+
+
+/*
+
+	This c file runs the pool of RunLocalizeBatch.  The threads share only
+	the job list, the order it is claimed in and the counter of the next
+	claim; each writes its own jobs and its own report slot.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>			// malloc free qsort
+#include <stdio.h>			// fopen fprintf
+#include <pthread.h>		// pthread_create pthread_join
+#include <unistd.h>			// sysconf
+#include <time.h>				// clock_gettime
+#include <sys/stat.h>		// stat
+
+#include "localize_batch.h"
+#include "sensor_log.h"
+#include "filter_backend.h"
+
+
+//! buffer of an output file
+#define LOCALIZE_BATCH_BUFFER		(1 << 16)
+
+
+//! data struct what the threads of a batch share
+typedef struct
+{
+	localize_batch_job *jobs;
+	//! jobs in the order they are claimed
+	int *order;
+	int num_jobs;
+	int engine;
+	//! next entry of order to claim
+	int next;
+
+} localize_batch_pool;
+
+//! data struct one thread of the pool
+typedef struct
+{
+	pthread_t thread;
+	localize_batch_pool *pool;
+	//! cpu seconds the thread used
+	double cpu_seconds;
+	//! 0 unless the thread could not set up its localize
+	int status;
+
+} localize_batch_worker;
+
+//! data struct a log claimed by the pool, largest first
+typedef struct
+{
+	off_t size;
+	int job;
+
+} localize_batch_order;
+
+
+//!-------------------------------------------------------
+//! Time Fcns
+//!-------------------------------------------------------
+static double BatchSeconds( clockid_t clock )
+{
+	struct timespec now;
+
+	clock_gettime( clock, &now );
+
+	return (double)now.tv_sec + 1.0e-9*(double)now.tv_nsec;
+}
+
+
+//!-------------------------------------------------------
+//! Job Fcns
+//!-------------------------------------------------------
+//! writes a line of the state of the localize to the FILE of step_data
+static int WriteBatchStep( localize *state, void *step_data )
+{
+	FILE *output = (FILE *)step_data;
+	int written;
+
+	written = fprintf( output, "%lu.%06lu %.6f %.6f %.6f %.9f %.9f %.9f %.9f\n",
+										 state->t_sec, state->t_usec,
+										 state->fused_state.loc.x, state->fused_state.loc.y, state->fused_state.loc.z,
+										 state->fused_state.orient.s, state->fused_state.orient.x,
+										 state->fused_state.orient.y, state->fused_state.orient.z );
+
+	return ( written < 0 ) ? -1 : 0;
+}
+
+//! replays one log through state, from its initial state
+static int RunBatchJob( localize_batch_job *job, localize *state, int engine )
+{
+	sensor_log_reader reader;
+	FILE *output = NULL;
+	double start = BatchSeconds ( CLOCK_MONOTONIC );
+
+	job->records 	= 0;
+	job->steps 		= -1;
+
+	//! as if just initialized, on the clock of the log
+	ResetLocalize ( state );
+	SetLocalizeClock ( state, SENSOR_CLOCK_PACKET );
+	SetLocalizeEngine ( state, engine );
+
+	if ( OpenSensorLogReader ( &reader, job->log_path ) != 0 )
+	{
+		job->status = -1;
+		return -1;
+	}
+	if ( job->output_path != NULL )
+	{
+		output = fopen( job->output_path, "w" );
+		if ( output == NULL )
+		{
+			CloseSensorLogReader ( &reader );
+			job->status = -1;
+			return -1;
+		}
+		setvbuf( output, NULL, _IOFBF, LOCALIZE_BATCH_BUFFER );
+	}
+
+	job->steps 		= ReplaySensorLogSteps ( &reader, state,
+																				 ( output != NULL ) ? WriteBatchStep : NULL, output );
+	job->records 	= reader.records;
+	job->status 	= ( job->steps < 0 ) ? -1 : 0;
+
+	if ( output != NULL && fclose( output ) != 0 )
+	{
+		job->status = -1;
+	}
+	CloseSensorLogReader ( &reader );
+	job->seconds = BatchSeconds ( CLOCK_MONOTONIC ) - start;
+
+	return job->status;
+}
+
+//! a thread of the pool, claims logs until none are left
+static void * RunBatchWorker( void *arg )
+{
+	localize_batch_worker *worker = (localize_batch_worker *)arg;
+	localize_batch_pool *pool = worker->pool;
+	localize *state;
+	int claim;
+
+	//! the localize of this thread, for all the logs it claims
+	state = CreateLocalize ( );
+	if ( state == NULL || InitLocalize ( state ) != 0 )
+	{
+		free( state );
+		worker->status = -1;
+		return NULL;
+	}
+
+	while ( ( claim = __atomic_fetch_add( &(pool->next), 1, __ATOMIC_RELAXED ) ) < pool->num_jobs )
+	{
+		RunBatchJob ( &(pool->jobs[ pool->order[claim] ]), state, pool->engine );
+	}
+
+	DestroyLocalize ( state );
+	free( state );
+	worker->cpu_seconds = BatchSeconds ( CLOCK_THREAD_CPUTIME_ID );
+
+	return NULL;
+}
+
+//! larger logs first
+static int CompareBatchOrder( const void *a, const void *b )
+{
+	const localize_batch_order *left 	= (const localize_batch_order *)a;
+	const localize_batch_order *right = (const localize_batch_order *)b;
+
+	if ( left->size != right->size )
+	{
+		return ( left->size > right->size ) ? -1 : 1;
+	}
+
+	return left->job - right->job;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+int RunLocalizeBatch ( localize_batch_job *jobs, int num_jobs, int threads, int engine, localize_batch_report *report )
+{
+	localize_batch_pool pool;
+	localize_batch_worker *workers;
+	localize_batch_order *order;
+	struct stat log_stat;
+	double start;
+	int started = 0;
+	int status = 0;
+	int i;
+
+	if ( num_jobs < 0 || ( num_jobs > 0 && jobs == NULL ) )
+	{
+		return -1;
+	}
+	if ( threads <= 0 )
+	{
+		threads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	}
+	if ( threads > num_jobs )
+	{
+		threads = num_jobs;
+	}
+	if ( threads < 1 )
+	{
+		threads = 1;
+	}
+
+	order 	= (localize_batch_order *)malloc( ( num_jobs + 1 )*sizeof( localize_batch_order ) );
+	pool.order = (int *)malloc( ( num_jobs + 1 )*sizeof( int ) );
+	workers = (localize_batch_worker *)calloc( threads, sizeof( localize_batch_worker ) );
+	if ( order == NULL || pool.order == NULL || workers == NULL )
+	{
+		free( order );
+		free( pool.order );
+		free( workers );
+		return -1;
+	}
+
+	//! largest logs first, a log that cannot be read fails when claimed
+	for (i = 0; i < num_jobs; i++)
+	{
+		order[i].size = ( stat( jobs[i].log_path, &log_stat ) == 0 ) ? log_stat.st_size : 0;
+		order[i].job 	= i;
+		jobs[i].status 	= -1;
+		jobs[i].records = 0;
+		jobs[i].steps 	= -1;
+		jobs[i].seconds = 0.0;
+	}
+	qsort( order, num_jobs, sizeof( localize_batch_order ), CompareBatchOrder );
+	for (i = 0; i < num_jobs; i++)
+	{
+		pool.order[i] = order[i].job;
+	}
+	free( order );
+
+	pool.jobs 		= jobs;
+	pool.num_jobs = num_jobs;
+	pool.engine 	= engine;
+	pool.next 		= 0;
+
+	//! the backend is resolved here, outside the timed run
+	GetKFilterBackend ( );
+
+	start = BatchSeconds ( CLOCK_MONOTONIC );
+	for (i = 0; i < threads; i++)
+	{
+		workers[i].pool = &pool;
+		if ( pthread_create( &(workers[i].thread), NULL, RunBatchWorker, &(workers[i]) ) != 0 )
+		{
+			break;
+		}
+		started++;
+	}
+	if ( started == 0 )
+	{
+		//! no threads, the caller's thread does the work
+		RunBatchWorker ( &(workers[0]) );
+	}
+	for (i = 0; i < started; i++)
+	{
+		pthread_join( workers[i].thread, NULL );
+	}
+
+	if ( report != NULL )
+	{
+		report->threads 		= ( started > 0 ) ? started : 1;
+		report->jobs 				= num_jobs;
+		report->failed 			= 0;
+		report->records 		= 0;
+		report->seconds 		= BatchSeconds ( CLOCK_MONOTONIC ) - start;
+		report->cpu_seconds = 0.0;
+		for (i = 0; i < report->threads; i++)
+		{
+			report->cpu_seconds += workers[i].cpu_seconds;
+		}
+		for (i = 0; i < num_jobs; i++)
+		{
+			report->records += jobs[i].records;
+			if ( jobs[i].status != 0 )
+			{
+				report->failed++;
+			}
+		}
+		report->records_per_second 							= ( report->seconds > 0.0 ) ? (double)report->records/report->seconds : 0.0;
+		report->records_per_core_second 				= ( report->cpu_seconds > 0.0 ) ? (double)report->records/report->cpu_seconds : 0.0;
+	}
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		if ( jobs[i].status != 0 )
+		{
+			status = -1;
+		}
+	}
+	free( pool.order );
+	free( workers );
+
+	return status;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
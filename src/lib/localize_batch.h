@@ -0,0 +1,100 @@
+//! localize_batch.h
+//! localize batch Header File
+//! reprocesses many sensor logs at once, each through a localize of its own
+/*! $Id$ */
+
+/*
+
+	RunLocalizeBatch replays a list of sensor logs, see sensor_log.h, on a
+	pool of threads.  Each thread owns one localize, created and
+	initialized once and returned by ResetLocalize to its initial state
+	before every log, so no two logs share a sensor, a filter or a clock.
+	Every log runs on the packet clock and gives the same output however
+	many threads there are and whichever thread takes it.
+
+	The logs are independent and of one level, so the pool needs no
+	stealing between queues: a thread that finishes a log claims the next
+	from a shared atomic counter.  Logs are claimed largest first, so the
+	longest are not left to the end while the other threads sit idle.
+
+	A log with an output path has one line per step written there, the
+	localize time then the fused position and orientation:
+
+		t_sec.t_usec  x y z  s qx qy qz
+
+	Throughput is in samples, the records of the logs, per second of the
+	whole batch and per second of cpu time, which is per core as long as
+	there are no more threads than cores.
+
+*/
+
+//! Includes
+#include <stdint.h>
+
+#ifndef LOCALIZE_H
+#include "localize.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LOCALIZE_BATCH_H
+#define LOCALIZE_BATCH_H
+
+
+//! Data structs
+
+//! data struct one log of a batch
+typedef struct
+{
+	//! set by the caller
+	//! sensor log to replay
+	const char *log_path;
+	//! where the steps go, NULL for none
+	const char *output_path;
+
+	//! set by RunLocalizeBatch
+	//! 0 when the log was replayed and written, -1 otherwise
+	int status;
+	//! records read and ComputeLocalize steps taken
+	uint64_t records;
+	long steps;
+	//! seconds the replay took
+	double seconds;
+
+} localize_batch_job;
+
+//! data struct the totals of a batch
+typedef struct
+{
+	//! threads of the pool
+	int threads;
+	//! logs replayed and those that failed
+	int jobs;
+	int failed;
+	//! records of all logs
+	uint64_t records;
+	//! wall clock seconds of the batch and cpu seconds of all threads
+	double seconds;
+	double cpu_seconds;
+	//! records per wall clock second, and per cpu second, that is per busy core
+	double records_per_second;
+	double records_per_core_second;
+
+} localize_batch_report;
+
+
+//! Functions
+
+//! Compute Fcns
+//! replays the num_jobs logs of jobs on threads threads, every core when threads <= 0,
+//! each with the LOCALIZE_ENGINE_* engine, and fills in report when not NULL
+//! returns 0 when every log was replayed, -1 otherwise
+int RunLocalizeBatch ( localize_batch_job *jobs, int num_jobs, int threads, int engine, localize_batch_report *report );
+
+#endif  //! define LOCALIZE_BATCH_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
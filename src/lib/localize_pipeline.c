@@ -0,0 +1,486 @@
+//! localize_pipeline.c
+//!
+//! localize pipeline Functions
+/* $Id$ */
+
+
+/*
+
+	This c file runs the threads of localize_pipeline.  The coordinator
+	alone writes the localize outside of ComputeLocalizeSensor, and hands
+	each step to the filter threads with a release store of work; they
+	hand it back with a release decrement of pending.
+
+*/
+
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE				// pthread_attr_setaffinity_np CPU_SET
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>			// malloc free
+#include <string.h>			// memset
+#include <pthread.h>		// pthread_create pthread_join
+#include <sched.h>			// sched_yield cpu_set_t
+#include <unistd.h>			// sysconf
+#include <time.h>				// clock_gettime clock_nanosleep
+
+#include "localize_pipeline.h"
+#include "filter_backend.h"
+
+
+//! fields of work
+#define PIPELINE_WORK_NEXT(work)		( (int)( (work) & 0xffff ) )
+#define PIPELINE_WORK_COUNT(work)		( (int)( ( (work) >> 16 ) & 0xffff ) )
+#define PIPELINE_WORK_STEP(work)		( (work) >> 32 )
+
+//! default steps of the output queue
+#define PIPELINE_OUTPUTS		64
+
+
+//! data struct an entry of the output queue
+typedef struct
+{
+	localize_output pose;
+	//! when the ingest of the step started
+	uint64_t start_nsec;
+
+} localize_pipeline_entry;
+
+
+//!-------------------------------------------------------
+//! Time Fcns
+//!-------------------------------------------------------
+static uint64_t PipelineNsec( void )
+{
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return (uint64_t)now.tv_sec*1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+//! counts a run of a stage busy from start to end
+static void CountPipelineStage( localize_pipeline *in, int stage, uint64_t start, uint64_t end )
+{
+	__atomic_fetch_add( &(in->stage[stage].runs), 1, __ATOMIC_RELAXED );
+	__atomic_fetch_add( &(in->stage[stage].busy_nsec), end - start, __ATOMIC_RELAXED );
+}
+
+//! an idle thread waits a little before it looks again
+static void IdlePipeline( localize_pipeline *in )
+{
+	struct timespec wait;
+
+	if ( in->config.idle_usec <= 0 )
+	{
+		sched_yield( );
+		return;
+	}
+	wait.tv_sec 	= in->config.idle_usec/1000000;
+	wait.tv_nsec 	= ( in->config.idle_usec%1000000 )*1000;
+	nanosleep( &wait, NULL );
+}
+
+
+//!-------------------------------------------------------
+//! Thread Fcns
+//!-------------------------------------------------------
+//! claims the next sensor of the step under way, -1 when all are claimed
+static int ClaimPipelineSensor( localize_pipeline *in )
+{
+	uint64_t work = __atomic_load_n( &(in->work), __ATOMIC_ACQUIRE );
+
+	//! the step is part of the word, so a claim of a step gone by fails
+	while ( PIPELINE_WORK_NEXT( work ) < PIPELINE_WORK_COUNT( work ) )
+	{
+		if ( __atomic_compare_exchange_n( &(in->work), &work, work + 1, 0,
+																			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+		{
+			return PIPELINE_WORK_NEXT( work );
+		}
+	}
+
+	return -1;
+}
+
+//! runs the sensors it can claim, returns how many
+static int RunPipelineSensors( localize_pipeline *in )
+{
+	uint64_t start;
+	int sensor;
+	int done = 0;
+
+	while ( ( sensor = ClaimPipelineSensor ( in ) ) >= 0 )
+	{
+		start = PipelineNsec ( );
+		ComputeLocalizeSensor ( sensor, in->state );
+		CountPipelineStage ( in, LOCALIZE_STAGE_FILTER, start, PipelineNsec ( ) );
+		__atomic_fetch_sub( &(in->pending), 1, __ATOMIC_RELEASE );
+		done++;
+	}
+
+	return done;
+}
+
+//! a filter thread, runs sensors until stopped
+static void * RunPipelineWorker( void *arg )
+{
+	localize_pipeline_worker *worker = (localize_pipeline_worker *)arg;
+	localize_pipeline *pipeline = worker->pipeline;
+
+	while ( __atomic_load_n( &(pipeline->stop), __ATOMIC_ACQUIRE ) == 0 )
+	{
+		if ( RunPipelineSensors ( pipeline ) == 0 )
+		{
+			IdlePipeline ( pipeline );
+		}
+	}
+
+	return NULL;
+}
+
+//! whether a step is due, waiting for it a while if not
+static int PipelineStepDue( localize_pipeline *in, uint64_t *deadline )
+{
+	sensor_queue *pace;
+	struct timespec wake;
+
+	if ( in->config.pace >= 0 )
+	{
+		//! a packet of the pace slot waiting
+		pace = &(in->state->slot[ in->config.pace ].queue);
+		if ( SensorQueueHead ( pace ) != pace->tail )
+		{
+			return 1;
+		}
+		IdlePipeline ( in );
+		return 0;
+	}
+
+	//! every period, from the start of the run
+	wake.tv_sec 	= (time_t)( *deadline/1000000000ULL );
+	wake.tv_nsec 	= (long)( *deadline%1000000000ULL );
+	clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL );
+	*deadline += (uint64_t)in->config.period_usec*1000ULL;
+
+	return 1;
+}
+
+//! the coordinator, ingest, fan out, join and fusion of every step
+static void * RunPipelineCoordinator( void *arg )
+{
+	localize_pipeline *pipeline = (localize_pipeline *)arg;
+	localize *state = pipeline->state;
+	localize_pipeline_entry entry;
+	uint64_t deadline = pipeline->start_nsec;
+	uint64_t step = 0;
+	uint64_t start, joined, end;
+	int due;
+
+	memset( &entry, 0, sizeof( entry ) );
+	while ( __atomic_load_n( &(pipeline->stop), __ATOMIC_ACQUIRE ) == 0 )
+	{
+		if ( PipelineStepDue ( pipeline, &deadline ) == 0 )
+		{
+			continue;
+		}
+
+		start = PipelineNsec ( );
+		due = ComputeLocalizeIngest ( state );
+		end = PipelineNsec ( );
+		CountPipelineStage ( pipeline, LOCALIZE_STAGE_INGEST, start, end );
+		if ( due == 0 )
+		{
+			continue;
+		}
+
+		//! the sensors of the step to whichever thread claims them, this one too
+		step++;
+		__atomic_store_n( &(pipeline->pending), state->sensors, __ATOMIC_RELAXED );
+		__atomic_store_n( &(pipeline->work), ( step << 32 ) | ( (uint64_t)state->sensors << 16 ), __ATOMIC_RELEASE );
+		RunPipelineSensors ( pipeline );
+		while ( __atomic_load_n( &(pipeline->pending), __ATOMIC_ACQUIRE ) != 0 )
+		{
+			//! the last sensors are on the filter threads
+		}
+
+		joined = PipelineNsec ( );
+		ComputeLocalizeFusion ( state );
+		end = PipelineNsec ( );
+		CountPipelineStage ( pipeline, LOCALIZE_STAGE_FUSION, joined, end );
+		__atomic_store_n( &(pipeline->steps), pipeline->steps + 1, __ATOMIC_RELAXED );
+
+		//! the pose, dropped and counted by the queue if the output thread is behind
+		entry.pose.t_sec 	= state->t_sec;
+		entry.pose.t_usec = state->t_usec;
+		CopyStateVector ( state->ptr_fused_state, &(entry.pose.state) );
+		CopyStateVector ( state->ptr_fused_delta_state, &(entry.pose.delta_state) );
+		entry.start_nsec 	= start;
+		PushSensorQueue ( &(pipeline->outputs), state->t_sec, state->t_usec, sizeof( entry ), &entry );
+	}
+
+	__atomic_store_n( &(pipeline->stopped), 1, __ATOMIC_RELEASE );
+
+	return NULL;
+}
+
+//! the output thread, hands every pose queued to the output function
+static void * RunPipelineOutput( void *arg )
+{
+	localize_pipeline *pipeline = (localize_pipeline *)arg;
+	localize_pipeline_entry *entry;
+	sensor_queue_packet *packet;
+	uint64_t start, end;
+	unsigned long head;
+	int stopped;
+
+	for (;;)
+	{
+		//! stopped before head, so the last poses are in it
+		stopped = __atomic_load_n( &(pipeline->stopped), __ATOMIC_ACQUIRE );
+		head 		= SensorQueueHead ( &(pipeline->outputs) );
+		if ( ( packet = SensorQueueFront ( &(pipeline->outputs), head ) ) == NULL )
+		{
+			if ( stopped )
+			{
+				break;
+			}
+			IdlePipeline ( pipeline );
+			continue;
+		}
+		for ( ; packet != NULL; packet = SensorQueueFront ( &(pipeline->outputs), head ) )
+		{
+			entry = (localize_pipeline_entry *)SensorQueueData ( packet );
+			start = PipelineNsec ( );
+			entry->pose.latency = 1.0e-9*(double)( start - entry->start_nsec );
+			if ( pipeline->config.output != NULL )
+			{
+				pipeline->config.output( &(entry->pose), pipeline->config.output_data );
+			}
+			end = PipelineNsec ( );
+			CountPipelineStage ( pipeline, LOCALIZE_STAGE_OUTPUT, start, end );
+
+			//! latency to the return of the output function
+			__atomic_fetch_add( &(pipeline->latency_nsec), end - entry->start_nsec, __ATOMIC_RELAXED );
+			if ( end - entry->start_nsec > pipeline->latency_max_nsec )
+			{
+				__atomic_store_n( &(pipeline->latency_max_nsec), end - entry->start_nsec, __ATOMIC_RELAXED );
+			}
+			PopSensorQueue ( &(pipeline->outputs) );
+		}
+	}
+
+	return NULL;
+}
+
+//! starts a thread pinned to cpu, or unpinned if it cannot be
+static int StartPipelineThread( localize_pipeline *in, pthread_t *thread, int cpu, void *(*run)( void * ), void *arg )
+{
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	int status = -1;
+
+	if ( cpu >= 0 && cpu < CPU_SETSIZE && pthread_attr_init( &attr ) == 0 )
+	{
+		CPU_ZERO( &cpus );
+		CPU_SET( cpu, &cpus );
+		if ( pthread_attr_setaffinity_np( &attr, sizeof( cpus ), &cpus ) == 0 )
+		{
+			status = pthread_create( thread, &attr, run, arg );
+		}
+		pthread_attr_destroy( &attr );
+		if ( status == 0 )
+		{
+			in->pinned++;
+			return 0;
+		}
+	}
+
+	return ( pthread_create( thread, NULL, run, arg ) == 0 ) ? 0 : -1;
+}
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+int InitLocalizePipelineConfig ( localize_pipeline_config *out )
+{
+	long cores = sysconf( _SC_NPROCESSORS_ONLN );
+
+	//! the coordinator and output threads take a core each
+	out->workers 			= ( cores > 2 ) ? (int)( cores - 2 ) : 0;
+	out->first_cpu 		= -1;
+	out->pace 				= IMU_SENSOR;
+	out->period_usec 	= 0;
+	out->idle_usec 		= 0;
+	out->outputs 			= PIPELINE_OUTPUTS;
+	out->output 			= NULL;
+	out->output_data 	= NULL;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Compute Fcns
+//!-------------------------------------------------------
+int StartLocalizePipeline ( localize_pipeline *out, localize *in, const localize_pipeline_config *config )
+{
+	size_t arena_size;
+	int cpu;
+	int status = 0;
+	int i;
+
+	if ( config->pace >= in->sensors
+		|| ( config->pace >= 0 && in->slot[ config->pace ].queue_arena == NULL )
+		|| ( config->pace < 0 && config->period_usec <= 0 ) )
+	{
+		//! nothing to start a step
+		return -1;
+	}
+	arena_size = SizeSensorQueueArena ( config->outputs, sizeof( localize_pipeline_entry ) );
+	if ( arena_size == 0 )
+	{
+		return -1;
+	}
+
+	memset( out, 0, sizeof( localize_pipeline ) );
+	out->state 	= in;
+	out->config = *config;
+	out->outputs_arena = malloc( arena_size );
+	if ( out->outputs_arena == NULL )
+	{
+		return -1;
+	}
+	InitSensorQueueArena ( &(out->outputs), config->outputs, sizeof( localize_pipeline_entry ), out->outputs_arena );
+
+	//! more filter threads than sensors besides the coordinator's would sit idle
+	out->workers = config->workers;
+	if ( out->workers > in->sensors - 1 )
+	{
+		out->workers = in->sensors - 1;
+	}
+	if ( out->workers > LOCALIZE_PIPELINE_WORKERS )
+	{
+		out->workers = LOCALIZE_PIPELINE_WORKERS;
+	}
+	if ( out->workers < 0 )
+	{
+		out->workers = 0;
+	}
+
+	//! the backend is resolved here, outside the timed run
+	GetKFilterBackend ( );
+
+	out->start_nsec = PipelineNsec ( );
+	cpu = config->first_cpu;
+	for (i = 0; i < out->workers; i++)
+	{
+		out->worker[i].pipeline = out;
+		out->worker[i].cpu 			= ( cpu >= 0 ) ? cpu + 2 + i : -1;
+		if ( StartPipelineThread ( out, &(out->worker[i].thread), out->worker[i].cpu, RunPipelineWorker, &(out->worker[i]) ) != 0 )
+		{
+			out->workers = i;
+			status = -1;
+			break;
+		}
+	}
+	if ( status == 0 && StartPipelineThread ( out, &(out->output), ( cpu >= 0 ) ? cpu + 1 : -1, RunPipelineOutput, out ) != 0 )
+	{
+		status = -1;
+	}
+	else if ( status == 0 && StartPipelineThread ( out, &(out->coordinator), cpu, RunPipelineCoordinator, out ) != 0 )
+	{
+		//! no coordinator, the output thread ends with nothing to output
+		__atomic_store_n( &(out->stopped), 1, __ATOMIC_RELEASE );
+		pthread_join( out->output, NULL );
+		status = -1;
+	}
+
+	if ( status != 0 )
+	{
+		__atomic_store_n( &(out->stop), 1, __ATOMIC_RELEASE );
+		for (i = 0; i < out->workers; i++)
+		{
+			pthread_join( out->worker[i].thread, NULL );
+		}
+		free( out->outputs_arena );
+		out->outputs_arena = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int StopLocalizePipeline ( localize_pipeline *in )
+{
+	int i;
+
+	if ( in->outputs_arena == NULL )
+	{
+		return -1;
+	}
+
+	//! the coordinator ends after its step, then the others
+	__atomic_store_n( &(in->stop), 1, __ATOMIC_RELEASE );
+	pthread_join( in->coordinator, NULL );
+	for (i = 0; i < in->workers; i++)
+	{
+		pthread_join( in->worker[i].thread, NULL );
+	}
+	pthread_join( in->output, NULL );
+	in->stop_nsec = PipelineNsec ( );
+
+	//! the counts of the output queue are kept for the report
+	free( in->outputs_arena );
+	in->outputs_arena = NULL;
+	in->outputs.entry = NULL;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Fcns
+//!-------------------------------------------------------
+int GetLocalizePipelineReport ( localize_pipeline *in, localize_pipeline_report *out )
+{
+	sensor_queue_stats outputs;
+	uint64_t end;
+	int i;
+
+	end = ( in->stop_nsec != 0 ) ? in->stop_nsec : PipelineNsec ( );
+	GetSensorQueueStats ( &(in->outputs), &outputs );
+
+	out->steps 		= __atomic_load_n( &(in->steps), __ATOMIC_RELAXED );
+	out->dropped 	= outputs.dropped;
+	out->seconds 	= 1.0e-9*(double)( end - in->start_nsec );
+	out->pinned 	= in->pinned;
+
+	out->threads[LOCALIZE_STAGE_INGEST] = 1;
+	out->threads[LOCALIZE_STAGE_FILTER] = in->workers + 1;
+	out->threads[LOCALIZE_STAGE_FUSION] = 1;
+	out->threads[LOCALIZE_STAGE_OUTPUT] = 1;
+	for (i = 0; i < LOCALIZE_STAGES; i++)
+	{
+		out->runs[i] 			= __atomic_load_n( &(in->stage[i].runs), __ATOMIC_RELAXED );
+		out->busy[i] 			= 1.0e-9*(double)__atomic_load_n( &(in->stage[i].busy_nsec), __ATOMIC_RELAXED );
+		out->occupancy[i] = ( out->seconds > 0.0 ) ? out->busy[i]/( out->seconds*out->threads[i] ) : 0.0;
+	}
+
+	out->latency 			= ( out->runs[LOCALIZE_STAGE_OUTPUT] > 0 )
+											? 1.0e-9*(double)__atomic_load_n( &(in->latency_nsec), __ATOMIC_RELAXED )/(double)out->runs[LOCALIZE_STAGE_OUTPUT] : 0.0;
+	out->latency_max 	= 1.0e-9*(double)__atomic_load_n( &(in->latency_max_nsec), __ATOMIC_RELAXED );
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,203 @@
+//! localize_pipeline.h
+//! localize pipeline Header File
+//! runs the stages of ComputeLocalize on threads of their own
+/*! $Id$ */
+
+/*
+
+	A localize_pipeline steps a localize on threads of its own, each stage
+	of ComputeLocalize on its own core, in place of a caller that calls
+	ComputeLocalize itself:
+
+		ingest		ComputeLocalizeIngest takes the packets the drivers
+					queued with PushLocalizeData
+		filter		ComputeLocalizeSensor runs GenerateStateVector and
+					GenerateVelMatrix of each sensor, the sensors side by
+					side on the filter threads
+		fusion		ComputeLocalizeFusion joins on the last sensor and
+					fuses them into the pose
+		output		the pose of each step goes to the output function
+					through a sensor_queue, off the fusion thread
+
+	Ingest, the fan out of the sensors, the join and fusion run on one
+	thread, the coordinator, which is the one consumer of the queues of the
+	localize and takes a share of the sensors itself.  The sensors of a
+	step are claimed from one atomic word holding the step, the number of
+	sensors and the next to claim, and counted back down as they are done,
+	so no thread waits on a lock.  Each sensor is touched by the one thread
+	that claimed it, and fusion starts only once all of them are done; the
+	result of every step is that of ComputeLocalize.
+
+	A step is taken as the packets of the pace slot arrive, the IMU by
+	default, or every period_usec when there is no pace slot.  The localize
+	belongs to the pipeline from StartLocalizePipeline to
+	StopLocalizePipeline: the caller only pushes packets and reads the
+	report in that time.
+
+	Each stage counts the time it is busy, and its occupancy is that time
+	over the time of the run on every thread of the stage.  The latency of
+	a step is from the start of its ingest to the return of its output.
+
+*/
+
+//! Includes
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef LOCALIZE_H
+#include "localize.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LOCALIZE_PIPELINE_H
+#define LOCALIZE_PIPELINE_H
+
+
+//! Defines
+
+//! stages of the pipeline
+#define LOCALIZE_STAGE_INGEST		0
+#define LOCALIZE_STAGE_FILTER		1
+#define LOCALIZE_STAGE_FUSION		2
+#define LOCALIZE_STAGE_OUTPUT		3
+#define LOCALIZE_STAGES					4
+
+//! most filter threads
+#define LOCALIZE_PIPELINE_WORKERS	LOCALIZE_MAX_SENSORS
+
+
+//! Data structs
+
+//! data struct the pose of one step, handed to the output function
+typedef struct
+{
+	//! localize time of the step
+	unsigned long t_sec;
+	unsigned long t_usec;
+	//! fused state and fused delta state of the step
+	state_vector state;
+	state_vector delta_state;
+	//! seconds from the ingest of the step to its output
+	double latency;
+
+} localize_output;
+
+//! data struct how a pipeline runs, set by the caller
+typedef struct
+{
+	//! filter threads besides the coordinator, 0 for the sensors on the coordinator alone
+	int workers;
+	//! cpu of the coordinator, the output thread and the filter threads in turn, -1 for no pinning
+	int first_cpu;
+	//! slot whose packets start a step, -1 for a step every period_usec
+	int pace;
+	long period_usec;
+	//! microseconds an idle thread sleeps between looks, 0 to yield instead
+	long idle_usec;
+	//! steps the output queue holds, a power of two
+	unsigned long outputs;
+	//! called on the output thread with the pose of each step, NULL for none
+	int (*output)( const localize_output *out, void *output_data );
+	void *output_data;
+
+} localize_pipeline_config;
+
+//! data struct the counts of one stage, written by its threads
+typedef struct
+{
+	uint64_t runs;
+	uint64_t busy_nsec;
+
+} localize_pipeline_stage;
+
+//! data struct a filter thread
+typedef struct
+{
+	pthread_t thread;
+	struct localize_pipeline_struct *pipeline;
+	//! cpu it is pinned to, -1 for none
+	int cpu;
+
+} localize_pipeline_worker;
+
+//! data struct a running pipeline, kept by the caller
+typedef struct localize_pipeline_struct
+{
+	localize *state;
+	localize_pipeline_config config;
+
+	//! step, sensors and next sensor to claim, 16 bits each from the low end
+	uint64_t work __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	//! sensors of the step not yet done
+	int pending __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	//! set to end the run, and once the coordinator has stepped for the last time
+	int stop __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	int stopped;
+
+	//! the poses on their way to the output thread
+	sensor_queue outputs;
+	void *outputs_arena;
+
+	pthread_t coordinator;
+	pthread_t output;
+	localize_pipeline_worker worker[LOCALIZE_PIPELINE_WORKERS];
+	int workers;
+	//! threads pinned to the cpu asked for
+	int pinned;
+
+	localize_pipeline_stage stage[LOCALIZE_STAGES];
+	uint64_t steps;
+	uint64_t latency_nsec;
+	uint64_t latency_max_nsec;
+	uint64_t start_nsec;
+	uint64_t stop_nsec;
+
+} localize_pipeline;
+
+//! data struct the totals of a pipeline
+typedef struct
+{
+	//! steps taken, and those whose pose the output queue had no room for
+	uint64_t steps;
+	uint64_t dropped;
+	//! wall clock seconds of the run
+	double seconds;
+	//! threads of each stage, steps or sensors each ran, seconds busy, and busy over seconds*threads
+	int threads[LOCALIZE_STAGES];
+	uint64_t runs[LOCALIZE_STAGES];
+	double busy[LOCALIZE_STAGES];
+	double occupancy[LOCALIZE_STAGES];
+	//! threads pinned to the cpu asked for
+	int pinned;
+	//! seconds from ingest to output, mean and most, of the steps output
+	double latency;
+	double latency_max;
+
+} localize_pipeline_report;
+
+
+//! Functions
+
+//! Init Fcns
+//! the config of a pipeline with the sensors on every core left, unpinned, paced by the IMU
+int InitLocalizePipelineConfig ( localize_pipeline_config *out );
+
+//! Compute Fcns
+//! starts stepping in with the threads of config
+//! returns -1 if the pace slot has no queue or a thread could not be started
+int StartLocalizePipeline ( localize_pipeline *out, localize *in, const localize_pipeline_config *config );
+//! stops after the step under way and the outputs queued, and hands the localize back
+int StopLocalizePipeline ( localize_pipeline *in );
+
+//! Get/Set Fcns
+//! the counts up to now, from any thread, or of the whole run once stopped
+int GetLocalizePipelineReport ( localize_pipeline *in, localize_pipeline_report *out );
+
+#endif  //! define LOCALIZE_PIPELINE_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
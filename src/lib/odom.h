@@ -1,6 +1,7 @@
 // scripted sensor type odom
 /* $Id: odom.h,v 1.5 2005/06/10 15:10:59 dave Exp $ */
-sensor odom = 
+// read only template, each localize runs a copy made by CloneSensor
+const sensor odom_template = 
 {
 	// pt_sec
 	0,
@@ -47,5 +48,14 @@ sensor odom =
 	OdomGenerateVelMatrix,
 	// update from data
 	OdomUpdateSensor,
+	// CONFIGURATION
+	// filter update formulation
+	KFILTER_UPDATE_BATCH,
+	// filter covariance formulation
+	KFILTER_COVARIANCE_GENERAL,
+	// transducers behind the state vector
+	{ FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER },
+	// transducers behind the velocity matrix
+	{ 3, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER, FUSION_NO_TRANSDUCER },
 
 };
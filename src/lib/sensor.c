@@ -26,13 +26,90 @@ sensor * CreateSensor( void )
 }//! end CreateExample
 
 
+//! sensor types, shared by every sensor
+const sensor_types  sensor_list[50] = 
+{
+
+	{"gps"},							//! absolute 
+	{"odometer"},					//! relative
+	{"imu"}								//! relative
+	
+	 
+};
+
+
 //!-------------------------------------------------------
 //! Init Fcns
 //!-------------------------------------------------------
+int CloneSensor (const sensor *in, sensor *out)
+{
+	//! the scripted members of in - transducers, fcns, configuration
+	//! and maps - without any of its memory, clock or data
+	*out = *in;
+	
+	out->array 				= NULL;
+	out->measurement 	= NULL;
+	out->filtered 		= NULL;
+	out->filter 			= NULL;
+	out->arena 				= NULL;
+	out->arena_owned 	= 0;
+	out->clock 				= NULL;
+	out->updated 			= 0;
+	
+	return 0;
+}
+
+//! inits a sensor with the defined number of sensors
 int InitSensor (int num_transducers, sensor *out)
+{
+	void *arena;
+	
+	//! assign the number of transducers
+	if (num_transducers != -1 )
+	{
+		//!if not pre-assigned then update the number
+		out->transducers = num_transducers;
+	}
+	
+	//! one block for the transducers and the filter
+	if ( (out->transducers) <= 0 || posix_memalign( &arena, KFILTER_ALIGNMENT, SizeSensorArena( out->transducers ) ) != 0 )
+	{
+		return -1;
+	}
+	
+	InitSensorArena ( out->transducers, out, arena );
+	
+	//! freed again by DestroySensor
+	out->arena_owned = 1;
+	
+	return 0;
+}
+
+//! bytes of arena needed by a sensor of num_transducers
+size_t SizeSensorArena ( int num_transducers )
+{
+	if ( num_transducers <= 0 )
+	{
+		return 0;
+	}
+	
+	return KFILTER_ALIGN( sizeof( transducer_array ) )
+			 + KFILTER_ALIGN( SizeTransducerArray( num_transducers ) )
+			 + KFILTER_ALIGN( num_transducers * sizeof( double ) )
+			 + KFILTER_ALIGN( sizeof( k_filter ) )
+			 + SizeKFilterArena( num_transducers );
+}
+
+/*
+	InitSensorArena creates the transducers and the filter of the sensor
+	inside arena, a block of at least SizeSensorArena( num_transducers ) bytes
+	aligned to KFILTER_ALIGNMENT that the caller keeps ownership of.
+*/
+int InitSensorArena (int num_transducers, sensor *out, void *arena )
 {
 	//! inits a sensor with the defined number of sensors
-	int i,j;
+	int i;
+	char *region = (char *)arena;
 	
 	//! clear time and previous time
 	out->pt_sec 	= 0;
@@ -43,6 +120,7 @@ int InitSensor (int num_transducers, sensor *out)
 	
 	//! clear delta t
 	out->delta_time = 0.0;
+	out->stamp 		= 0.0;
 	
 	//! assign the number of transducers
 	if (num_transducers != -1 )
@@ -50,42 +128,27 @@ int InitSensor (int num_transducers, sensor *out)
 		//!if not pre-assigned then update the number
 		out->transducers = num_transducers;
 	}
-	//! create memory for each transducer pointer
-	//! assign memory for address of transducer
-	if ( (out->transducers) > 0 )//! so long as there are transducers set
-	{
-		out->array = (transducer **) malloc( num_transducers * sizeof( transducer *));		
-	}
-	else
+	if ( (out->transducers) <= 0 || arena == NULL )//! so long as there are transducers set
 	{
 		return -1;
 	}
+	num_transducers = out->transducers;
 	
-	//! create memory for each transducer
-	for (i = 0; i < num_transducers; i++ )
-	{
-		//! create transducer type		
-		out->array[i] = CreateTransducer();		
-	}
-	
-	//! zero all transducers
-	for (i = 0; i < num_transducers; i++ )
-	{
-		ZeroTransducer ( out->array[i] );	
-	}
+	out->arena = arena;
+	out->arena_owned = 0;
 	
-	//! create measurement array to point to measured values
-	out->measurement = ( double ** )malloc( num_transducers * sizeof( double * ));	
+	//! carve the arena: transducer arrays, filtered, filter
+	out->array = (transducer_array *) region;
+	region += KFILTER_ALIGN( sizeof( transducer_array ) );
+	InitTransducerArray ( num_transducers, out->array, region );
+	region += KFILTER_ALIGN( SizeTransducerArray( num_transducers ) );
+	out->filtered = ( double * ) region;
+	region += KFILTER_ALIGN( num_transducers * sizeof( double ) );
+	out->filter = (k_filter *) region;
+	region += KFILTER_ALIGN( sizeof( k_filter ) );
 	
 	//! aim measurements at transducer values
-	for (i = 0; i < num_transducers; i++ )
-	{
-		//! create a row for each sensor
-		out->measurement[i] = &(out->array[i]->value);		
-	}	
-	
-	//! create measurement array to point to measured values
-	out->filtered = ( double * )malloc( num_transducers * sizeof( double ));	
+	out->measurement = out->array->value;
 	
 	//! clear filtered 
 	for (i = 0; i < num_transducers; i++ )
@@ -102,12 +165,14 @@ int InitSensor (int num_transducers, sensor *out)
 	//!out->GenerateVelMatrix = NULL;
 	//!out->UpdateSensor = NULL;
 	
-	//!  create Kalman filter
-	out->filter = CreateKFilter();
-	
-	//! init filter with number of transducers
+	//! init filter with number of transducers in the rest of the arena
 	//! aim measurement and filtered
-	InitKFilter2 ( out->filter , num_transducers, *out->measurement, out->filtered  );
+	InitKFilterArena ( out->filter , num_transducers, region );
+	SetKFilterIO ( out->filter, out->measurement, out->filtered );
+	
+	//! select the update and covariance formulations scripted for this sensor
+	SetKFilterUpdateMode ( out->filter, out->filter_update );
+	SetKFilterCovarianceMode ( out->filter, out->filter_covariance );
 	
 	//! zero sensor
 	ZeroSensor ( out );
@@ -115,9 +180,58 @@ int InitSensor (int num_transducers, sensor *out)
 	return 0;
 }
 
+
+//!-------------------------------------------------------
+//! Destructors
+//!-------------------------------------------------------
+//! releases the filter and the arena if InitSensor allocated it
+//! a sensor from CreateSensor is then released with free
+int DestroySensor ( sensor *out )
+{
+	if ( out->arena == NULL )
+	{
+		// already destroyed
+		return -1;
+	}
+	
+	//! the k_filter itself lives in the arena
+	DestroyKFilter ( out->filter );
+	
+	if ( out->arena_owned )
+	{
+		free( out->arena );
+	}
+	
+	out->arena = NULL;
+	out->arena_owned = 0;
+	out->array = NULL;
+	out->measurement = NULL;
+	out->filtered = NULL;
+	out->filter = NULL;
+	out->updated = 0;
+	
+	return 0;
+}
+
+
 //!-------------------------------------------------------
 //! Zero Fcns
 //!-------------------------------------------------------
+//! returns an initialized sensor to its state after InitSensor without touching the heap
+int ResetSensor ( sensor *out )
+{
+	//! zero the data indicator
+	out->updated = 0;
+	
+	//! filter defaults and the scripted formulations
+	ResetKFilter ( out->filter );
+	SetKFilterUpdateMode ( out->filter, out->filter_update );
+	SetKFilterCovarianceMode ( out->filter, out->filter_covariance );
+	
+	//! zero sensor
+	return ZeroSensor ( out );
+}
+
 int ZeroSensor( sensor *out )
 {
 	int i,j;
@@ -132,12 +246,14 @@ int ZeroSensor( sensor *out )
 	
 	//! clear delta t
 	out->delta_time = 0.0;
+	out->stamp 		= 0.0;
 	
-	//! iterate through all transducers and zero elements
-	for (i = 0; i < (out->transducers); i++)
-	{
-		ZeroTransducer ( out->array[i] );		
-	}
+	//! zero the state vector and the velocities integrated into vm
+	km_ZeroStateVector ( &(out->sv) );
+	km_ZeroVelocityMatrix ( &(out->vm) );
+	
+	//! zero elements of all transducers
+	ZeroTransducerArray ( out->array );
 	
 		//! clear filtered 
 	for (i = 0; i < out->transducers; i++ )
@@ -150,7 +266,7 @@ int ZeroSensor( sensor *out )
 	for (i = 0; i < out->transducers; i++)
 	{
 		//! create a row for each sensor
-		*out->measurement[i] = 0.0;			
+		out->measurement[i] = 0.0;			
 
 	}	
 	
@@ -187,7 +303,7 @@ int ZeroMeasurement ( sensor *out )
 		for (i = 0; i < out->transducers; i++)
 		{
 			//! create a row for each sensor
-			*out->measurement[i] = 0.0;			
+			out->measurement[i] = 0.0;			
 
 		}
 	}
@@ -204,9 +320,9 @@ int ZeroMeasurement ( sensor *out )
 int SetSensorTransducer ( double svalue, double spredicted, double svariance, int snumber,  sensor * out)
 {
 	//! set values
-	out->array[snumber]->value 			= svalue;
-	out->array[snumber]->predicted 	= spredicted;
-	out->array[snumber]->variance 	= svariance;
+	out->array->value[snumber] 			= svalue;
+	out->array->predicted[snumber] 	= spredicted;
+	out->array->variance[snumber] 	= svariance;
 
 	return 0;
 }
@@ -217,11 +333,13 @@ int SetSensorTransducer ( double svalue, double spredicted, double svariance, in
 //!-------------------------------------------------------
 int UpdateSensorTransducerValue ( double svalue, int snumber, sensor * out)
 {
-	//! set value for sensed phenomena
-	out->array[snumber]->value = svalue;
-	
 	//! force update of state of transducer
-	UpdateTransducerValue(svalue, out->array[snumber] )	;
+	//! store old value in previous
+	out->array->previous[snumber] = out->array->value[snumber];
+	//! set value for sensed phenomena
+	out->array->value[snumber] = svalue;
+	//! increase population of values seen
+	out->array->population[snumber]++;
 	
 
 	return 0;
@@ -232,7 +350,8 @@ int UpdateSensorData( sensor * out, size_t size_data, void *data )
 	//! Updates the sensor with or without
 	//! data by either updating the transducer values or  
 	//! using the predicted values inserted into the value
-	int i;
+	//! each branch is a single sweep over the transducer arrays
+	//! besides the copy of the values that the new data overwrites
 	
 	//! if the size of data is not zero, then pass on data
 	if ( size_data > (size_t)0)
@@ -240,53 +359,24 @@ int UpdateSensorData( sensor * out, size_t size_data, void *data )
 		//! update the data within transducers
 		out->updated = 1; //! there is new data
 		//! update previous data in transducers with current value
-		for (i = 0; i < out->transducers; i++)
-		{
-			UpdateTransducerPrevious( out->array[i] );
-		}
+		UpdateTransducerArrayPrevious ( out->array );
 		//! Generic call to the pointer for fcn to update data 
 		out->UpdateSensor( size_data, data, out);
 		
-		//! compute innovation from prediction vs. value
-		for (i = 0; i < out->transducers; i++)
-		{
-			ComputeTransducerInnovation(  out->array[i] );
-		}	
-		//! compute prediction from prediction and value
-		for (i = 0; i < out->transducers; i++)
-		{
-			UpdateTransducerPredicted( 0.5, 0.5, out->array[i] );
-		}		
-		
+		//! compute innovation from prediction vs. value and
+		//! prediction from prediction and value
+		UpdateTransducerArrayMeasured ( 0.5, 0.5, out->array );
 	}
 	else //! no data
 	{
 		//! update with predicted values in the transducer data
 		out->updated = 0;//! indicate no new data
-		//! update previous data in transducers with current value
-		for (i = 0; i < out->transducers; i++)
-		{
-			UpdateTransducerPrevious( out->array[i] );
-		}
 		//! need to update time stamp
 		UpdateSensorTime2(out);
-		//! update data in transducers with predicted value
-		for (i = 0; i < out->transducers; i++)
-		{
-			UpdateTransducerValueWithPredicted(0.9, 0.1,  out->array[i] );
-		}
-
-		//! compute innovation from prediction vs. value
-		for (i = 0; i < out->transducers; i++)
-		{
-			ComputeTransducerInnovation(  out->array[i] );
-		}	
-		//! compute prediction from prediction and value
-		for (i = 0; i < out->transducers; i++)
-		{
-			UpdateTransducerPredicted( 0.5, 0.5, out->array[i] );
-		}			
-		
+		//! update previous data in transducers with current value,
+		//! data in transducers with predicted value, innovation from
+		//! prediction vs. value and prediction from prediction and value
+		UpdateTransducerArrayUnmeasured ( 0.9, 0.1, 0.5, 0.5, out->array );
 	}
 
 	return 0;	
@@ -295,7 +385,14 @@ int UpdateSensorData( sensor * out, size_t size_data, void *data )
 int UpdateSensorTransducerPredicted ( int snumber, sensor * out)
 {
 	//! force update of predicted value of transducer	
-	UpdateTransducerPredicted(0.5, 0.5, (transducer *)out->array[snumber] );
+	if ( out->array->population[snumber] )// if there is more than zero data measurements
+	{
+		out->array->predicted[snumber] = 0.5*(out->array->predicted[snumber]) + 0.5*(out->array->value[snumber]);
+	}
+	else// else first measurement then simply assign
+	{
+		out->array->predicted[snumber] = out->array->value[snumber];
+	}
 
 	return 0;
 }
@@ -304,18 +401,9 @@ int UpdateSensorPredicted ( sensor * out)
 {
 	//! performs an update to all attached transducers
 	//! of their predicted values
-	int i;
 	
-	//! iterate through all transducers and update predicted values
-	for (i = 0; i < out->transducers; i++)
-	{
-		//! iterate through attached transducers
-		UpdateSensorTransducerPredicted ( i, out );
-	}
-	
-	
-	
-	return 0;
+	//! one sweep through all transducers to update predicted values
+	return UpdateTransducerArrayPredicted ( 0.5, 0.5, out->array );
 }
 
 int UpdateSensorTime (sensor *out, unsigned long time_sec, unsigned long time_usec)
@@ -331,6 +419,8 @@ int UpdateSensorTime (sensor *out, unsigned long time_sec, unsigned long time_us
 	
 	//! compute delta time step adding microseconds to seconds
 	out->delta_time  = ((double)out->t_sec - (double)out->pt_sec ) + (MICROSECOND_CONVERSION)*((double)out->t_usec - (double)out->pt_usec);
+	//! measured now
+	out->stamp = (double)out->t_sec + (MICROSECOND_CONVERSION)*(double)out->t_usec;
 	
 
 	return 0;
@@ -340,24 +430,29 @@ int UpdateSensorTime (sensor *out, unsigned long time_sec, unsigned long time_us
 //! The IDLs do not all have timestamps, nor do some of the sensors
 //! and so I will use the computer time for the moment to make realistic 
 //! if not completely accurate computations.
+//! The time now comes from the sensor clock, the computer time unless
+//! the clock follows the packets - see sensor_clock.h
 int UpdateSensorTime2 (sensor *out )
 {
-	//! get time from computer and substitute it into the current time stamp
+	//! get time from the clock and substitute it into the current time stamp
 	//! and then compute the latest delta time for computation.
-	struct timeval   computer_time;
-	
-	gettimeofday( &computer_time, 0 );//! timezone not implemented under linux, needs to be zero
 	
 	//! update the time data from sequential measurements
 	(out->pt_sec) 	= (out->t_sec);
 	(out->pt_usec) 	= (out->t_usec);
 	
-	//! update new time from computer
-	out->t_sec			= ( unsigned long )computer_time.tv_sec;
-	out->t_usec 		= ( unsigned long )computer_time.tv_usec;
+	//! update new time from the clock
+	GetSensorClockTime ( out->clock, &(out->t_sec), &(out->t_usec) );
 	
 	//! compute delta time step adding microseconds to seconds
 	out->delta_time  = ((double)out->t_sec - (double)out->pt_sec ) + (MICROSECOND_CONVERSION)*((double)out->t_usec - (double)out->pt_usec);
+	if ( out->pt_sec == 0 && out->pt_usec == 0 )
+	{
+		//! no previous time, a packet clock before its first packet
+		out->delta_time = 0.0;
+	}
+	//! measured now
+	out->stamp = (double)out->t_sec + (MICROSECOND_CONVERSION)*(double)out->t_usec;
 	//printf("%e \n", out->delta_time );	
 
 	return 0;
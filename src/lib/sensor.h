@@ -25,6 +25,8 @@
 #endif //localizeMATH_H
 
 #include "filter.h"
+#include "fusion.h"			//! FUSION_NO_TRANSDUCER for the transducer maps
+#include "sensor_clock.h"	//! time source of UpdateSensorTime2
 
 
 
@@ -64,15 +66,8 @@ typedef struct
 
 //! a data structure to cover the types of data and the 
 //! resultant variation in the handling of updates and computation
-static sensor_types  sensor_list[50] = 
-{
-
-	{"gps"},							//! absolute 
-	{"odometer"},					//! relative
-	{"imu"}								//! relative
-	
-	 
-};
+//! read only and shared, defined in sensor.c
+extern const sensor_types  sensor_list[50];
 
 /*! 
 	Sensor data struct - the basis of the localizer data device:
@@ -101,10 +96,10 @@ typedef struct
 	int		transducers;			
 	//! positive indicates that the sensor received new data				
 	int		updated;			
-	//! array of the sensors				
-	transducer ** array;			
-	//! measurements of the transducers			
-	double		 ** measurement;
+	//! data of the transducers as a struct of arrays				
+	transducer_array * array;			
+	//! measurements of the transducers, contiguous - array->value			
+	double		 * measurement;
 	//! filtered values post filtering
 	double     * filtered;
 	//! Kalman filter for tranducer array
@@ -140,6 +135,29 @@ typedef struct
 	//! *in points to a data packet of unknown type 
 	//! *out points to	the sensor matching data packet																													
 	//!
+	
+	//! CONFIGURATION
+	
+	//! measurement update formulation KFILTER_UPDATE_* set up by InitSensor
+	int filter_update;
+	//! covariance update formulation KFILTER_COVARIANCE_* set up by InitSensor
+	int filter_covariance;
+	//! transducer behind each element of sv, loc x y z then orient s x y z,
+	//! FUSION_NO_TRANSDUCER where the sensor supplies nothing - see fusion.h
+	int sv_transducer[STATE_ARRAY];
+	//! transducer behind each element of vm, FUSION_NO_TRANSDUCER where none
+	int vm_transducer[VEL_ARRAY];
+	
+	//! block holding the transducers and the filter, see SizeSensorArena
+	void *arena;
+	//! nonzero when InitSensor allocated the arena and DestroySensor frees it
+	int arena_owned;
+	//! time the data was measured, seconds since the epoch - the time of
+	//! the update unless the UpdateSensor fcn knows better
+	double stamp;
+	//! clock of UpdateSensorTime2, shared with the other sensors of a
+	//! localize, the wall clock when NULL - see sensor_clock.h
+	sensor_clock *clock;
 } sensor;
 
 
@@ -150,11 +168,16 @@ sensor * CreateSensor( void );	//! creates and returns dynamic memory
 
 //! Init Fcns
 int InitSensor(int num_transducers, sensor *out);//! inits a sensor with the defined number of sensors
+int InitSensorArena(int num_transducers, sensor *out, void *arena);//! as InitSensor within a caller owned arena
+int CloneSensor(const sensor *in, sensor *out);//! copies the scripted members of a template such as gps_template, for InitSensor
+size_t SizeSensorArena(int num_transducers);//! bytes of arena needed by InitSensorArena
 
 //! Destructors
+int DestroySensor ( sensor *out );		//! releases what the Init fcns allocated
 
 //! Zero Fcns - zero the elements
 int ZeroSensor ( sensor *out );				//! zero all elements
+int ResetSensor ( sensor *out );			//! back to the initialized state without touching the heap
 int ZeroMeasurement ( sensor *out );	//! zeros values in transducers
 
 //! Get/Set Functions - resets specific values into the data struct
@@ -166,7 +189,7 @@ int UpdateSensorData ( sensor * in, size_t size_data, void *data ); //! updates
 int UpdateSensorPredicted ( sensor * out);  //! iterates above fcn to handle entire transducer array
 
 int UpdateSensorTime (sensor *out, unsigned long time_sec, unsigned long time_usec);//! update time elements from data
-int	UpdateSensorTime2(sensor *out);//! use computer time to update the timestamp
+int	UpdateSensorTime2(sensor *out);//! use the sensor clock to update the timestamp
 //! Compute Fcns
 
 
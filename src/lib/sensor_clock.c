@@ -0,0 +1,102 @@
+//! sensor_clock.c
+//!
+//! sensor clock Functions
+/* $Id$ */
+
+
+/*
+
+	This c file reads the time of a sensor_clock from the system clocks or
+	from the packets handed to it.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "sensor_clock.h"
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+int InitSensorClock ( sensor_clock *out, int source )
+{
+	//! sets the source, with the packet clock at zero
+	if ( source != SENSOR_CLOCK_WALL && source != SENSOR_CLOCK_MONOTONIC 
+		&& source != SENSOR_CLOCK_PACKET )
+	{
+		//! no such source
+		return -1;
+	}
+	out->source = source;
+	out->t_sec 	= 0;
+	out->t_usec = 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Fcns
+//!-------------------------------------------------------
+int GetSensorClockTime ( sensor_clock *in, unsigned long *time_sec, unsigned long *time_usec )
+{
+	struct timeval   computer_time;
+	struct timespec  monotonic_time;
+
+	if ( in != NULL && in->source == SENSOR_CLOCK_PACKET )
+	{
+		//! time of the latest packet
+		*time_sec 	= in->t_sec;
+		*time_usec 	= in->t_usec;
+		return 0;
+	}
+	if ( in != NULL && in->source == SENSOR_CLOCK_MONOTONIC )
+	{
+		if ( clock_gettime( CLOCK_MONOTONIC, &monotonic_time ) != 0 )
+		{
+			return -1;
+		}
+		*time_sec 	= ( unsigned long )monotonic_time.tv_sec;
+		*time_usec 	= ( unsigned long )( monotonic_time.tv_nsec/1000 );
+		return 0;
+	}
+
+	gettimeofday( &computer_time, 0 );//! timezone not implemented under linux, needs to be zero
+	*time_sec 	= ( unsigned long )computer_time.tv_sec;
+	*time_usec 	= ( unsigned long )computer_time.tv_usec;
+
+	return 0;
+}
+
+int SetSensorClockPacket ( sensor_clock *out, long time_sec, long time_usec )
+{
+	//! moves the packet clock forward to the packet time
+	if ( out == NULL || out->source != SENSOR_CLOCK_PACKET )
+	{
+		return 0;
+	}
+	if ( time_sec < 0 || time_usec < 0 || time_usec >= 1000000 )
+	{
+		//! not a time
+		return -1;
+	}
+	if ( ( unsigned long )time_sec < out->t_sec 
+		|| ( ( unsigned long )time_sec == out->t_sec && ( unsigned long )time_usec < out->t_usec ) )
+	{
+		//! an older packet, the clock does not run backwards
+		return 0;
+	}
+	out->t_sec 	= ( unsigned long )time_sec;
+	out->t_usec = ( unsigned long )time_usec;
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,78 @@
+//! sensor_clock.h
+//! sensor clock Header File
+//! the time source behind every sensor and localize time stamp
+/*! $Id$ */
+
+/*
+
+	UpdateSensorTime2 and UpdateLocalizeTime2 stamp each update with the
+	time of a sensor_clock, and every delta_time is the difference of two
+	such stamps.  The source of the clock is one of
+
+		SENSOR_CLOCK_WALL		gettimeofday, the time since the epoch
+		SENSOR_CLOCK_MONOTONIC	clock_gettime CLOCK_MONOTONIC, which no
+								setting of the system time moves
+		SENSOR_CLOCK_PACKET		the time of the latest data packet
+
+	The packet clock only moves when the UpdateSensor fcns hand it the
+	time_sec and time_usec of a packet, or the caller sets it, so a log
+	replayed at any speed gives the same delta_time, and the same results,
+	as it did when recorded.  It never runs backwards: an older packet
+	leaves it where it is.  Packets without a time, the odometry, take the
+	time of the last packet that had one.
+
+	A sensor without a clock uses the wall clock, as before.
+
+*/
+
+//! Includes
+#include <sys/time.h>			//! for gettimeofday fcn
+#include <time.h>				//! for clock_gettime fcn
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SENSOR_CLOCK_H
+#define SENSOR_CLOCK_H
+
+
+//! Defines
+
+//! sources of a sensor_clock
+#define SENSOR_CLOCK_WALL				0
+#define SENSOR_CLOCK_MONOTONIC		1
+#define SENSOR_CLOCK_PACKET			2
+
+
+//! Data structs
+
+//! data struct clock shared by the sensors of a localize
+typedef struct
+{
+	//! SENSOR_CLOCK_*
+	int source;
+	//! time of the packet clock, zero until the first packet
+	unsigned long t_sec;
+	unsigned long t_usec;
+
+} sensor_clock;
+
+
+//! Functions
+
+//! Init Fcns
+//! a clock of source, the packet clock at zero
+int InitSensorClock ( sensor_clock *out, int source );
+
+//! Get/Set Functions
+//! the current time of in, the wall clock when in is NULL
+int GetSensorClockTime ( sensor_clock *in, unsigned long *time_sec, unsigned long *time_usec );
+//! advances the packet clock to the time of a packet, ignored by the other sources
+int SetSensorClockPacket ( sensor_clock *out, long time_sec, long time_usec );
+
+#endif  //! define SENSOR_CLOCK_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
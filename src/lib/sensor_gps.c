@@ -11,6 +11,9 @@ extern "C" {
 
 #include "sensor_gps.h"
 
+// the scripted sensor template
+#include "gps.h"
+
 
 //-------------------------------------------------------
 // CONSTRUCTORS
@@ -68,9 +71,9 @@ int GPSGenerateStateVector( void *in, state_vector *out)
 	ComputeKFilter( ptr->filter );
 	
 	// simply transfer the values for UTM and altitude over
-	out->loc.x = ptr->array[3]->value; // utm easting
-	out->loc.y = ptr->array[4]->value; // utm northing
-	out->loc.z = ptr->array[2]->value; // altitude from MSL
+	out->loc.x = ptr->array->value[3]; // utm easting
+	out->loc.y = ptr->array->value[4]; // utm northing
+	out->loc.z = ptr->array->value[2]; // altitude from MSL
 	
 	// updated for filtering, use the filtered values
 	// as the output to state vector and velocity matrix
@@ -78,8 +81,6 @@ int GPSGenerateStateVector( void *in, state_vector *out)
 	//out->loc.y = ptr->filtered[4]; // utm northing
 	//out->loc.z = ptr->filtered[2]; // altitude from MSL	
 	
-//	printf("%e %e %e\n", ptr->filtered[3], ptr->filtered[4], ptr->filtered[2]  );
-	
 	// future: compute quaternions from heading - now: leave zero
 	out->orient.s = 0.0;
 	out->orient.x = 0.0;
@@ -137,32 +138,34 @@ int	GPSUpdateSensor( size_t  size_data, void *in, void *out)
 		
 		//update time from computer for now
 		//UpdateSensorTime (ptr_output, (unsigned long)(ptr->time_sec), (unsigned long)(ptr->time_usec) );  
+		// a packet clock moves to the time of the fix
+		SetSensorClockPacket ( ptr_output->clock, ptr->time_sec, ptr->time_usec );
 		UpdateSensorTime2 ( ptr_output );
+		// the fix was taken its latency before it arrived, on the 
+		// computer clock of every other stamp
+		if ( ptr->latency > 0.0 )
+		{
+			ptr_output->stamp -= (double)ptr->latency;
+		}
 		
 		// assign values to sensor transducers
-		ptr_output->array[0]->value = ptr->latitude;
-		ptr_output->array[1]->value = ptr->longitude;
-		ptr_output->array[2]->value = ptr->altitude;
-		//printf("%e %e %e\n", ptr->latitude, ptr->longitude, ptr->altitude  );	
+		ptr_output->array->value[0] = ptr->latitude;
+		ptr_output->array->value[1] = ptr->longitude;
+		ptr_output->array->value[2] = ptr->altitude;
 			
 		// using LatLong-UTMconversion.h	Conversion routines to compute UTM Eastings and Northings
 		// convert longitude into UTM Easting
 		// void LLtoUTM(int ReferenceEllipsoid, const double Lat, const double Long, double *UTMNorthing, double *UTMEasting, char* UTMZone);
 		LLtoUTM( 23, (const double) (ptr->latitude), (const double)(ptr->longitude), &(convert_UTM_N), &(convert_UTM_E), (ptr_output->gen_string));
-		ptr_output->array[3]->value = convert_UTM_E;
-		ptr_output->array[4]->value = convert_UTM_N;
-		ptr_output->array[5]->value = ptr->hdop;
-		
-		//printf("%e %e %e\n", ptr_output->array[3]->value, ptr_output->array[4]->value,ptr_output->array[5]->value );	
-	
-		// debugging conversion
-		printf("gps utm_e:%f gps utm_n:%f | converted utm_e:%f converted utm_n:%f\n", ptr->utm_e, ptr->utm_n, convert_UTM_E, convert_UTM_N  );
+		ptr_output->array->value[3] = convert_UTM_E;
+		ptr_output->array->value[4] = convert_UTM_N;
+		ptr_output->array->value[5] = ptr->hdop;
 		
 		// increase population of data
 		for (i = 0; i < ptr_output->transducers; i++)  
 		{
 			// increase the populations
-			ptr_output->array[i]->population++;
+			ptr_output->array->population[i]++;
 		}
 		
 	}
@@ -131,6 +131,9 @@ int GPSGenerateVelMatrix( void *in, vel_matrix * out);
 // GPS update fcn for data received					
 int	GPSUpdateSensor( size_t  size_data, void *in, void *out);
 
+// scripted gps sensor of gps.h, read only - copied by CloneSensor
+extern const sensor gps_template;
+
 
 
 
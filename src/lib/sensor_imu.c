@@ -10,6 +10,9 @@ extern "C" {
 
 #include "sensor_imu.h"
 
+// the scripted sensor template
+#include "imu.h"
+
 
 /*
 		transducer values 16
@@ -84,10 +87,10 @@ int ImuGenerateStateVector( void *in, state_vector *out)
 	out->loc.z = 0.0; // altitude from MSL
 	
 	// original:  use given values
-	out->orient.s = ptr->array[0]->value;// quaternion[0]
-	out->orient.x = ptr->array[1]->value;// quaternion[1]
-	out->orient.y = ptr->array[2]->value;// quaternion[2]
-	out->orient.z = ptr->array[3]->value;// quaternion[3]
+	out->orient.s = ptr->array->value[0];// quaternion[0]
+	out->orient.x = ptr->array->value[1];// quaternion[1]
+	out->orient.y = ptr->array->value[2];// quaternion[2]
+	out->orient.z = ptr->array->value[3];// quaternion[3]
 	
 	// current: use filtered values
 
@@ -114,14 +117,12 @@ int ImuGenerateVelMatrix( void *in, vel_matrix * out)
 	ptr_dbl = (double *)(out->vel); // point at out	
 	
 	// compute x velocity component from acceleration Ax
-	//IntegrateAcceleration (ptr->array[7]->value, ptr->delta_time, (ptr_dbl) );
+	//IntegrateAcceleration (ptr->array->value[7], ptr->delta_time, (ptr_dbl) );
 	//out->vel[0] = (out->vel[0]) + (ptr->filtered[7])*ptr->delta_time;
-	out->vel[0] = out->vel[0] + (ptr->array[7]->value)*(ptr->delta_time);
-	printf("delta_time:%e  \n", ptr->delta_time );
-	//printf("Vx:%e  filtered:%e delta_time:%e  \n",out->vel[0], ptr->filtered[7], ptr->delta_time );
+	out->vel[0] = out->vel[0] + (ptr->array->value[7])*(ptr->delta_time);
 	//ptr_dbl++;
 	// compute y velocity component from acceleration Ay
-	//IntegrateAcceleration (ptr->array[8]->value, ptr->delta_time,  (ptr_dbl) );
+	//IntegrateAcceleration (ptr->array->value[8], ptr->delta_time,  (ptr_dbl) );
 	// fix IntegrateAcceleration
 	out->vel[1] = (out->vel[1]) + (ptr->filtered[8])*(ptr->delta_time);
 			
@@ -158,32 +159,34 @@ int	ImuUpdateSensor( size_t  size_data, void *in, void *out)
 		
 		//update time from computer for now
 		//UpdateSensorTime (ptr_output, (unsigned long)(ptr->time_sec), (unsigned long)(ptr->time_usec) );  
+		// a packet clock moves to the time of the sample
+		SetSensorClockPacket ( ptr_output->clock, ptr->time.sec, ptr->time.usec );
 		UpdateSensorTime2 ( ptr_output );
 				
 		// assign values to sensor transducers
-		ptr_output->array[0]->value = ptr->quaternion[0];
-		ptr_output->array[1]->value = ptr->quaternion[1];
-		ptr_output->array[2]->value = ptr->quaternion[2];
-		ptr_output->array[3]->value = ptr->quaternion[3];
-		ptr_output->array[4]->value = ptr->magfield[0];
-		ptr_output->array[5]->value = ptr->magfield[1];
-		ptr_output->array[6]->value = ptr->magfield[2];		
-		ptr_output->array[7]->value = ptr->accel[0];
-		ptr_output->array[8]->value = ptr->accel[1];
-		ptr_output->array[9]->value = ptr->accel[2];
-		ptr_output->array[10]->value = ptr->angrate[0];
-		ptr_output->array[11]->value = ptr->angrate[1];
-		ptr_output->array[12]->value = ptr->angrate[2];										
-		ptr_output->array[13]->value = ptr->angle[0];
-		ptr_output->array[14]->value = ptr->angle[1];
-		ptr_output->array[15]->value = ptr->angle[2];
+		ptr_output->array->value[0] = ptr->quaternion[0];
+		ptr_output->array->value[1] = ptr->quaternion[1];
+		ptr_output->array->value[2] = ptr->quaternion[2];
+		ptr_output->array->value[3] = ptr->quaternion[3];
+		ptr_output->array->value[4] = ptr->magfield[0];
+		ptr_output->array->value[5] = ptr->magfield[1];
+		ptr_output->array->value[6] = ptr->magfield[2];		
+		ptr_output->array->value[7] = ptr->accel[0];
+		ptr_output->array->value[8] = ptr->accel[1];
+		ptr_output->array->value[9] = ptr->accel[2];
+		ptr_output->array->value[10] = ptr->angrate[0];
+		ptr_output->array->value[11] = ptr->angrate[1];
+		ptr_output->array->value[12] = ptr->angrate[2];										
+		ptr_output->array->value[13] = ptr->angle[0];
+		ptr_output->array->value[14] = ptr->angle[1];
+		ptr_output->array->value[15] = ptr->angle[2];
 						
 
 		// increase population of data
 		for (i = 0; i < ptr_output->transducers; i++)  
 		{
 			// increase the populations
-			ptr_output->array[i]->population++;
+			ptr_output->array->population[i]++;
 		}
 		
 	}
@@ -195,6 +198,164 @@ int	ImuUpdateSensor( size_t  size_data, void *in, void *out)
 	return 0;
 }
 
+//-------------------------------------------------------
+// Preintegration Fcns
+//-------------------------------------------------------
+// a x b added to out scaled by w
+static void ImuCrossAdd( const double *a, const double *b, double w, double *out )
+{
+	out[0] += w*( a[1]*b[2] - a[2]*b[1] );
+	out[1] += w*( a[2]*b[0] - a[0]*b[2] );
+	out[2] += w*( a[0]*b[1] - a[1]*b[0] );
+}
+
+// clears the increment and the running sums
+static void ZeroImuIncrement( imu_preintegrator *out )
+{
+	int i;
+	
+	for (i = 0; i < 3; i++)
+	{
+		out->increment.delta_angle[i] 		= 0.0;
+		out->increment.delta_velocity[i] 	= 0.0;
+		out->alpha[i] 				= 0.0;
+		out->nu[i] 						= 0.0;
+		out->beta[i] 					= 0.0;
+		out->scul[i] 					= 0.0;
+		out->prev_angle[i] 		= 0.0;
+		out->prev_velocity[i] = 0.0;
+	}
+	out->increment.delta_time = 0.0;
+	out->increment.samples 		= 0;
+}
+
+int InitImuPreintegrator( imu_preintegrator *out, double update_period )
+{
+	// empty ring and increment
+	if ( update_period < 0.0 )
+	{
+		return -1;
+	}
+	out->update_period = update_period;
+	
+	out->ring.head 		= 0;
+	out->ring.tail 		= 0;
+	out->ring.dropped = 0;
+	ZeroImuIncrement ( out );
+	
+	return 0;
+}
+
+int PushImuSample( imu_preintegrator *out, const double *accel, const double *angrate, double delta_time )
+{
+	// producer side - only the producer writes head, and the release
+	// store publishes the sample before the consumer can see it
+	imu_sample *slot;
+	unsigned long head, tail;
+	int i;
+	
+	head = out->ring.head;
+	tail = __atomic_load_n( &(out->ring.tail), __ATOMIC_ACQUIRE );
+	if ( head - tail >= IMU_RING_SAMPLES )
+	{
+		// full, the consumer has fallen behind
+		__atomic_fetch_add( &(out->ring.dropped), 1, __ATOMIC_RELAXED );
+		return -1;
+	}
+	
+	slot = &(out->ring.sample[ head & (IMU_RING_SAMPLES - 1) ]);
+	for (i = 0; i < 3; i++)
+	{
+		slot->accel[i] 		= accel[i];
+		slot->angrate[i] 	= angrate[i];
+	}
+	slot->delta_time = delta_time;
+	
+	__atomic_store_n( &(out->ring.head), head + 1, __ATOMIC_RELEASE );
+	
+	return 0;
+}
+
+int ComputeImuPreintegration( imu_preintegrator *in )
+{
+	// consumer side - folds every published sample into the increment
+	// with the coning and sculling terms, then frees the slots at once
+	imu_sample *slot;
+	double da[3], dv[3];
+	unsigned long head, tail;
+	int i;
+	
+	head = __atomic_load_n( &(in->ring.head), __ATOMIC_ACQUIRE );
+	tail = in->ring.tail;
+	
+	for ( ; tail != head; tail++)
+	{
+		slot = &(in->ring.sample[ tail & (IMU_RING_SAMPLES - 1) ]);
+		for (i = 0; i < 3; i++)
+		{
+			da[i] = slot->angrate[i]*slot->delta_time;
+			dv[i] = slot->accel[i]*slot->delta_time;
+		}
+		
+		// coning, against the angle before this sample
+		ImuCrossAdd ( in->alpha, da, 0.5, in->beta );
+		ImuCrossAdd ( in->prev_angle, da, 1.0/12.0, in->beta );
+		// sculling, against the sums before this sample
+		ImuCrossAdd ( in->alpha, dv, 0.5, in->scul );
+		ImuCrossAdd ( in->nu, da, 0.5, in->scul );
+		ImuCrossAdd ( in->prev_angle, dv, 1.0/12.0, in->scul );
+		ImuCrossAdd ( in->prev_velocity, da, 1.0/12.0, in->scul );
+		
+		for (i = 0; i < 3; i++)
+		{
+			in->alpha[i] 					+= da[i];
+			in->nu[i] 						+= dv[i];
+			in->prev_angle[i] 		= da[i];
+			in->prev_velocity[i] 	= dv[i];
+		}
+		in->increment.delta_time += slot->delta_time;
+		in->increment.samples++;
+	}
+	__atomic_store_n( &(in->ring.tail), tail, __ATOMIC_RELEASE );
+	
+	// increment of the samples so far, rotation compensated
+	for (i = 0; i < 3; i++)
+	{
+		in->increment.delta_angle[i] 		= in->alpha[i] + in->beta[i];
+		in->increment.delta_velocity[i] = in->nu[i] + in->scul[i];
+	}
+	ImuCrossAdd ( in->alpha, in->nu, 0.5, in->increment.delta_velocity );
+	
+	return ( in->increment.samples > 0 && in->increment.delta_time >= in->update_period ) ? 1 : 0;
+}
+
+int GetImuIncrement( imu_preintegrator *in, imu_increment *out )
+{
+	// hands over the increment and starts the next one
+	*out = in->increment;
+	ZeroImuIncrement ( in );
+	
+	return ( out->samples > 0 ) ? 0 : -1;
+}
+
+int ImuIncrementVelMatrix( imu_increment *in, vel_matrix *out )
+{
+	// integrates the velocity change and takes the mean rates
+	int i;
+	
+	if ( in->samples == 0 || in->delta_time <= 0.0 )
+	{
+		return -1;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		out->vel[i] 		+= in->delta_velocity[i];
+		out->vel[i + 3] = in->delta_angle[i]/in->delta_time;
+	}
+	
+	return 0;
+}
+
 
 #ifdef __cplusplus
 } /* matches extern "C" for C++ */
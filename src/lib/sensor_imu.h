@@ -105,6 +105,98 @@ typedef struct
 }ImuIDL;
 
 
+/*
+	IMU preintegration
+
+	The IMU samples far faster than the filters need to run.  A producer,
+	typically the thread reading the IMU, pushes every sample into a single
+	producer single consumer ring with PushImuSample, which takes no lock.
+	The consumer drains the ring with ComputeImuPreintegration into one
+	increment over the update period:
+
+		delta_angle		rotation vector of the interval, with coning
+		delta_velocity	specific force integrated in the body frame at the
+						start of the interval, with rotation and sculling
+
+	using the two sample forms, with da and dv the angle and velocity
+	increments of one sample and alpha, nu their running sums:
+
+		beta	+= 1/2 alpha x da + 1/12 da_prev x da
+		scul	+= 1/2 ( alpha x dv + nu x da ) + 1/12 ( da_prev x dv + dv_prev x da )
+
+		delta_angle		= alpha + beta
+		delta_velocity	= nu + 1/2 alpha x nu + scul
+
+	so the motion between updates is kept while the filters step once per
+	increment instead of once per sample.
+*/
+
+//! samples held by the ring, a power of two
+#define IMU_RING_SAMPLES		1024
+//! bytes between the producer and consumer indices, one cache line
+#define IMU_RING_LINE				64
+
+//! one IMU sample as the producer pushes it
+typedef struct
+{
+	//! specific force in the body frame
+	double accel[3];
+	//! rate of rotation in the body frame
+	double angrate[3];
+	//! seconds since the previous sample
+	double delta_time;
+	
+}imu_sample;
+
+//! single producer single consumer ring of samples
+typedef struct
+{
+	//! next sample the producer writes, and the samples it dropped because
+	//! the ring was full, written only by the producer
+	unsigned long head __attribute__((aligned(IMU_RING_LINE)));
+	unsigned long dropped;
+	//! next sample the consumer reads, written only by the consumer
+	unsigned long tail __attribute__((aligned(IMU_RING_LINE)));
+	
+	imu_sample sample[IMU_RING_SAMPLES] __attribute__((aligned(IMU_RING_LINE)));
+	
+}imu_ring;
+
+//! preintegrated motion over an interval
+typedef struct
+{
+	//! rotation vector from the body at the start to the body at the end
+	double delta_angle[3];
+	//! velocity change in the body frame at the start, gravity not removed
+	double delta_velocity[3];
+	//! length of the interval in seconds
+	double delta_time;
+	//! samples in the interval
+	int samples;
+	
+}imu_increment;
+
+//! ring and the increment being accumulated from it
+typedef struct
+{
+	imu_ring ring;
+	//! increment of the samples drained so far
+	imu_increment increment;
+	//! interval in seconds between updates of the filters, 0 while not preintegrating
+	double update_period;
+	
+	//! running sums alpha and nu and the coning and sculling terms beta and scul
+	double alpha[3];
+	double nu[3];
+	double beta[3];
+	double scul[3];
+	//! angle and velocity increments of the previous sample
+	double prev_angle[3];
+	double prev_velocity[3];
+	
+}imu_preintegrator;
+
+
 
 
 // FCN Declarations 
@@ -117,6 +209,21 @@ int ImuGenerateVelMatrix( void *in, vel_matrix * out);
 // imu update fcn for data received					
 int	ImuUpdateSensor( size_t  size_data, void *in, void *out);
 
+// scripted imu sensor of imu.h, read only - copied by CloneSensor
+extern const sensor imu_template;
+
+// imu preintegration fcns
+// empty ring and increment, filters updated every update_period seconds
+int InitImuPreintegrator( imu_preintegrator *out, double update_period );
+// producer: pushes one sample without locking, -1 and counted as dropped if the ring is full
+int PushImuSample( imu_preintegrator *out, const double *accel, const double *angrate, double delta_time );
+// consumer: drains the ring into the increment, 1 once it spans update_period, else 0
+int ComputeImuPreintegration( imu_preintegrator *in );
+// consumer: hands over the increment and starts the next one
+int GetImuIncrement( imu_preintegrator *in, imu_increment *out );
+// adds an increment to a velocity matrix as ImuGenerateVelMatrix does a sample
+int ImuIncrementVelMatrix( imu_increment *in, vel_matrix *out );
+
 
 
 	
@@ -0,0 +1,402 @@
+//! sensor_log.c
+//!
+//! sensor log Functions
+/* $Id$ */
+
+
+/*
+
+	This c file writes sensor logs through stdio and reads them back from
+	a read only mapping, handing out pointers into it.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>			// realloc free
+#include <string.h>			// memcpy memcmp memset
+#include <fcntl.h>			// open
+#include <unistd.h>			// close
+#include <sys/mman.h>		// mmap madvise munmap
+#include <sys/stat.h>		// fstat
+
+#include "sensor_log.h"
+
+
+//! bytes of a packet of size with its padding
+#define SENSOR_LOG_PADDED(size)		(((uint64_t)(size) + SENSOR_LOG_ALIGNMENT - 1) & ~(uint64_t)(SENSOR_LOG_ALIGNMENT - 1))
+
+
+//!-------------------------------------------------------
+//! Header Fcns
+//!-------------------------------------------------------
+//! the header of a log of this machine
+static void SensorLogHeader( sensor_log_header *out )
+{
+	memset ( out, 0, sizeof( sensor_log_header ) );
+	memcpy ( out->magic, SENSOR_LOG_MAGIC, sizeof( out->magic ) );
+	out->byte_order 				= SENSOR_LOG_BYTE_ORDER;
+	out->version 						= SENSOR_LOG_VERSION;
+	out->header_size 				= sizeof( sensor_log_header );
+	out->record_header_size = sizeof( sensor_log_record_header );
+	out->sensors 						= SENSOR_LOG_SENSORS;
+	out->packet_size[GPS_SENSOR] 	= sizeof( GpsIDL );
+	out->packet_size[IMU_SENSOR] 	= sizeof( ImuIDL );
+	out->packet_size[ODOM_SENSOR] = sizeof( WheelDataIDL );
+}
+
+
+//!-------------------------------------------------------
+//! Writer Fcns
+//!-------------------------------------------------------
+int OpenSensorLogWriter ( sensor_log_writer *out, const char *path )
+{
+	//! an empty log, the header is written again on close
+	out->file = fopen( path, "wb" );
+	if ( out->file == NULL )
+	{
+		return -1;
+	}
+	SensorLogHeader ( &(out->header) );
+	out->offset 				= sizeof( sensor_log_header );
+	out->index 					= NULL;
+	out->index_capacity = 0;
+
+	if ( fwrite( &(out->header), sizeof( sensor_log_header ), 1, out->file ) != 1 )
+	{
+		fclose( out->file );
+		out->file = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int WriteSensorLogRecord ( sensor_log_writer *out, int sensor, unsigned long time_sec, unsigned long time_usec, size_t size, const void *data )
+{
+	static const char padding[SENSOR_LOG_ALIGNMENT] = { 0 };
+	sensor_log_record_header record;
+	sensor_log_index *grown;
+	uint64_t capacity;
+	size_t pad;
+
+	if ( out->file == NULL || sensor < 0 || sensor >= (int)out->header.sensors || size > (size_t)UINT32_MAX )
+	{
+		return -1;
+	}
+
+	//! an index entry every SENSOR_LOG_INDEX_STRIDE records
+	if ( out->header.records % SENSOR_LOG_INDEX_STRIDE == 0 )
+	{
+		if ( out->header.index_entries == out->index_capacity )
+		{
+			capacity = ( out->index_capacity == 0 ) ? 64 : 2*out->index_capacity;
+			grown = (sensor_log_index *)realloc( out->index, capacity*sizeof( sensor_log_index ) );
+			if ( grown == NULL )
+			{
+				return -1;
+			}
+			out->index 					= grown;
+			out->index_capacity = capacity;
+		}
+		out->index[out->header.index_entries].t_sec 	= (uint32_t)time_sec;
+		out->index[out->header.index_entries].t_usec 	= (uint32_t)time_usec;
+		out->index[out->header.index_entries].offset 	= out->offset;
+		out->header.index_entries++;
+	}
+
+	record.t_sec 	= (uint32_t)time_sec;
+	record.t_usec = (uint32_t)time_usec;
+	record.sensor = (int32_t)sensor;
+	record.size 	= (uint32_t)size;
+	pad = (size_t)( SENSOR_LOG_PADDED( size ) - size );
+
+	if ( fwrite( &record, sizeof( record ), 1, out->file ) != 1
+		|| ( size > 0 && fwrite( data, size, 1, out->file ) != 1 )
+		|| ( pad > 0 && fwrite( padding, pad, 1, out->file ) != 1 ) )
+	{
+		return -1;
+	}
+	out->offset += sizeof( record ) + SENSOR_LOG_PADDED( size );
+	out->header.records++;
+
+	return 0;
+}
+
+int CloseSensorLogWriter ( sensor_log_writer *out )
+{
+	//! index after the records, then the header with the count and the index
+	int status = 0;
+
+	if ( out->file == NULL )
+	{
+		return -1;
+	}
+	out->header.index_offset = out->offset;
+	if ( out->header.index_entries > 0
+		&& fwrite( out->index, sizeof( sensor_log_index ), (size_t)out->header.index_entries, out->file ) != (size_t)out->header.index_entries )
+	{
+		status = -1;
+	}
+	if ( status == 0
+		&& ( fseek( out->file, 0L, SEEK_SET ) != 0
+			|| fwrite( &(out->header), sizeof( sensor_log_header ), 1, out->file ) != 1 ) )
+	{
+		status = -1;
+	}
+	if ( fclose( out->file ) != 0 )
+	{
+		status = -1;
+	}
+	out->file = NULL;
+	free( out->index );
+	out->index 					= NULL;
+	out->index_capacity = 0;
+
+	return status;
+}
+
+
+//!-------------------------------------------------------
+//! Reader Fcns
+//!-------------------------------------------------------
+//! nonzero if a log header was written by a machine like this one
+static int SensorLogHeaderMatches( const sensor_log_header *in )
+{
+	sensor_log_header expect;
+
+	SensorLogHeader ( &expect );
+
+	return memcmp( in->magic, expect.magic, sizeof( expect.magic ) ) == 0
+		&& in->byte_order 				== expect.byte_order
+		&& in->version 						== expect.version
+		&& in->header_size 				== expect.header_size
+		&& in->record_header_size == expect.record_header_size
+		&& in->sensors 						> 0
+		&& in->sensors 						<= expect.sensors
+		&& memcmp( in->packet_size, expect.packet_size, sizeof( expect.packet_size ) ) == 0;
+}
+
+int OpenSensorLogReader ( sensor_log_reader *out, const char *path )
+{
+	struct stat file_stat;
+	const sensor_log_header *header;
+	void *base;
+
+	out->fd = open( path, O_RDONLY );
+	if ( out->fd < 0 )
+	{
+		return -1;
+	}
+	if ( fstat( out->fd, &file_stat ) != 0 || (size_t)file_stat.st_size < sizeof( sensor_log_header ) )
+	{
+		close( out->fd );
+		return -1;
+	}
+	out->length = (size_t)file_stat.st_size;
+
+	base = mmap( NULL, out->length, PROT_READ, MAP_PRIVATE, out->fd, 0 );
+	if ( base == MAP_FAILED )
+	{
+		close( out->fd );
+		return -1;
+	}
+	//! read front to back, pages can go once passed
+	madvise( base, out->length, MADV_SEQUENTIAL );
+	out->base 	= (unsigned char *)base;
+	header 			= (const sensor_log_header *)base;
+	out->header = header;
+
+	if ( !SensorLogHeaderMatches ( header ) )
+	{
+		//! not a log, or one of another machine or version
+		CloseSensorLogReader ( out );
+		return -1;
+	}
+
+	out->index 	= NULL;
+	out->end 		= out->length;
+	if ( header->index_offset != 0 )
+	{
+		//! closed by its writer, the records end at the index
+		if ( header->index_offset < sizeof( sensor_log_header )
+			|| header->index_offset % SENSOR_LOG_ALIGNMENT != 0
+			|| header->index_offset > out->length
+			|| header->index_entries > ( out->length - header->index_offset )/sizeof( sensor_log_index ) )
+		{
+			CloseSensorLogReader ( out );
+			return -1;
+		}
+		out->end = header->index_offset;
+		if ( header->index_entries > 0 )
+		{
+			out->index = (const sensor_log_index *)( out->base + header->index_offset );
+		}
+	}
+
+	return RewindSensorLog ( out );
+}
+
+int NextSensorLogRecord ( sensor_log_reader *in, sensor_log_record *out )
+{
+	const sensor_log_record_header *record;
+	uint64_t length;
+
+	if ( in->next >= in->end )
+	{
+		return 0;
+	}
+	if ( in->end - in->next < sizeof( sensor_log_record_header ) )
+	{
+		//! cut short, expected only when the writer never closed
+		return ( in->header->index_offset == 0 ) ? 0 : -1;
+	}
+	record = (const sensor_log_record_header *)( in->base + in->next );
+	length = sizeof( sensor_log_record_header ) + SENSOR_LOG_PADDED( record->size );
+	if ( record->sensor < 0 || record->sensor >= (int32_t)in->header->sensors )
+	{
+		return -1;
+	}
+	if ( in->end - in->next < length )
+	{
+		return ( in->header->index_offset == 0 ) ? 0 : -1;
+	}
+
+	out->sensor = (int)record->sensor;
+	out->t_sec 	= (unsigned long)record->t_sec;
+	out->t_usec = (unsigned long)record->t_usec;
+	out->size 	= (size_t)record->size;
+	out->data 	= (void *)( in->base + in->next + sizeof( sensor_log_record_header ) );
+	in->next 		+= length;
+	in->records++;
+
+	return 1;
+}
+
+int SeekSensorLogTime ( sensor_log_reader *in, unsigned long time_sec, unsigned long time_usec )
+{
+	//! binary search for the last entry not after the time
+	uint64_t low = 0;
+	uint64_t high;
+	uint64_t middle;
+	const sensor_log_index *entry;
+
+	RewindSensorLog ( in );
+	if ( in->index == NULL )
+	{
+		//! no index, read from the start
+		return 0;
+	}
+	high = in->header->index_entries;
+	while ( high - low > 1 )
+	{
+		middle 	= low + ( high - low )/2;
+		entry 	= &(in->index[middle]);
+		if ( entry->t_sec < time_sec || ( entry->t_sec == time_sec && entry->t_usec <= time_usec ) )
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	if ( in->index[low].offset < sizeof( sensor_log_header ) || in->index[low].offset > in->end )
+	{
+		return -1;
+	}
+	in->next 		= in->index[low].offset;
+	in->records = low*SENSOR_LOG_INDEX_STRIDE;
+
+	return 0;
+}
+
+int RewindSensorLog ( sensor_log_reader *in )
+{
+	in->next 		= sizeof( sensor_log_header );
+	in->records = 0;
+
+	return 0;
+}
+
+int CloseSensorLogReader ( sensor_log_reader *in )
+{
+	int status = 0;
+
+	if ( in->base != NULL && munmap( in->base, in->length ) != 0 )
+	{
+		status = -1;
+	}
+	in->base 		= NULL;
+	in->header 	= NULL;
+	in->index 	= NULL;
+	if ( in->fd >= 0 && close( in->fd ) != 0 )
+	{
+		status = -1;
+	}
+	in->fd = -1;
+
+	return status;
+}
+
+
+//!-------------------------------------------------------
+//! Replay Fcns
+//!-------------------------------------------------------
+long ReplaySensorLog ( sensor_log_reader *in, localize *out )
+{
+	return ReplaySensorLogSteps ( in, out, NULL, NULL );
+}
+
+long ReplaySensorLogSteps ( sensor_log_reader *in, localize *out, int (*Step)( localize *state, void *step_data ), void *step_data )
+{
+	//! each record goes to its sensor where it lies in the mapping, the IMU
+	//! paces the steps and a sensor without a record since the last step
+	//! is handed no data, as a live caller does; a record of a slot the
+	//! localize does not have fails the replay
+	sensor_log_record record;
+	int fresh[SENSOR_LOG_SENSORS] = { 0 };
+	long steps = 0;
+	int status;
+	int i;
+
+	while ( ( status = NextSensorLogRecord ( in, &record ) ) == 1 )
+	{
+		//! a packet clock takes the record time, the only time of the odometry
+		SetSensorClockPacket ( &(out->clock), (long)record.t_sec, (long)record.t_usec );
+		if ( UpdateLocalizeData ( record.sensor, out, record.size, record.data ) != 0 )
+		{
+			return -1;
+		}
+		fresh[record.sensor] = 1;
+		if ( record.sensor != IMU_SENSOR )
+		{
+			continue;
+		}
+
+		for (i = 0; i < out->sensors; i++)
+		{
+			if ( fresh[i] == 0 )
+			{
+				UpdateLocalizeData ( i, out, 0, NULL );
+			}
+			fresh[i] = 0;
+		}
+		ComputeLocalize ( out );
+		steps++;
+		if ( Step != NULL && Step ( out, step_data ) != 0 )
+		{
+			return -1;
+		}
+	}
+
+	return ( status < 0 ) ? -1 : steps;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,188 @@
+//! sensor_log.h
+//! sensor log Header File
+//! binary capture of sensor packets and a memory mapped replay of them
+/*! $Id$ */
+
+/*
+
+	A sensor log holds the packets handed to UpdateLocalizeData exactly as
+	they were in memory, so replaying one is a walk over the mapped file:
+
+		sensor_log_header		magic, byte order, version, the slots a
+								record may be of, the size of each IDL
+								packet, the number of records and where
+								the index is
+		records					each a sensor_log_record_header, then the
+								packet padded to SENSOR_LOG_ALIGNMENT
+		index					a sensor_log_index entry every
+								SENSOR_LOG_INDEX_STRIDE records
+
+	Every record starts on SENSOR_LOG_ALIGNMENT, and the mapping on a page,
+	so a packet is used where it lies in the mapping and never copied or
+	parsed.  The file is in the byte order and struct layout of the machine
+	that wrote it; a reader on another refuses it.
+
+	The writer appends records through stdio and fills in the count and the
+	index on close.  A log whose writer never closed has no index, and its
+	records are read up to the end of the file, the last one dropped if it
+	was cut short.
+
+*/
+
+//! Includes
+#include <stdio.h>				//! FILE of the writer
+#include <stdint.h>				//! fixed width fields of the file
+
+#ifndef LOCALIZE_H
+#include "localize.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+
+//! Defines
+
+//! first bytes of a log
+#define SENSOR_LOG_MAGIC				"LOCALLOG"
+//! byte_order as written, reads otherwise on a machine of the other order
+#define SENSOR_LOG_BYTE_ORDER		0x01020304
+#define SENSOR_LOG_VERSION			1
+//! slots of the localize a record may be of, a log may hold fewer
+#define SENSOR_LOG_SENSORS			LOCALIZE_MAX_SENSORS
+//! packets whose layout a log records, GpsIDL ImuIDL and WheelDataIDL
+#define SENSOR_LOG_PACKETS			3
+//! alignment of every record and packet
+#define SENSOR_LOG_ALIGNMENT		8
+//! records between index entries
+#define SENSOR_LOG_INDEX_STRIDE	1024
+
+
+//! Data structs
+
+//! data struct start of a log file
+typedef struct
+{
+	char 			magic[8];
+	uint32_t 	byte_order;
+	uint32_t 	version;
+	//! sizes of this header and of a record header
+	uint32_t 	header_size;
+	uint32_t 	record_header_size;
+	//! slots of the records and the size of each IDL packet
+	uint32_t 	sensors;
+	uint32_t 	packet_size[SENSOR_LOG_PACKETS];
+	uint32_t 	reserved;
+	//! records written, 0 until the writer closed
+	uint64_t 	records;
+	//! offset and entries of the index, 0 until the writer closed
+	uint64_t 	index_offset;
+	uint64_t 	index_entries;
+
+} sensor_log_header;
+
+//! data struct in front of each packet
+typedef struct
+{
+	//! time of the record, epoch seconds and microseconds
+	uint32_t 	t_sec;
+	uint32_t 	t_usec;
+	//! slot of the localize, GPS_SENSOR, IMU_SENSOR, ODOM_SENSOR or one added
+	int32_t 	sensor;
+	//! bytes of the packet
+	uint32_t 	size;
+
+} sensor_log_record_header;
+
+//! data struct index entry, the time and offset of a record
+typedef struct
+{
+	uint32_t 	t_sec;
+	uint32_t 	t_usec;
+	uint64_t 	offset;
+
+} sensor_log_index;
+
+//! data struct a record as the reader hands it out
+typedef struct
+{
+	int sensor;
+	unsigned long t_sec;
+	unsigned long t_usec;
+	size_t size;
+	//! the packet, within the mapping of the reader
+	void *data;
+
+} sensor_log_record;
+
+//! data struct writer of a log
+typedef struct
+{
+	FILE *file;
+	sensor_log_header header;
+	//! offset of the next record
+	uint64_t offset;
+	//! index entries so far, written on close
+	sensor_log_index *index;
+	uint64_t index_capacity;
+
+} sensor_log_writer;
+
+//! data struct reader of a mapped log
+typedef struct
+{
+	int fd;
+	//! the mapped file, length bytes
+	unsigned char *base;
+	size_t length;
+	const sensor_log_header *header;
+	//! offset of the next record and the end of the records
+	uint64_t next;
+	uint64_t end;
+	//! records handed out since the last rewind
+	uint64_t records;
+	//! index within the mapping, NULL without one
+	const sensor_log_index *index;
+
+} sensor_log_reader;
+
+
+//! Functions
+
+//! Writer Fcns
+//! creates the log at path, replacing any file there
+int OpenSensorLogWriter ( sensor_log_writer *out, const char *path );
+//! appends a packet of sensor taken at time_sec, time_usec
+int WriteSensorLogRecord ( sensor_log_writer *out, int sensor, unsigned long time_sec, unsigned long time_usec, size_t size, const void *data );
+//! writes the index and the count and closes the file
+int CloseSensorLogWriter ( sensor_log_writer *out );
+
+//! Reader Fcns
+//! maps the log at path and checks its header
+int OpenSensorLogReader ( sensor_log_reader *out, const char *path );
+//! the next record, returns 1, 0 at the end of the log and -1 on a damaged record
+int NextSensorLogRecord ( sensor_log_reader *in, sensor_log_record *out );
+//! moves to the last indexed record at or before the time, the start without an index
+int SeekSensorLogTime ( sensor_log_reader *in, unsigned long time_sec, unsigned long time_usec );
+//! back to the first record
+int RewindSensorLog ( sensor_log_reader *in );
+//! unmaps the log
+int CloseSensorLogReader ( sensor_log_reader *in );
+
+//! Replay Fcns
+//! hands every record to UpdateLocalizeData and computes the localize at each IMU_SENSOR record
+//! returns the number of ComputeLocalize calls, -1 on a damaged log
+long ReplaySensorLog ( sensor_log_reader *in, localize *out );
+//! as ReplaySensorLog, calling Step with step_data after each ComputeLocalize
+//! a nonzero return from Step stops the replay with -1
+long ReplaySensorLogSteps ( sensor_log_reader *in, localize *out, int (*Step)( localize *state, void *step_data ), void *step_data );
+
+#endif  //! define SENSOR_LOG_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
@@ -9,6 +9,9 @@ extern "C" {
 #endif
 
 #include "sensor_odom.h"
+
+// the scripted sensor template
+#include "odom.h"
 /*
 		transducer values
 		
@@ -88,7 +91,7 @@ int OdomGenerateVelMatrix( void *in, vel_matrix * out)
 	ptr = (sensor *)in;
 	
 	// Ackermann drive so use one wheel velocity as the composite Vx
-	//out->vel[0] = ptr->array[3]->value;// only returns right wheel 
+	//out->vel[0] = ptr->array->value[3];// only returns right wheel 
 	
 	// current: use filtered velocity 
 	out->vel[0] = ptr->filtered[3];// only returns right wheel
@@ -126,13 +129,14 @@ int	OdomUpdateSensor( size_t  size_data, void *in, void *out)
 		
 		ptr_output = (sensor *)out;
 		// assign values to sensor transducers
-		ptr_output->array[0]->value = ptr->leftDistance;
-		ptr_output->array[1]->value = ptr->rightDistance;
-		ptr_output->array[2]->value = ptr->leftSpeed * METRES_IN_KM / SECONDS_IN_HOUR ;// speed converted to metres/second
-		ptr_output->array[3]->value = ptr->rightSpeed * METRES_IN_KM / SECONDS_IN_HOUR;// from km / hr
+		ptr_output->array->value[0] = ptr->leftDistance;
+		ptr_output->array->value[1] = ptr->rightDistance;
+		ptr_output->array->value[2] = ptr->leftSpeed * METRES_IN_KM / SECONDS_IN_HOUR ;// speed converted to metres/second
+		ptr_output->array->value[3] = ptr->rightSpeed * METRES_IN_KM / SECONDS_IN_HOUR;// from km / hr
 
 		//update time from computer for now
 		//UpdateSensorTime (ptr_output, (unsigned long)(ptr->time_sec), (unsigned long)(ptr->time_usec) );  
+		// no time in the packet, a packet clock gives that of the last one
 		UpdateSensorTime2 ( ptr_output );		
 		
 		
@@ -140,7 +144,7 @@ int	OdomUpdateSensor( size_t  size_data, void *in, void *out)
 		for (i = 0; i < ptr_output->transducers; i++)  
 		{
 			// increase the populations
-			ptr_output->array[i]->population++;
+			ptr_output->array->population[i]++;
 		}
 		
 	}
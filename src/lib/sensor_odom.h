@@ -80,6 +80,9 @@ int OdomGenerateVelMatrix( void *in, vel_matrix * out);
 // odom update fcn for data received					
 int	OdomUpdateSensor( size_t  size_data, void *in, void *out);
 
+// scripted odom sensor of odom.h, read only - copied by CloneSensor
+extern const sensor odom_template;
+
 
 
 #endif  // define SENSOR_H
@@ -0,0 +1,163 @@
+//! sensor_queue.c
+//!
+//! sensor queue Functions
+/* $Id$ */
+
+
+/*
+
+	This c file keeps the rings of sensor_queue.  Positions count up
+	without wrapping back, the entry of a position is its low bits.
+
+*/
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>			// memcpy
+
+#include "sensor_queue.h"
+
+
+//! bytes rounded up to SENSOR_QUEUE_ALIGNMENT
+#define SENSOR_QUEUE_PADDED(size)		(((size_t)(size) + SENSOR_QUEUE_ALIGNMENT - 1) & ~(size_t)(SENSOR_QUEUE_ALIGNMENT - 1))
+
+
+//!-------------------------------------------------------
+//! Init Fcns
+//!-------------------------------------------------------
+size_t SizeSensorQueueArena ( unsigned long capacity, size_t packet_size )
+{
+	//! entries with their packets, capacity a power of two
+	if ( capacity == 0 || ( capacity & ( capacity - 1 ) ) != 0 )
+	{
+		return 0;
+	}
+
+	return capacity * ( SENSOR_QUEUE_PADDED( sizeof( sensor_queue_packet ) ) + SENSOR_QUEUE_PADDED( packet_size ) );
+}
+
+int InitSensorQueueArena ( sensor_queue *out, unsigned long capacity, size_t packet_size, void *arena )
+{
+	if ( SizeSensorQueueArena ( capacity, packet_size ) == 0 || arena == NULL )
+	{
+		return -1;
+	}
+	out->capacity 		= capacity;
+	out->packet_size 	= packet_size;
+	out->stride 			= SENSOR_QUEUE_PADDED( sizeof( sensor_queue_packet ) ) + SENSOR_QUEUE_PADDED( packet_size );
+	out->entry 				= (unsigned char *)arena;
+
+	return ZeroSensorQueue ( out );
+}
+
+
+//!-------------------------------------------------------
+//! Zero Fcns
+//!-------------------------------------------------------
+int ZeroSensorQueue ( sensor_queue *out )
+{
+	out->head 			= 0;
+	out->pushed 		= 0;
+	out->dropped 		= 0;
+	out->tail 			= 0;
+	out->high_water = 0;
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Update Fcns
+//!-------------------------------------------------------
+int PushSensorQueue ( sensor_queue *out, unsigned long time_sec, unsigned long time_usec, size_t size, const void *data )
+{
+	//! producer side - only the producer writes head, and the release
+	//! store publishes the packet before the consumer can see it
+	sensor_queue_packet *packet;
+	unsigned long head, tail;
+
+	head = out->head;
+	tail = __atomic_load_n( &(out->tail), __ATOMIC_ACQUIRE );
+	if ( head - tail >= out->capacity || size > out->packet_size )
+	{
+		//! full as the consumer has fallen behind, or no room for it
+		__atomic_store_n( &(out->dropped), out->dropped + 1, __ATOMIC_RELAXED );
+		return -1;
+	}
+
+	packet = (sensor_queue_packet *)( out->entry + ( head & ( out->capacity - 1 ) )*out->stride );
+	packet->t_sec 	= time_sec;
+	packet->t_usec 	= time_usec;
+	packet->size 		= size;
+	if ( size > 0 )
+	{
+		memcpy( SensorQueueData ( packet ), data, size );
+	}
+
+	__atomic_store_n( &(out->pushed), out->pushed + 1, __ATOMIC_RELAXED );
+	__atomic_store_n( &(out->head), head + 1, __ATOMIC_RELEASE );
+
+	return 0;
+}
+
+
+//!-------------------------------------------------------
+//! Get/Set Fcns
+//!-------------------------------------------------------
+unsigned long SensorQueueHead ( sensor_queue *in )
+{
+	//! consumer side - what is published up to now, and how deep that is
+	unsigned long head = __atomic_load_n( &(in->head), __ATOMIC_ACQUIRE );
+
+	if ( head - in->tail > in->high_water )
+	{
+		__atomic_store_n( &(in->high_water), head - in->tail, __ATOMIC_RELAXED );
+	}
+
+	return head;
+}
+
+sensor_queue_packet * SensorQueueFront ( sensor_queue *in, unsigned long head )
+{
+	if ( in->tail == head )
+	{
+		return NULL;
+	}
+
+	return (sensor_queue_packet *)( in->entry + ( in->tail & ( in->capacity - 1 ) )*in->stride );
+}
+
+void * SensorQueueData ( sensor_queue_packet *in )
+{
+	return (void *)( (unsigned char *)in + SENSOR_QUEUE_PADDED( sizeof( sensor_queue_packet ) ) );
+}
+
+int PopSensorQueue ( sensor_queue *in )
+{
+	//! the entry may be written again once the producer sees tail
+	__atomic_store_n( &(in->tail), in->tail + 1, __ATOMIC_RELEASE );
+
+	return 0;
+}
+
+int GetSensorQueueStats ( sensor_queue *in, sensor_queue_stats *out )
+{
+	unsigned long tail 	= __atomic_load_n( &(in->tail), __ATOMIC_ACQUIRE );
+	unsigned long head 	= __atomic_load_n( &(in->head), __ATOMIC_ACQUIRE );
+
+	//! tail first, so the depth is never negative
+	out->depth 			= head - tail;
+	out->high_water = __atomic_load_n( &(in->high_water), __ATOMIC_RELAXED );
+	out->pushed 		= __atomic_load_n( &(in->pushed), __ATOMIC_RELAXED );
+	out->dropped 		= __atomic_load_n( &(in->dropped), __ATOMIC_RELAXED );
+
+	return 0;
+}
+
+
+#ifdef __cplusplus
+} /* matches extern "C" for C++ */
+#endif
@@ -0,0 +1,128 @@
+//! sensor_queue.h
+//! sensor queue Header File
+//! lock free rings of sensor packets from driver threads to the localize
+/*! $Id$ */
+
+/*
+
+	A sensor_queue carries the IDL packets of one sensor from the thread of
+	its driver to the thread running ComputeLocalize, so neither waits on
+	the other.  It is a single producer single consumer ring of fixed
+	capacity, a power of two, each entry a copy of one packet with its
+	time:
+
+		producer	PushSensorQueue copies the packet into the entry at
+					head and publishes it with a release store of head
+		consumer	SensorQueueFront reads the entry at tail, in place,
+					and PopSensorQueue hands the entry back with a release
+					store of tail
+
+	Only the producer writes head and its counters, only the consumer tail
+	and its own, each on a cache line of its own.  A packet pushed into a
+	full ring, or larger than the entries, is dropped and counted rather
+	than waited for.
+
+	GetSensorQueueStats may be called from any thread; its counts are
+	each exact, but not taken at one instant.
+
+*/
+
+//! Includes
+#include <stddef.h>				//! size_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SENSOR_QUEUE_H
+#define SENSOR_QUEUE_H
+
+
+//! Defines
+
+//! bytes between the producer and consumer members, one cache line
+#define SENSOR_QUEUE_LINE			64
+//! alignment of every entry and packet
+#define SENSOR_QUEUE_ALIGNMENT	8
+
+
+//! Data structs
+
+//! data struct head of an entry, the packet follows
+typedef struct
+{
+	//! time of the packet, epoch seconds and microseconds
+	unsigned long t_sec;
+	unsigned long t_usec;
+	//! bytes of the packet
+	size_t size;
+
+} sensor_queue_packet;
+
+//! data struct single producer single consumer ring of packets
+typedef struct
+{
+	//! next entry the producer writes, and its counters, written only by the producer
+	unsigned long head __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	unsigned long pushed;
+	unsigned long dropped;
+
+	//! next entry the consumer reads, and the deepest it has found the ring
+	unsigned long tail __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	unsigned long high_water;
+
+	//! entries, a power of two, and the bytes of each with its packet
+	unsigned long capacity __attribute__((aligned(SENSOR_QUEUE_LINE)));
+	size_t packet_size;
+	size_t stride;
+	unsigned char *entry;
+
+} sensor_queue;
+
+//! data struct counts of a queue
+typedef struct
+{
+	//! packets waiting, and the most found waiting by the consumer
+	unsigned long depth;
+	unsigned long high_water;
+	//! packets taken in, and those dropped as the ring was full or they too large
+	unsigned long pushed;
+	unsigned long dropped;
+
+} sensor_queue_stats;
+
+
+//! Functions
+
+//! Init Fcns
+//! bytes of arena for capacity entries of packets up to packet_size, 0 if capacity is not a power of two
+size_t SizeSensorQueueArena ( unsigned long capacity, size_t packet_size );
+//! an empty queue in arena, which the caller keeps
+int InitSensorQueueArena ( sensor_queue *out, unsigned long capacity, size_t packet_size, void *arena );
+
+//! Zero Fcns
+//! empties the queue and its counters, with neither side running
+int ZeroSensorQueue ( sensor_queue *out );
+
+//! Update Fcns - the producer
+//! copies a packet taken at time_sec, time_usec into the queue
+//! returns -1 and counts it dropped if the queue is full or the packet too large
+int PushSensorQueue ( sensor_queue *out, unsigned long time_sec, unsigned long time_usec, size_t size, const void *data );
+
+//! Get/Set Functions - the consumer
+//! position of the newest published packet, a limit for SensorQueueFront
+unsigned long SensorQueueHead ( sensor_queue *in );
+//! the oldest packet before head, NULL if there is none
+sensor_queue_packet * SensorQueueFront ( sensor_queue *in, unsigned long head );
+//! the bytes of a packet of the queue
+void * SensorQueueData ( sensor_queue_packet *in );
+//! hands the oldest packet back to the producer
+int PopSensorQueue ( sensor_queue *in );
+//! the counts of the queue, from any thread
+int GetSensorQueueStats ( sensor_queue *in, sensor_queue_stats *out );
+
+#endif  //! define SENSOR_QUEUE_H
+
+#ifdef __cplusplus
+} /*! matches extern "C" for C++ */
+#endif
@@ -132,6 +132,26 @@ int km_SetVelMatrix2( vel_matrix in, vel_matrix *out)
 	return 0;
 
 }// end km_SetVelMatrix
+int km_GetStateArray( state_vector *in, double *out )
+{
+	// places the STATE_ARRAY elements in order loc x y z then orient s x y z
+	out[0] = in->loc.x;
+	out[1] = in->loc.y;
+	out[2] = in->loc.z;
+	out[3] = in->orient.s;
+	out[4] = in->orient.x;
+	out[5] = in->orient.y;
+	out[6] = in->orient.z;
+	
+	return 0;
+
+}// end km_GetStateArray
+int km_SetStateArray( double *in, state_vector *out )
+{
+	// array version, the order of km_GetStateArray
+	return km_SetStateVector( in[0], in[1], in[2], in[3], in[4], in[5], in[6], out );
+
+}// end km_SetStateArray
 
 //-------------------------------------------------------
 // Copy Fcns
@@ -19,6 +19,8 @@ extern "C" {
 
 // Defines
 #define VEL_ARRAY		6
+// elements of a state vector, loc x y z then orient s x y z
+#define STATE_ARRAY		7
 
 // numerical constants
 #define APPROACHING_ONE  0.99999999999999999999999999999999999
@@ -60,6 +62,8 @@ int km_SetStateVector( double x, double y, double z, double qs, double qx, doubl
 int km_SetStateVector2( state_vector in, state_vector *out );// state vector version
 int km_SetVelMatrix( double vx, double vy, double vz, double omega_x, double omega_y, double omega_z, vel_matrix *out);
 int km_SetVelMatrix2( vel_matrix in, vel_matrix *out);// vel matrix version
+int km_GetStateArray( state_vector *in, double *out );// STATE_ARRAY elements loc x y z then orient s x y z
+int km_SetStateArray( double *in, state_vector *out );// array version
 
 // Copy Fcns
 int CopyStateVector ( state_vector *in, state_vector *out);// copy contents from in into out
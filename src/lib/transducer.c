@@ -10,6 +10,21 @@ extern "C" {
 #ifndef TRANSDUCER_H
 #include "transducer.h"
 #endif
+#include "cpu_dispatch.h"		// instruction set clones of the hot kernels
+
+// transducer types, shared by every transducer
+const transducer_types  transducer_list[50] = 
+{
+
+	{"distance"},					// measure in metres
+	{"velocity"},					// metres /second
+	{"acceleration"},			// metres / second*second
+	{"angle"},						// angle in radians
+	{"temperature"},			// degrees in K/C
+	{"current"},					// Amperes
+	{"voltage"}						// Volts
+ 
+};// end struct 
 
 
 //-------------------------------------------------------
@@ -213,6 +228,139 @@ int ComputeTransducerInnovation( transducer *out  )
 
 
 
+//-------------------------------------------------------
+// transducer_array Fcns
+//-------------------------------------------------------
+
+// The sweeps below read and write each array once with unit stride 
+// and no calls or aliasing in the loop body so the compiler 
+// vectorizes them.  They reproduce the per transducer fcns above 
+// applied in the order UpdateSensorData used to apply them.
+
+size_t SizeTransducerArray( int count )
+{
+	// six arrays of count doubles, each starting a cache line
+	size_t bytes = count * sizeof( double );
+	
+	bytes = ( bytes + TRANSDUCER_ALIGNMENT - 1 ) & ~( (size_t)TRANSDUCER_ALIGNMENT - 1 );
+	
+	return 6*bytes;
+}
+
+int InitTransducerArray( int count, transducer_array *out, void *arena )
+{
+	// places the arrays within arena, aligned to TRANSDUCER_ALIGNMENT
+	double *region = (double *)arena;
+	size_t stride = SizeTransducerArray( count ) / ( 6*sizeof( double ) );
+	
+	if ( count <= 0 || arena == NULL )
+	{
+		return -1;
+	}
+	
+	out->count 			= count;
+	out->value 			= region;
+	out->previous 	= region + stride;
+	out->predicted 	= region + 2*stride;
+	out->innovation = region + 3*stride;
+	out->variance 	= region + 4*stride;
+	out->population = region + 5*stride;
+	
+	return ZeroTransducerArray( out );
+}
+
+int ZeroTransducerArray( transducer_array *out )
+{
+	int i;
+	
+	for (i = 0; i < out->count; i++)
+	{
+		out->value[i]				= 0.0;
+		out->previous[i]		= 0.0;
+		out->predicted[i]		= 0.0;
+		out->innovation[i]	= 0.0;
+		out->variance[i]		= 0.0;
+		out->population[i]	= 0.0;
+	}
+	
+	return 0;
+}
+
+int UpdateTransducerArrayPrevious( transducer_array *out )
+{
+	// store old values in previous
+	memcpy( out->previous, out->value, out->count * sizeof( double ) );
+	
+	return 0;
+}
+
+CPU_DISPATCH int UpdateTransducerArrayPredicted( double W1, double W2, transducer_array *out )
+{
+	// updates the predicted values as in UpdateTransducerPredicted
+	int i;
+	double *value = out->value;
+	double *predicted = out->predicted;
+	double *population = out->population;
+	double weighted;
+	
+	for (i = 0; i < out->count; i++)
+	{
+		// first measurement simply assigned
+		weighted = W1*predicted[i] + W2*value[i];
+		predicted[i] = ( population[i] != 0.0 ) ? weighted : value[i];
+	}
+	
+	return 0;
+}
+
+CPU_DISPATCH int UpdateTransducerArrayMeasured( double W1, double W2, transducer_array *out )
+{
+	// innovation from prediction vs. value then prediction
+	// from prediction and value
+	int i;
+	double *value = out->value;
+	double *predicted = out->predicted;
+	double *innovation = out->innovation;
+	double *population = out->population;
+	double weighted;
+	
+	for (i = 0; i < out->count; i++)
+	{
+		innovation[i] = value[i] - predicted[i];
+		weighted = W1*predicted[i] + W2*value[i];
+		predicted[i] = ( population[i] != 0.0 ) ? weighted : value[i];
+	}
+	
+	return 0;
+}
+
+CPU_DISPATCH int UpdateTransducerArrayUnmeasured( double V1, double V2, double W1, double W2, transducer_array *out )
+{
+	// without new data: previous from value, value from the weighted
+	// prediction (V1 V2), innovation and prediction (W1 W2)
+	int i;
+	double *value = out->value;
+	double *previous = out->previous;
+	double *predicted = out->predicted;
+	double *innovation = out->innovation;
+	double *population = out->population;
+	double current, weighted;
+	
+	for (i = 0; i < out->count; i++)
+	{
+		previous[i] = value[i];
+		current = V1*predicted[i] + V2*value[i];
+		value[i] = current;
+		innovation[i] = current - predicted[i];
+		weighted = W1*predicted[i] + W2*current;
+		predicted[i] = ( population[i] != 0.0 ) ? weighted : current;
+	}
+	
+	return 0;
+}
+
+
+
 #ifdef __cplusplus
 } /* matches extern "C" for C++ */
 #endif
@@ -7,6 +7,7 @@
 // Includes
 
 #include <stdio.h>
+#include <string.h>		// memcpy for the array sweeps
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +20,7 @@ extern "C" {
 // defines
 
 #define DATA_TYPE_LENGTH	36
+#define TRANSDUCER_ALIGNMENT	64		// each array of a transducer_array starts a cache line
 
 
 
@@ -39,18 +41,8 @@ typedef struct
 
 // a data structure to cover the types of data and the 
 // resultant variation in the handling of updates and computation
-static transducer_types  transducer_list[50] = 
-{
-
-	{"distance"},					// measure in metres
-	{"velocity"},					// metres /second
-	{"acceleration"},			// metres / second*second
-	{"angle"},						// angle in radians
-	{"temperature"},			// degrees in K/C
-	{"current"},					// Amperes
-	{"voltage"}						// Volts
- 
-};// end struct 
+// read only and shared, defined in transducer.c
+extern const transducer_types  transducer_list[50];
 
 // this data struct transducer
 // is a first implementation subject to 
@@ -85,6 +77,24 @@ typedef struct
 } transducer;
 
 
+// the numerical data of all the transducers of a sensor 
+// as a struct of arrays.  Entry i of every array belongs to
+// transducer i, so value is the contiguous measurement vector
+// and an update is a single sweep down contiguous memory.
+typedef struct
+{
+	int				count;										// number of transducers
+	
+	double		*value;										// current values as sensed
+	double		*previous;								// previous values
+	double		*predicted;								// predicted values at previous time 
+	double		*innovation;							// estimated noise components [ measurement - predicted]
+	double		*variance;								// variances of the data 
+	double		*population;							// current populations of data points seen
+	
+} transducer_array;
+
+
 // functions 
 
 // Constructors - create data structs
@@ -117,6 +127,24 @@ int UpdateTransducerValueWithPredicted(double W1, double W2, transducer *out );/
 int ComputeTransducerInnovation( transducer *out  );
 
 
+// transducer_array functions
+
+// Init Fcns
+size_t SizeTransducerArray( int count );		// bytes of arena needed for count transducers
+int InitTransducerArray( int count, transducer_array *out, void *arena );	// places the arrays within arena
+
+// Zero Fcns
+int ZeroTransducerArray( transducer_array *out );
+
+// Update Fcns - each is one sweep over all transducers
+int UpdateTransducerArrayPrevious( transducer_array *out ); // previous value from the current value
+int UpdateTransducerArrayPredicted( double W1, double W2, transducer_array *out ); // predicted values only
+// innovation and predicted after new values were sensed
+int UpdateTransducerArrayMeasured( double W1, double W2, transducer_array *out );
+// previous, value from predicted, innovation and predicted without new values
+int UpdateTransducerArrayUnmeasured( double V1, double V2, double W1, double W2, transducer_array *out );
+
+
 #endif  // define TRANSDUCER_H
 
 #ifdef __cplusplus